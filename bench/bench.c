@@ -0,0 +1,604 @@
+// Compiler benchmark
+// ==========================================================================
+// Generates a corpus in memory and compiles it a number of times through
+// zbcx_compile(), reading the files from memory and discarding the object.
+// The report shows the median time of a compilation, the throughput, the
+// peak resident memory of the process and the time of each phase.
+//
+// Timing the phases slows down lexing and preprocessing, so the phases are
+// timed in separate compilations from the ones that give the compile time.
+//
+// Usage: zt-bcc-bench [options]
+//   -funcs <n>         Number of functions
+//   -ns-depth <n>      Number of namespaces each function is nested in
+//   -macros <n>        Macros per 100 functions
+//   -strings <n>       Number of string literals
+//   -includes <n>      Number of headers the functions are spread across
+//   -runs <n>          Number of compilations to measure
+//   -low-memory <0|1>  Compile with the low_memory option
+//   -emit <dir>        Write the corpus to a directory and exit
+//   -save <file>       Save the results, to be used as a baseline
+//   -baseline <file>   Compare the results with a saved baseline
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined( _WIN32 ) || defined( _WIN64 )
+#   include <windows.h>
+#   include <psapi.h>
+#else
+#   include <sys/resource.h>
+#endif
+
+#include "zbcx.h"
+#include "corpus.h"
+
+enum { MAX_RUNS = 100 };
+
+static const char* g_phase_names[] = {
+   "lex",
+   "preprocess",
+   "parse",
+   "import",
+   "cache",
+   "semantic",
+   "codegen",
+   "chunks",
+   "flush",
+   "other",
+};
+
+enum { PHASE_TOTAL = sizeof( g_phase_names ) / sizeof( g_phase_names[ 0 ] ) };
+
+// Results of the median run.
+struct results {
+   double total_ms;
+   double lines_per_s;
+   double tokens_per_s;
+   double peak_rss_kb;
+   double peak_alloc_kb;
+   double phase_ms[ PHASE_TOTAL ];
+};
+
+struct run {
+   double total_ms;
+   double tokens;
+   double peak_alloc;
+   double phase_ms[ PHASE_TOTAL ];
+   bool reported;
+   bool failed;
+};
+
+struct memory_file {
+   const char* data;
+   size_t size;
+   size_t pos;
+   bool error;
+};
+
+struct bench {
+   struct corpus corpus;
+   struct run* run;
+   size_t output_size;
+   bool low_memory;
+};
+
+static bool read_args( int argc, char** argv, struct corpus_params* params,
+   int* runs, bool* low_memory, const char** emit_dir, const char** save_path,
+   const char** baseline_path );
+static bool compile( struct bench* bench, struct run* run, bool timed );
+static const char* strip_path( const char* path );
+static char* memory_realpath( void* context, const char* path );
+static bool memory_fexists( void* context, const char* path );
+static zbcx_Io memory_fopen( void* context, const char* path,
+   const char* modes );
+static int memory_close( void* state );
+static int memory_error( void* state );
+static int memory_seek( void* state, long offset, int whence );
+static unsigned long memory_read( void* dest, size_t size, size_t n,
+   void* state );
+static unsigned long memory_write( void* src, size_t size, size_t n,
+   void* state );
+static unsigned long output_write( void* src, size_t size, size_t n,
+   void* state );
+static int output_close( void* state );
+static void diag( void* context, int flags, va_list* args );
+static void read_timings( struct run* run, const char* json );
+static double read_number( const char* json, const char* key );
+static double get_time_ms( void );
+static double get_peak_rss_kb( void );
+static int compare_runs( const void* a, const void* b );
+static bool emit_corpus( const struct corpus* corpus, const char* dir );
+static void print_results( const struct results* results,
+   const struct corpus_params* params, const struct corpus* corpus,
+   int runs );
+static bool save_results( const struct results* results, const char* path );
+static bool compare_results( const struct results* results,
+   const char* path );
+static void print_change( const char* name, double value, double baseline,
+   bool higher_better );
+
+static const zbcx_IoVtable g_memory_vtable = {
+   memory_close,
+   memory_error,
+   memory_seek,
+   memory_read,
+   memory_write,
+};
+
+static const zbcx_IoVtable g_output_vtable = {
+   output_close,
+   memory_error,
+   memory_seek,
+   memory_read,
+   output_write,
+};
+
+int main( int argc, char** argv ) {
+   struct corpus_params params;
+   corpus_init_params( &params );
+   int runs = 5;
+   const char* emit_dir = NULL;
+   const char* save_path = NULL;
+   const char* baseline_path = NULL;
+   bool low_memory = false;
+   if ( ! read_args( argc, argv, &params, &runs, &low_memory, &emit_dir,
+      &save_path, &baseline_path ) ) {
+      return EXIT_FAILURE;
+   }
+   struct bench bench;
+   bench.low_memory = low_memory;
+   corpus_generate( &bench.corpus, &params );
+   if ( emit_dir ) {
+      bool emitted = emit_corpus( &bench.corpus, emit_dir );
+      corpus_free( &bench.corpus );
+      return emitted ? EXIT_SUCCESS : EXIT_FAILURE;
+   }
+   // The first compilation warms up the caches of the machine and is not
+   // measured.
+   struct run timed_runs[ MAX_RUNS + 1 ];
+   struct run runs_list[ MAX_RUNS ];
+   bool compiled = compile( &bench, &timed_runs[ 0 ], true );
+   for ( int i = 0; i < runs && compiled; ++i ) {
+      compiled = compile( &bench, &runs_list[ i ], false ) &&
+         compile( &bench, &timed_runs[ i + 1 ], true );
+   }
+   if ( ! compiled ) {
+      fprintf( stderr, "error: failed to compile the corpus\n" );
+      corpus_free( &bench.corpus );
+      return EXIT_FAILURE;
+   }
+   qsort( runs_list, runs, sizeof( runs_list[ 0 ] ), compare_runs );
+   qsort( timed_runs + 1, runs, sizeof( timed_runs[ 0 ] ), compare_runs );
+   struct run* median = &runs_list[ runs / 2 ];
+   struct run* timed_median = &timed_runs[ 1 + runs / 2 ];
+   struct results results;
+   results.total_ms = median->total_ms;
+   results.lines_per_s = bench.corpus.lines / ( median->total_ms / 1000 );
+   results.tokens_per_s = timed_median->tokens / ( median->total_ms / 1000 );
+   results.peak_rss_kb = get_peak_rss_kb();
+   results.peak_alloc_kb = timed_median->peak_alloc / 1024;
+   for ( int i = 0; i < PHASE_TOTAL; ++i ) {
+      results.phase_ms[ i ] = timed_median->phase_ms[ i ];
+   }
+   print_results( &results, &params, &bench.corpus, runs );
+   bool ok = true;
+   if ( save_path ) {
+      ok = save_results( &results, save_path ) && ok;
+   }
+   if ( baseline_path ) {
+      ok = compare_results( &results, baseline_path ) && ok;
+   }
+   corpus_free( &bench.corpus );
+   return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool read_args( int argc, char** argv, struct corpus_params* params,
+   int* runs, bool* low_memory, const char** emit_dir, const char** save_path,
+   const char** baseline_path ) {
+   for ( int i = 1; i < argc; ++i ) {
+      const char* option = argv[ i ];
+      if ( i + 1 >= argc ) {
+         fprintf( stderr, "error: missing argument for %s option\n", option );
+         return false;
+      }
+      const char* arg = argv[ ++i ];
+      if ( strcmp( option, "-funcs" ) == 0 ) {
+         params->funcs = atoi( arg );
+      }
+      else if ( strcmp( option, "-ns-depth" ) == 0 ) {
+         params->ns_depth = atoi( arg );
+      }
+      else if ( strcmp( option, "-macros" ) == 0 ) {
+         params->macro_density = atoi( arg );
+      }
+      else if ( strcmp( option, "-strings" ) == 0 ) {
+         params->strings = atoi( arg );
+      }
+      else if ( strcmp( option, "-includes" ) == 0 ) {
+         params->includes = atoi( arg );
+      }
+      else if ( strcmp( option, "-runs" ) == 0 ) {
+         *runs = atoi( arg );
+         if ( *runs < 1 || *runs > MAX_RUNS ) {
+            fprintf( stderr, "error: number of runs not between 1 and %d\n",
+               MAX_RUNS );
+            return false;
+         }
+      }
+      else if ( strcmp( option, "-low-memory" ) == 0 ) {
+         *low_memory = ( atoi( arg ) != 0 );
+      }
+      else if ( strcmp( option, "-emit" ) == 0 ) {
+         *emit_dir = arg;
+      }
+      else if ( strcmp( option, "-save" ) == 0 ) {
+         *save_path = arg;
+      }
+      else if ( strcmp( option, "-baseline" ) == 0 ) {
+         *baseline_path = arg;
+      }
+      else {
+         fprintf( stderr, "error: unknown option: %s\n", option );
+         return false;
+      }
+   }
+   if ( params->funcs < 0 || params->ns_depth < 0 ||
+      params->macro_density < 0 || params->strings < 0 ||
+      params->includes < 0 ) {
+      fprintf( stderr, "error: corpus parameters must not be negative\n" );
+      return false;
+   }
+   return true;
+}
+
+static bool compile( struct bench* bench, struct run* run, bool timed ) {
+   run->reported = false;
+   run->failed = false;
+   bench->run = run;
+   bench->output_size = 0;
+   zbcx_Options options = zbcx_options_init();
+   options.context = bench;
+   options.source_file = "main.bcs";
+   options.timings = timed ? zbcx_timings_json : zbcx_timings_none;
+   options.low_memory = bench->low_memory;
+   options.diag = diag;
+   options.realpath = memory_realpath;
+   options.fexists = memory_fexists;
+   options.fopen = memory_fopen;
+   options.output.state = bench;
+   options.output.vtable = &g_output_vtable;
+   double start = get_time_ms();
+   zbcx_Result result = zbcx_compile( &options );
+   run->total_ms = get_time_ms() - start;
+   return ( result == zbcx_res_ok && ( run->reported || ! timed ) &&
+      ! run->failed && bench->output_size > 0 );
+}
+
+// The compiler joins the directory of the including file with the path of
+// the included file, so paths can start with `./` or `/`.
+static const char* strip_path( const char* path ) {
+   while ( path[ 0 ] == '.' && path[ 1 ] == '/' ) {
+      path += 2;
+   }
+   while ( path[ 0 ] == '/' ) {
+      ++path;
+   }
+   return path;
+}
+
+static char* memory_realpath( void* context, const char* path ) {
+   struct bench* bench = context;
+   const struct corpus_file* file = corpus_find( &bench->corpus,
+      strip_path( path ) );
+   if ( ! file ) {
+      return NULL;
+   }
+   char* full_path = malloc( strlen( file->name ) + 2 );
+   if ( full_path ) {
+      full_path[ 0 ] = '/';
+      strcpy( full_path + 1, file->name );
+   }
+   return full_path;
+}
+
+static bool memory_fexists( void* context, const char* path ) {
+   struct bench* bench = context;
+   return ( corpus_find( &bench->corpus, strip_path( path ) ) != NULL );
+}
+
+static zbcx_Io memory_fopen( void* context, const char* path,
+   const char* modes ) {
+   struct bench* bench = context;
+   zbcx_Io io = { NULL, NULL };
+   const struct corpus_file* file = corpus_find( &bench->corpus,
+      strip_path( path ) );
+   if ( file && modes[ 0 ] == 'r' ) {
+      struct memory_file* memory_file = malloc( sizeof( *memory_file ) );
+      if ( memory_file ) {
+         memory_file->data = file->data;
+         memory_file->size = file->size;
+         memory_file->pos = 0;
+         memory_file->error = false;
+         io.state = memory_file;
+         io.vtable = &g_memory_vtable;
+      }
+   }
+   return io;
+}
+
+static int memory_close( void* state ) {
+   free( state );
+   return 0;
+}
+
+static int memory_error( void* state ) {
+   struct memory_file* file = state;
+   return file->error;
+}
+
+static int memory_seek( void* state, long offset, int whence ) {
+   struct memory_file* file = state;
+   long pos = offset;
+   if ( whence == SEEK_CUR ) {
+      pos += ( long ) file->pos;
+   }
+   else if ( whence == SEEK_END ) {
+      pos += ( long ) file->size;
+   }
+   if ( pos < 0 || ( size_t ) pos > file->size ) {
+      return -1;
+   }
+   file->pos = ( size_t ) pos;
+   return 0;
+}
+
+static unsigned long memory_read( void* dest, size_t size, size_t n,
+   void* state ) {
+   struct memory_file* file = state;
+   if ( size == 0 ) {
+      return 0;
+   }
+   size_t count = ( file->size - file->pos ) / size;
+   if ( count > n ) {
+      count = n;
+   }
+   memcpy( dest, file->data + file->pos, count * size );
+   file->pos += count * size;
+   return count;
+}
+
+static unsigned long memory_write( void* src, size_t size, size_t n,
+   void* state ) {
+   ( void ) src;
+   ( void ) size;
+   ( void ) n;
+   struct memory_file* file = state;
+   file->error = true;
+   return 0;
+}
+
+// The object is only measured, not kept.
+static unsigned long output_write( void* src, size_t size, size_t n,
+   void* state ) {
+   ( void ) src;
+   struct bench* bench = state;
+   bench->output_size += size * n;
+   return n;
+}
+
+static int output_close( void* state ) {
+   ( void ) state;
+   return 0;
+}
+
+static void diag( void* context, int flags, va_list* args ) {
+   struct bench* bench = context;
+   if ( flags & ZBCX_DIAG_FILE ) {
+      va_arg( *args, zbcx_Pos* );
+   }
+   const char* format = va_arg( *args, const char* );
+   char message[ 4096 ];
+   vsnprintf( message, sizeof( message ), format, *args );
+   if ( flags == ZBCX_DIAG_NONE && strncmp( message, "{\"phases_us\"",
+      12 ) == 0 ) {
+      read_timings( bench->run, message );
+   }
+   else {
+      if ( flags & ZBCX_DIAG_ERR ) {
+         bench->run->failed = true;
+      }
+      fprintf( stderr, "%s\n", message );
+   }
+}
+
+static void read_timings( struct run* run, const char* json ) {
+   const char* phases = strstr( json, "\"phases_us\"" );
+   for ( int i = 0; i < PHASE_TOTAL; ++i ) {
+      run->phase_ms[ i ] = read_number( phases, g_phase_names[ i ] ) / 1000;
+   }
+   run->tokens = read_number( strstr( json, "\"tokens\"" ), "lexed" );
+   run->peak_alloc = read_number( strstr( json, "\"memory\"" ), "peak" );
+   run->reported = true;
+}
+
+static double read_number( const char* json, const char* key ) {
+   char quoted_key[ 64 ];
+   snprintf( quoted_key, sizeof( quoted_key ), "\"%s\":", key );
+   const char* value = json ? strstr( json, quoted_key ) : NULL;
+   if ( ! value ) {
+      return 0;
+   }
+   return strtod( value + strlen( quoted_key ), NULL );
+}
+
+static double get_time_ms( void ) {
+#if defined( _WIN32 ) || defined( _WIN64 )
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+   QueryPerformanceFrequency( &frequency );
+   QueryPerformanceCounter( &counter );
+   return ( double ) counter.QuadPart * 1000 / frequency.QuadPart;
+#else
+   struct timespec time;
+   clock_gettime( CLOCK_MONOTONIC, &time );
+   return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+#endif
+}
+
+static double get_peak_rss_kb( void ) {
+#if defined( _WIN32 ) || defined( _WIN64 )
+   PROCESS_MEMORY_COUNTERS counters;
+   if ( GetProcessMemoryInfo( GetCurrentProcess(), &counters,
+      sizeof( counters ) ) ) {
+      return counters.PeakWorkingSetSize / 1024.0;
+   }
+   return 0;
+#else
+   struct rusage usage;
+   if ( getrusage( RUSAGE_SELF, &usage ) != 0 ) {
+      return 0;
+   }
+#   ifdef __APPLE__
+   return usage.ru_maxrss / 1024.0;
+#   else
+   return usage.ru_maxrss;
+#   endif
+#endif
+}
+
+static int compare_runs( const void* a, const void* b ) {
+   double left = ( ( const struct run* ) a )->total_ms;
+   double right = ( ( const struct run* ) b )->total_ms;
+   return ( left > right ) - ( left < right );
+}
+
+static bool emit_corpus( const struct corpus* corpus, const char* dir ) {
+   for ( int i = 0; i < corpus->file_count; ++i ) {
+      char path[ 4096 ];
+      snprintf( path, sizeof( path ), "%s/%s", dir, corpus->files[ i ].name );
+      FILE* fh = fopen( path, "wb" );
+      if ( ! fh ) {
+         fprintf( stderr, "error: failed to create %s\n", path );
+         return false;
+      }
+      fwrite( corpus->files[ i ].data, 1, corpus->files[ i ].size, fh );
+      fclose( fh );
+   }
+   return true;
+}
+
+static void print_results( const struct results* results,
+   const struct corpus_params* params, const struct corpus* corpus,
+   int runs ) {
+   size_t size = 0;
+   for ( int i = 0; i < corpus->file_count; ++i ) {
+      size += corpus->files[ i ].size;
+   }
+   printf( "corpus: %d functions, namespace depth %d, %d macros per 100 "
+      "functions, %d strings, %d includes\n", params->funcs, params->ns_depth,
+      params->macro_density, params->strings, params->includes );
+   printf( "        %d lines, %zu bytes\n", corpus->lines, size );
+   printf( "compile time: %.3f ms (median of %d run%s)\n", results->total_ms,
+      runs, runs == 1 ? "" : "s" );
+   printf( "throughput: %.0f lines/s, %.0f tokens/s\n", results->lines_per_s,
+      results->tokens_per_s );
+   printf( "memory: %.0f KB peak RSS, %.0f KB peak allocated\n",
+      results->peak_rss_kb, results->peak_alloc_kb );
+   printf( "phases (timed separately):\n" );
+   for ( int i = 0; i < PHASE_TOTAL; ++i ) {
+      printf( "  %-12s %10.3f ms\n", g_phase_names[ i ],
+         results->phase_ms[ i ] );
+   }
+}
+
+// A saved file has one `<name> <value>` pair per line.
+static bool save_results( const struct results* results, const char* path ) {
+   FILE* fh = fopen( path, "w" );
+   if ( ! fh ) {
+      fprintf( stderr, "error: failed to create %s\n", path );
+      return false;
+   }
+   fprintf( fh, "total_ms %f\n", results->total_ms );
+   fprintf( fh, "lines_per_s %f\n", results->lines_per_s );
+   fprintf( fh, "tokens_per_s %f\n", results->tokens_per_s );
+   fprintf( fh, "peak_rss_kb %f\n", results->peak_rss_kb );
+   fprintf( fh, "peak_alloc_kb %f\n", results->peak_alloc_kb );
+   for ( int i = 0; i < PHASE_TOTAL; ++i ) {
+      fprintf( fh, "%s_ms %f\n", g_phase_names[ i ], results->phase_ms[ i ] );
+   }
+   fclose( fh );
+   return true;
+}
+
+static bool compare_results( const struct results* results,
+   const char* path ) {
+   FILE* fh = fopen( path, "r" );
+   if ( ! fh ) {
+      fprintf( stderr, "error: failed to open %s\n", path );
+      return false;
+   }
+   struct results baseline;
+   memset( &baseline, 0, sizeof( baseline ) );
+   char name[ 64 ];
+   double value;
+   while ( fscanf( fh, "%63s %lf", name, &value ) == 2 ) {
+      if ( strcmp( name, "total_ms" ) == 0 ) {
+         baseline.total_ms = value;
+      }
+      else if ( strcmp( name, "lines_per_s" ) == 0 ) {
+         baseline.lines_per_s = value;
+      }
+      else if ( strcmp( name, "tokens_per_s" ) == 0 ) {
+         baseline.tokens_per_s = value;
+      }
+      else if ( strcmp( name, "peak_rss_kb" ) == 0 ) {
+         baseline.peak_rss_kb = value;
+      }
+      else if ( strcmp( name, "peak_alloc_kb" ) == 0 ) {
+         baseline.peak_alloc_kb = value;
+      }
+      else {
+         for ( int i = 0; i < PHASE_TOTAL; ++i ) {
+            size_t length = strlen( g_phase_names[ i ] );
+            if ( strncmp( name, g_phase_names[ i ], length ) == 0 &&
+               strcmp( name + length, "_ms" ) == 0 ) {
+               baseline.phase_ms[ i ] = value;
+            }
+         }
+      }
+   }
+   fclose( fh );
+   printf( "compared with %s:\n", path );
+   print_change( "compile time", results->total_ms, baseline.total_ms,
+      false );
+   print_change( "lines/s", results->lines_per_s, baseline.lines_per_s,
+      true );
+   print_change( "tokens/s", results->tokens_per_s, baseline.tokens_per_s,
+      true );
+   print_change( "peak RSS", results->peak_rss_kb, baseline.peak_rss_kb,
+      false );
+   print_change( "peak allocated", results->peak_alloc_kb,
+      baseline.peak_alloc_kb, false );
+   for ( int i = 0; i < PHASE_TOTAL; ++i ) {
+      print_change( g_phase_names[ i ], results->phase_ms[ i ],
+         baseline.phase_ms[ i ], false );
+   }
+   return true;
+}
+
+static void print_change( const char* name, double value, double baseline,
+   bool higher_better ) {
+   if ( baseline == 0 ) {
+      printf( "  %-16s %14.3f  (no baseline)\n", name, value );
+      return;
+   }
+   double change = ( value - baseline ) / baseline * 100;
+   bool better = higher_better ? ( change > 0 ) : ( change < 0 );
+   // Changes that round to zero are neither better nor worse.
+   bool unchanged = ( change > -0.05 && change < 0.05 );
+   printf( "  %-16s %14.3f  %+7.1f%%%s\n", name, value, change,
+      unchanged ? "" : better ? " (better)" : " (worse)" );
+}
@@ -0,0 +1,253 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+
+// Corpus generator
+// ==========================================================================
+// Generates a BCS project made of a main file and a number of headers. The
+// functions are spread across the headers, each function nested in the same
+// chain of namespaces. The macros are defined in their own header, which is
+// included first.
+
+struct text {
+   char* data;
+   size_t size;
+   size_t capacity;
+};
+
+static void gen_macros( struct corpus* corpus, int macros );
+static void gen_header( struct corpus* corpus, const struct corpus_params* params,
+   int header, int first_func, int last_func, int macros );
+static void gen_func( struct text* text, const struct corpus_params* params,
+   int func, int first_func, int macros );
+static void gen_main( struct corpus* corpus, const struct corpus_params* params,
+   int macros );
+static void open_namespaces( struct text* text, int depth );
+static void close_namespaces( struct text* text, int depth );
+static void append( struct text* text, const char* format, ... );
+static void add_file( struct corpus* corpus, const char* name,
+   struct text* text );
+static void* xalloc( size_t size );
+
+void corpus_init_params( struct corpus_params* params ) {
+   params->funcs = 1000;
+   params->ns_depth = 2;
+   params->macro_density = 10;
+   params->strings = 200;
+   params->includes = 8;
+}
+
+void corpus_generate( struct corpus* corpus,
+   const struct corpus_params* params ) {
+   corpus->files = xalloc( sizeof( *corpus->files ) *
+      ( params->includes + 2 ) );
+   corpus->file_count = 0;
+   corpus->lines = 0;
+   int macros = params->funcs * params->macro_density / 100;
+   gen_macros( corpus, macros );
+   int headers = params->includes > 0 ? params->includes : 1;
+   int per_header = ( params->funcs + headers - 1 ) / headers;
+   for ( int i = 0; i < params->includes; ++i ) {
+      int first_func = i * per_header;
+      int last_func = first_func + per_header;
+      if ( last_func > params->funcs ) {
+         last_func = params->funcs;
+      }
+      gen_header( corpus, params, i, first_func, last_func, macros );
+   }
+   gen_main( corpus, params, macros );
+}
+
+static void gen_macros( struct corpus* corpus, int macros ) {
+   struct text text = { NULL, 0, 0 };
+   append( &text, "#ifndef BENCH_MACROS_H\n" );
+   append( &text, "#define BENCH_MACROS_H\n" );
+   for ( int i = 0; i < macros; ++i ) {
+      append( &text, "#define MACRO_%d( a, b ) ( ( a ) * %d + ( b ) )\n", i,
+         i % 7 + 1 );
+   }
+   append( &text, "#endif\n" );
+   add_file( corpus, "macros.h.bcs", &text );
+}
+
+static void gen_header( struct corpus* corpus, const struct corpus_params* params,
+   int header, int first_func, int last_func, int macros ) {
+   struct text text = { NULL, 0, 0 };
+   append( &text, "#ifndef BENCH_INC_%d_H\n", header );
+   append( &text, "#define BENCH_INC_%d_H\n", header );
+   append( &text, "\n" );
+   open_namespaces( &text, params->ns_depth );
+   for ( int i = first_func; i < last_func; ++i ) {
+      gen_func( &text, params, i, first_func, macros );
+   }
+   close_namespaces( &text, params->ns_depth );
+   append( &text, "\n#endif\n" );
+   char name[ 32 ];
+   snprintf( name, sizeof( name ), "inc_%d.h.bcs", header );
+   add_file( corpus, name, &text );
+}
+
+static void gen_func( struct text* text, const struct corpus_params* params,
+   int func, int first_func, int macros ) {
+   append( text, "int f%d( int a, int b ) {\n", func );
+   append( text, "   int x = a + b * %d;\n", func % 13 );
+   append( text, "   for ( int i = 0; i < 4; ++i ) {\n" );
+   if ( macros > 0 ) {
+      append( text, "      x += MACRO_%d( i, a );\n", func % macros );
+   }
+   else {
+      append( text, "      x += i * a;\n" );
+   }
+   append( text, "   }\n" );
+   if ( func > first_func ) {
+      append( text, "   if ( x > %d ) {\n", 100 + func % 50 );
+      append( text, "      x -= f%d( a, b - 1 );\n", func - 1 );
+      append( text, "   }\n" );
+   }
+   if ( params->strings > 0 ) {
+      append( text, "   if ( x == %d ) {\n", func );
+      append( text, "      Print( s: \"f%d reached \", d: x );\n", func );
+      append( text, "   }\n" );
+   }
+   append( text, "   return x;\n" );
+   append( text, "}\n\n" );
+}
+
+static void gen_main( struct corpus* corpus, const struct corpus_params* params,
+   int macros ) {
+   struct text text = { NULL, 0, 0 };
+   // Allow more than 256 functions.
+   append( &text, "#nocompact\n\n" );
+   append( &text, "#if 1\n" );
+   if ( macros > 0 ) {
+      append( &text, "#include \"macros.h.bcs\"\n" );
+   }
+   for ( int i = 0; i < params->includes; ++i ) {
+      append( &text, "#include \"inc_%d.h.bcs\"\n", i );
+   }
+   append( &text, "#endif\n\n" );
+   // Without headers, the functions are in the main file.
+   if ( params->includes == 0 && params->funcs > 0 ) {
+      open_namespaces( &text, params->ns_depth );
+      for ( int i = 0; i < params->funcs; ++i ) {
+         gen_func( &text, params, i, 0, macros );
+      }
+      close_namespaces( &text, params->ns_depth );
+      append( &text, "\n" );
+   }
+   if ( params->strings > 0 ) {
+      append( &text, "str strings[] = {\n" );
+      for ( int i = 0; i < params->strings; ++i ) {
+         append( &text, "   \"string number %d\",\n", i );
+      }
+      append( &text, "};\n\n" );
+   }
+   append( &text, "script 1 open {\n" );
+   append( &text, "   int total = 0;\n" );
+   int headers = params->includes > 0 ? params->includes : 1;
+   int per_header = ( params->funcs + headers - 1 ) / headers;
+   for ( int i = 0; i < headers && i * per_header < params->funcs; ++i ) {
+      int last_func = ( i + 1 ) * per_header;
+      if ( last_func > params->funcs ) {
+         last_func = params->funcs;
+      }
+      append( &text, "   total += " );
+      for ( int depth = 0; depth < params->ns_depth; ++depth ) {
+         append( &text, "n%d.", depth );
+      }
+      append( &text, "f%d( total, %d );\n", last_func - 1, i );
+   }
+   if ( params->strings > 0 ) {
+      append( &text, "   Print( s: strings[ total %% %d ] );\n",
+         params->strings );
+   }
+   append( &text, "   Print( d: total );\n" );
+   append( &text, "}\n" );
+   add_file( corpus, "main.bcs", &text );
+}
+
+static void open_namespaces( struct text* text, int depth ) {
+   for ( int i = 0; i < depth; ++i ) {
+      append( text, "namespace n%d {\n", i );
+   }
+   if ( depth > 0 ) {
+      append( text, "\n" );
+   }
+}
+
+static void close_namespaces( struct text* text, int depth ) {
+   for ( int i = 0; i < depth; ++i ) {
+      append( text, "}\n" );
+   }
+}
+
+static void append( struct text* text, const char* format, ... ) {
+   va_list args;
+   va_start( args, format );
+   va_list args_copy;
+   va_copy( args_copy, args );
+   int length = vsnprintf( NULL, 0, format, args );
+   va_end( args );
+   if ( text->size + length + 1 > text->capacity ) {
+      size_t capacity = text->capacity ? text->capacity * 2 : 4096;
+      while ( text->size + length + 1 > capacity ) {
+         capacity *= 2;
+      }
+      text->data = realloc( text->data, capacity );
+      if ( ! text->data ) {
+         fprintf( stderr, "error: out of memory\n" );
+         exit( EXIT_FAILURE );
+      }
+      text->capacity = capacity;
+   }
+   vsnprintf( text->data + text->size, length + 1, format, args_copy );
+   va_end( args_copy );
+   text->size += length;
+}
+
+static void add_file( struct corpus* corpus, const char* name,
+   struct text* text ) {
+   struct corpus_file* file = &corpus->files[ corpus->file_count ];
+   file->name = xalloc( strlen( name ) + 1 );
+   strcpy( file->name, name );
+   file->data = text->data;
+   file->size = text->size;
+   for ( size_t i = 0; i < text->size; ++i ) {
+      if ( text->data[ i ] == '\n' ) {
+         ++corpus->lines;
+      }
+   }
+   ++corpus->file_count;
+}
+
+static void* xalloc( size_t size ) {
+   void* block = malloc( size );
+   if ( ! block ) {
+      fprintf( stderr, "error: out of memory\n" );
+      exit( EXIT_FAILURE );
+   }
+   return block;
+}
+
+void corpus_free( struct corpus* corpus ) {
+   for ( int i = 0; i < corpus->file_count; ++i ) {
+      free( corpus->files[ i ].name );
+      free( corpus->files[ i ].data );
+   }
+   free( corpus->files );
+   corpus->files = NULL;
+   corpus->file_count = 0;
+}
+
+const struct corpus_file* corpus_find( const struct corpus* corpus,
+   const char* name ) {
+   for ( int i = 0; i < corpus->file_count; ++i ) {
+      if ( strcmp( corpus->files[ i ].name, name ) == 0 ) {
+         return &corpus->files[ i ];
+      }
+   }
+   return NULL;
+}
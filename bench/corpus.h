@@ -0,0 +1,38 @@
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <stddef.h>
+
+// Parameters of a generated corpus.
+struct corpus_params {
+   int funcs;
+   // Number of namespaces each function is nested in.
+   int ns_depth;
+   // Number of macros defined, and used, per 100 functions.
+   int macro_density;
+   int strings;
+   // Number of header files #included by the main file. The functions are
+   // spread across the headers.
+   int includes;
+};
+
+struct corpus_file {
+   char* name;
+   char* data;
+   size_t size;
+};
+
+struct corpus {
+   struct corpus_file* files;
+   int file_count;
+   // Lines of all files.
+   int lines;
+};
+
+void corpus_init_params( struct corpus_params* params );
+void corpus_generate( struct corpus* corpus, const struct corpus_params* params );
+void corpus_free( struct corpus* corpus );
+const struct corpus_file* corpus_find( const struct corpus* corpus,
+   const char* name );
+
+#endif
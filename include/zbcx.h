@@ -27,6 +27,12 @@ typedef enum _zbcx_Result {
 	zbcx_res_setjmpfail,
 } zbcx_Result;
 
+typedef enum _zbcx_Timings {
+	zbcx_timings_none,
+	zbcx_timings_text,
+	zbcx_timings_json,
+} zbcx_Timings;
+
 typedef struct _zbcx_Pos {
     int line;
     int column;
@@ -96,12 +102,30 @@ typedef struct _zbcx_Options {
 	zbcx_List defines;
 	zbcx_List library_links;
 	int tab_size;
+	/// Level of optional optimizations applied to the object file.
+	/// Zero, the default, leaves the output as the code was written.
+	/// Level 1 enables layout optimizations such as the compacted string table.
+	/// Level 2 also moves invariant computations out of loops and replaces
+	/// offsets scaled by a loop counter with running offsets.
+	int opt_level;
 	bool acc_err;
 	bool acc_stats;
 	bool one_column;
 	bool preprocess;
 	bool write_asserts;
 	bool slade_mode;
+	/// When set, a report is passed to `diag` after a successful compilation:
+	/// the wall time of each phase, the number of tokens, the number of
+	/// semantic passes, the memory allocated, and the cache hits and misses.
+	/// `zbcx_timings_json` gives the report as a single JSON object, for
+	/// tracking compiler performance across builds. Lexing and preprocessing
+	/// are timed per token, which slows down those phases while timing.
+	zbcx_Timings timings;
+	/// When set, the memory used only for reading the source files (the
+	/// macros, the tokens and the file buffers) is freed once parsing is
+	/// done, before the later phases allocate theirs. This lowers the peak
+	/// memory use of a compilation, at the cost of the time spent freeing.
+	bool low_memory;
 
 	/// The given `va_list` should not be freed by the caller.
 	void (*diag)(void* context, int flags, va_list* args);
@@ -116,6 +140,8 @@ typedef struct _zbcx_Options {
 	zbcx_Io (*fopen)(void* context, const char* filename, const char* modes);
 
 	/// Where the finalized bytecode object will be written.
+	/// With `preprocess`, receives the preprocessed source instead, which is
+	/// written to the standard output when no stream is given.
 	zbcx_Io output;
 
 	struct {
@@ -124,6 +150,12 @@ typedef struct _zbcx_Options {
     	bool enable;
     	bool print;
     	bool clear;
+    	/// Path of a header to precompile. When the main source file
+    	/// #includes this header, the tokens it produces and the macros it
+    	/// defines are stored in the cache directory, and later compilations
+    	/// with the same header contents and `defines` reuse them.
+    	/// Requires `enable`.
+    	const char* pch_header;
 	} cache;
 } zbcx_Options;
 
@@ -132,6 +164,21 @@ void zbcx_options_deinit(zbcx_Options*);
 
 zbcx_Result zbcx_compile(const zbcx_Options*);
 
+/// A session for compiling the same project repeatedly, such as from an editor
+/// or a hot-reload loop. The cache is always enabled for compilations in a
+/// session, and its files are kept in the memory of the session instead of
+/// in `cache.dir_path`, so imported libraries are restored without being
+/// parsed again. A library is still invalidated as soon as the contents of
+/// one of the files it was compiled from change.
+/// As with `zbcx_compile`, the lists in the options are freed at the end of a
+/// compilation, so they need to be filled again for the next compilation.
+typedef struct _zbcx_Session zbcx_Session;
+
+/// Returns null when out of memory.
+zbcx_Session* zbcx_session_create(void);
+void zbcx_session_destroy(zbcx_Session*);
+zbcx_Result zbcx_session_compile(zbcx_Session*, const zbcx_Options*);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,6 @@
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "task.h"
 #include "codegen/pcode.h"
@@ -17,8 +19,11 @@ struct setup {
    const char* format;
 };
 
+static void init_index( void );
+static int compare_entries( const void* a, const void* b );
+static int find_entry( const char* name );
 static void init_setup( struct setup* setup, struct task* task );
-static void setup_func( struct setup* setup, int entry );
+static void setup_func( struct setup* setup, int entry, struct name* name );
 static void setup_return_type( struct setup* setup );
 static void setup_param_list( struct setup* setup );
 static void setup_default_value( struct setup* setup, struct param* param,
@@ -337,18 +342,71 @@ enum {
    BOUND_FORMAT = BOUND_DED + ARRAY_SIZE( g_formats )
 };
 
+// The entries of `g_funcs`, sorted by name. The index is the same for every
+// task, so it is created only once.
+static struct {
+   int entries[ ARRAY_SIZE( g_funcs ) ];
+   bool created;
+} g_index;
+
+// Nothing is allocated for the builtin functions here. A builtin function is
+// set up only when its name is first looked up in the upmost namespace, so a
+// task pays only for the builtin functions it refers to.
 void t_create_builtins( struct task* task ) {
-   struct setup setup;
-   init_setup( &setup, task );
    enum { TOTAL_IMPLS =
       ARRAY_SIZE( g_deds ) +
       ARRAY_SIZE( g_formats ) +
       ARRAY_SIZE( g_interns ) };
    STATIC_ASSERT( ARRAY_SIZE( g_funcs ) == TOTAL_IMPLS,
       builtin_function_declarations_not_equal_implementations );
-	  
+   if ( ! g_index.created ) {
+      init_index();
+   }
+   task->upmost_ns->builtin_task = task;
+}
+
+static void init_index( void ) {
    for ( int entry = 0; entry < ARRAY_SIZE( g_funcs ); ++entry ) {
-      setup_func( &setup, entry );
+      g_index.entries[ entry ] = entry;
+   }
+   qsort( g_index.entries, ARRAY_SIZE( g_funcs ), sizeof( int ),
+      compare_entries );
+   g_index.created = true;
+}
+
+static int compare_entries( const void* a, const void* b ) {
+   return strcmp( g_funcs[ *( const int* ) a ].name,
+      g_funcs[ *( const int* ) b ].name );
+}
+
+static int find_entry( const char* name ) {
+   int low = 0;
+   int high = ARRAY_SIZE( g_funcs );
+   while ( low < high ) {
+      int middle = low + ( high - low ) / 2;
+      int entry = g_index.entries[ middle ];
+      int result = strcmp( name, g_funcs[ entry ].name );
+      if ( result == 0 ) {
+         return entry;
+      }
+      else if ( result < 0 ) {
+         high = middle;
+      }
+      else {
+         low = middle + 1;
+      }
+   }
+   return -1;
+}
+
+void t_bind_builtin( struct ns* ns, struct name* name, const char* text ) {
+   if ( ns->builtin_task ) {
+      int entry = find_entry( text );
+      if ( entry >= 0 ) {
+         struct setup setup;
+         init_setup( &setup, ns->builtin_task );
+         setup_func( &setup, entry, name );
+      }
    }
 }
 
@@ -361,12 +419,11 @@ static void init_setup( struct setup* setup, struct task* task ) {
    setup->format = NULL;
 }
 
-static void setup_func( struct setup* setup, int entry ) {
+static void setup_func( struct setup* setup, int entry, struct name* name ) {
    struct func* func = t_alloc_func();
    t_init_pos_id( &func->object.pos, INTERNALFILE_COMPILER );
    func->object.resolved = true;
-   func->name = t_extend_name( t_extend_name( setup->task->root_name, "." ),
-      g_funcs[ entry ].name );
+   func->name = name;
    func->name->object = &func->object;
    // Dedicated function.
    if ( entry < BOUND_DED ) {
@@ -482,7 +539,7 @@ static void setup_default_value( struct setup* setup, struct param* param,
 static void setup_empty_string_default_value( struct setup* setup,
    struct param* param ) {
    if ( ! setup->empty_string_expr ) {
-      struct indexed_string* string = t_intern_string( setup->task, "", 0 );
+      struct indexed_string* string = setup->task->empty_string;
       struct indexed_string_usage* usage = t_alloc_indexed_string_usage();
       usage->string = string;
       struct expr* expr = t_alloc_expr();
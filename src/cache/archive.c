@@ -16,8 +16,10 @@ enum {
    F_DEPENDENCY,
    F_END,
    F_ENTRY,
+   F_HASH,
    F_ID,
    F_PATH,
+   F_SIZE,
 };
 
 struct saver {
@@ -67,6 +69,8 @@ static void save_dependency_list( struct saver* saver,
    while ( dep ) {
       WF( saver, F_DEPENDENCY );
       WS( saver, F_PATH, dep->path.value );
+      WV( saver, F_HASH, &dep->hash );
+      WV( saver, F_SIZE, &dep->size );
       WF( saver, F_END );
       dep = dep->next;
    }
@@ -138,6 +142,8 @@ static void restore_dependency( struct restorer* restorer,
    RF( restorer, F_DEPENDENCY );
    struct cache_dependency* dep = cache_alloc_dependency( restorer->cache,
       RS( restorer, F_PATH ) );
+   RV( restorer, F_HASH, &dep->hash );
+   RV( restorer, F_SIZE, &dep->size );
    cache_append_dependency( entry, dep );
    RF( restorer, F_END );
 }
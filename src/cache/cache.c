@@ -8,6 +8,8 @@
 // Default lifetime: 24 hours.
 enum { DEFAULT_LIFETIME = 24 };
 
+enum { READ_SIZE = 65536 };
+
 // NOTE: The order of the fields is important. Add a new field only to the
 // bottom of the enumeration.
 enum {
@@ -19,9 +21,13 @@ enum {
 struct restore_request {
    struct str* path;
    struct library* lib;
+   struct pch* pch;
+   struct cache_object* object;
    enum {
       RESTORE_ARCHIVE,
       RESTORE_LIB,
+      RESTORE_PCH,
+      RESTORE_OBJECT,
    } type;
 };
 
@@ -40,8 +46,9 @@ static int generate_id( struct cache* cache );
 static void append_entry_sorted( struct cache_entry_list* entries,
    struct cache_entry* entry );
 static struct cache_entry* find_entry( struct cache* cache, const char* path );
-static bool timestamp_entry( struct cache_entry* entry );
-static bool fresh_entry( struct cache_entry* entry );
+static void hash_dependency( struct cache* cache,
+   struct cache_dependency* dep );
+static bool fresh_entry( struct cache* cache, struct cache_entry* entry );
 static bool restore_lib( struct cache* cache, struct cache_entry* entry );
 static void append_entry_path( struct cache* cache, struct cache_entry* entry,
    struct str* path );
@@ -54,6 +61,14 @@ static void save_cache( struct cache* cache );
 static void save_lib( struct cache* cache, struct cache_entry* entry );
 static void save_header( struct cache* cache, struct field_writer* writer );
 static void save_archive( struct cache* cache );
+static void append_pch_path( struct cache* cache, const char* header_path,
+   struct str* path );
+static bool fresh_pch( struct pch* pch, const char* path, const char* key );
+static bool append_object_path( struct cache* cache, struct str* path );
+static void read_cache_file( struct cache* cache, const char* path,
+   struct file_contents* contents );
+static bool write_cache_file( struct cache* cache, const char* path );
+static void delete_cache_file( struct cache* cache, const char* path );
 static void print_entry( struct cache* cache, struct cache_entry* entry );
 static void print_lifetime( struct cache* cache, struct cache_entry* entry );
 
@@ -66,6 +81,7 @@ void cache_init( struct cache* cache, struct task* task ) {
    init_cache_entry_list( &cache->removed_entries );
    cache->free_dependencies = NULL;
    cache->buffer = NULL;
+   cache->store = NULL;
    if ( task->options->cache.lifetime >= 0 ) {
       cache->lifetime = task->options->cache.lifetime;
    }
@@ -109,6 +125,11 @@ static void prepare_dir( struct cache* cache ) {
       str_append( &cache->dir_path, cache->task->options->cache.dir_path );
       fs_strip_trailing_pathsep( &cache->dir_path );
    }
+   // Files kept in memory are still named after a directory, but the
+   // directory is not needed.
+   else if ( cache->store ) {
+      str_append( &cache->dir_path, "bcc_cache" );
+   }
    else {
       prepare_tempdir( cache );
    }
@@ -152,12 +173,14 @@ static void init_restore_request( struct restore_request* request, int type,
    struct str* path ) {
    request->path = path;
    request->lib = NULL;
+   request->pch = NULL;
+   request->object = NULL;
    request->type = type;
 }
 
 static void restore( struct cache* cache, struct restore_request* request ) {
    struct file_contents contents;
-   fs_get_file_contents( request->path->value, &contents );
+   read_cache_file( cache, request->path->value, &contents );
    if ( ! contents.obtained ) {
       if ( contents.err != ENOENT ) {
          t_diag( cache->task, DIAG_ERR,
@@ -179,7 +202,11 @@ static void restore( struct cache* cache, struct restore_request* request ) {
          request->path->value, reader.expected_field, reader.field );
       t_bail( cache->task );
    }
-   mem_free( contents.data );
+   // The strings of a precompiled header and the kept object point into the
+   // data.
+   if ( ! ( request->pch || request->object ) ) {
+      mem_free( contents.data );
+   }
 }
 
 static void restore_file( struct cache* cache,
@@ -197,6 +224,12 @@ static void restore_file( struct cache* cache,
    case RESTORE_LIB:
       request->lib = cache_restore_lib( cache, reader );
       break;
+   case RESTORE_PCH:
+      request->pch = cache_restore_pch( reader );
+      break;
+   case RESTORE_OBJECT:
+      request->object = cache_restore_object( reader );
+      break;
    default:
       UNREACHABLE();
    }
@@ -225,6 +258,7 @@ void cache_add( struct cache* cache, struct library* lib ) {
       struct file_entry* file = zbcx_list_data( &i );
       struct cache_dependency* dep = cache_alloc_dependency( cache,
          file->full_path.value );
+      hash_dependency( cache, dep );
       cache_append_dependency( entry, dep );
       zbcx_list_next( &i );
    }
@@ -243,6 +277,7 @@ void cache_add( struct cache* cache, struct library* lib ) {
       }
       struct cache_dependency* dep = cache_alloc_dependency( cache,
          query.file->full_path.value );
+      hash_dependency( cache, dep );
       cache_append_dependency( entry, dep );
       zbcx_list_next( &i );
    }
@@ -251,6 +286,16 @@ void cache_add( struct cache* cache, struct library* lib ) {
    entry->modified = true;
 }
 
+// A file that cannot be read is given a size that no file can have, so the
+// library is never restored.
+static void hash_dependency( struct cache* cache,
+   struct cache_dependency* dep ) {
+   if ( ! cache_hash_file( cache->task, dep->path.value, &dep->hash,
+      &dep->size ) ) {
+      dep->size = ( size_t ) -1;
+   }
+}
+
 struct cache_entry* cache_alloc_entry( void ) {
    struct cache_entry* entry = mem_alloc( sizeof( *entry ) );
    entry->next = NULL;
@@ -323,7 +368,8 @@ struct cache_dependency* cache_alloc_dependency( struct cache* cache,
    }
    dep->next = NULL;
    str_append( &dep->path, path );
-   dep->mtime = 0;
+   dep->hash = 0;
+   dep->size = 0;
    return dep;
 }
 
@@ -349,7 +395,7 @@ struct library* cache_get( struct cache* cache, struct file_entry* file ) {
    }
    // Load only once the contents of a cached library.
    if ( ! entry->lib ) {
-      if ( timestamp_entry( entry ) && fresh_entry( entry ) &&
+      if ( fresh_entry( cache, entry ) &&
          restore_lib( cache, entry ) ) {
          entry->lib->file = file;
       }
@@ -366,27 +412,48 @@ static struct cache_entry* find_entry( struct cache* cache,
    return entry;
 }
 
-static bool timestamp_entry( struct cache_entry* entry ) {
+// A file edited within the same second as the compilation still has an older
+// modification time, so the contents of the files are compared instead.
+static bool fresh_entry( struct cache* cache, struct cache_entry* entry ) {
    struct cache_dependency* dep = entry->dependency;
    while ( dep ) {
-      struct fs_query query;
-      fs_init_query( &query, dep->path.value );
-      struct fs_timestamp timestamp;
-      if ( ! fs_get_mtime( &query, &timestamp ) ) {
+      unsigned long long hash = 0;
+      size_t size = 0;
+      if ( ! ( cache_hash_file( cache->task, dep->path.value, &hash,
+         &size ) && size == dep->size && hash == dep->hash ) ) {
          return false;
       }
-      dep->mtime = timestamp.value;
       dep = dep->next;
    }
    return true;
 }
 
-static bool fresh_entry( struct cache_entry* entry ) {
-   struct cache_dependency* dep = entry->dependency;
-   while ( dep && dep->mtime <= entry->compile_time ) {
-      dep = dep->next;
+// The file is read the same way as a source file, through the `fopen` option.
+bool cache_hash_file( struct task* task, const char* path,
+   unsigned long long* hash, size_t* size ) {
+   zbcx_Io fh = task->options->fopen( task->options->context, path, "rb" );
+   if ( ! fh.vtable ) {
+      return false;
+   }
+   char* buffer = mem_alloc( READ_SIZE );
+   unsigned long long value = 14695981039346656037ull;
+   size_t total = 0;
+   while ( true ) {
+      size_t count = fh.vtable->read( buffer, 1, READ_SIZE, fh.state );
+      for ( size_t i = 0; i < count; ++i ) {
+         value = ( value ^ ( unsigned char ) buffer[ i ] ) * 1099511628211ull;
+      }
+      total += count;
+      if ( count < READ_SIZE ) {
+         break;
+      }
    }
-   return ( dep == NULL );
+   bool failed = ( fh.vtable->error( fh.state ) != 0 );
+   fh.vtable->close( fh.state );
+   mem_free( buffer );
+   *hash = value;
+   *size = total;
+   return ( ! failed );
 }
 
 static bool restore_lib( struct cache* cache, struct cache_entry* entry ) {
@@ -485,7 +552,7 @@ static void save_cache( struct cache* cache ) {
       str_init( &path );
       append_entry_path( cache, entry, &path );
       // TODO: Check for file errors.
-      fs_delete_file( path.value );
+      delete_cache_file( cache, path.value );
       archive_updated = true;
       str_deinit( &path );
       entry = entry->next;
@@ -515,7 +582,7 @@ static void save_lib( struct cache* cache, struct cache_entry* entry ) {
    str_init( &path );
    append_entry_path( cache, entry, &path );
    // TODO: Check for file errors.
-   gbuf_save( &cache->task->growing_buffer, path.value );
+   write_cache_file( cache, path.value );
    entry->modified = false;
    str_deinit( &path );
 }
@@ -536,8 +603,165 @@ static void save_archive( struct cache* cache ) {
    str_init( &path );
    append_archive_path( cache, &path );
    // TODO: Check for file errors.
-   gbuf_save( &cache->task->growing_buffer, path.value );
+   write_cache_file( cache, path.value );
+   str_deinit( &path );
+}
+
+// Returns the precompiled form of the specified header, but only when it was
+// created with the same key and none of the files it depends on have changed
+// since.
+struct pch* cache_get_pch( struct cache* cache, const char* path,
+   const char* key ) {
+   struct str pch_path;
+   str_init( &pch_path );
+   append_pch_path( cache, path, &pch_path );
+   struct restore_request request;
+   init_restore_request( &request, RESTORE_PCH, &pch_path );
+   restore( cache, &request );
+   str_deinit( &pch_path );
+   if ( request.pch && ! fresh_pch( request.pch, path, key ) ) {
+      request.pch = NULL;
+   }
+   return request.pch;
+}
+
+static void append_pch_path( struct cache* cache, const char* header_path,
+   struct str* path ) {
+   str_append( path, cache->dir_path.value );
+   str_append( path, OS_PATHSEP );
+   str_append( path, "pch" );
+   char id[ 17 ];
+   snprintf( id, sizeof( id ), "%016llx",
+      cache_hash_contents( header_path, strlen( header_path ) ) );
+   str_append( path, id );
+   str_append( path, ".o" );
+}
+
+static bool fresh_pch( struct pch* pch, const char* path, const char* key ) {
+   if ( strcmp( pch->path, path ) != 0 || strcmp( pch->key, key ) != 0 ) {
+      return false;
+   }
+   zbcx_ListIter i;
+   zbcx_list_iterate( &pch->files, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_file* file = zbcx_list_data( &i );
+      struct file_contents contents;
+      fs_get_file_contents( file->path, &contents );
+      if ( ! contents.obtained ) {
+         return false;
+      }
+      bool same = ( contents.size == file->size &&
+         cache_hash_contents( contents.data, contents.size ) == file->hash );
+      mem_free( contents.data );
+      if ( ! same ) {
+         return false;
+      }
+      zbcx_list_next( &i );
+   }
+   return true;
+}
+
+void cache_add_pch( struct cache* cache, struct pch* pch ) {
+   struct field_writer writer;
+   gbuf_reset( &cache->task->growing_buffer );
+   f_init_writer( &writer, &cache->task->growing_buffer );
+   save_header( cache, &writer );
+   cache_save_pch( &writer, pch );
+   struct str path;
+   str_init( &path );
+   append_pch_path( cache, pch->path, &path );
+   // TODO: Check for file errors.
+   write_cache_file( cache, path.value );
+   str_deinit( &path );
+}
+
+// Returns the kept object of the main library, but only within a session, and
+// only when nothing the object was compiled from has changed.
+struct cache_object* cache_get_object( struct cache* cache ) {
+   if ( ! cache->store ) {
+      return NULL;
+   }
+   struct str path;
+   str_init( &path );
+   struct restore_request request;
+   init_restore_request( &request, RESTORE_OBJECT, &path );
+   if ( append_object_path( cache, &path ) ) {
+      restore( cache, &request );
+   }
    str_deinit( &path );
+   if ( request.object &&
+      ! cache_fresh_object( cache->task, request.object ) ) {
+      request.object = NULL;
+   }
+   return request.object;
+}
+
+// The object is named after the full path of the source file.
+static bool append_object_path( struct cache* cache, struct str* path ) {
+   struct file_query query;
+   t_init_file_query( &query, NULL, cache->task->options->source_file );
+   t_find_file( cache->task, &query );
+   if ( ! query.file ) {
+      return false;
+   }
+   const char* source_file = query.file->full_path.value;
+   str_append( path, cache->dir_path.value );
+   str_append( path, OS_PATHSEP );
+   str_append( path, "obj" );
+   char id[ 17 ];
+   snprintf( id, sizeof( id ), "%016llx",
+      cache_hash_contents( source_file, strlen( source_file ) ) );
+   str_append( path, id );
+   str_append( path, ".o" );
+   return true;
+}
+
+void cache_add_object( struct cache* cache, struct gbuf* object ) {
+   if ( ! cache->store ) {
+      return;
+   }
+   struct field_writer writer;
+   gbuf_reset( &cache->task->growing_buffer );
+   f_init_writer( &writer, &cache->task->growing_buffer );
+   save_header( cache, &writer );
+   cache_save_object( cache, &writer, object );
+   struct str path;
+   str_init( &path );
+   if ( append_object_path( cache, &path ) ) {
+      // TODO: Check for file errors.
+      write_cache_file( cache, path.value );
+   }
+   str_deinit( &path );
+}
+
+static void read_cache_file( struct cache* cache, const char* path,
+   struct file_contents* contents ) {
+   if ( cache->store ) {
+      cache_read_stored_file( cache->store, path, contents );
+   }
+   else {
+      fs_get_file_contents( path, contents );
+   }
+}
+
+// Writes the contents of the growing buffer.
+static bool write_cache_file( struct cache* cache, const char* path ) {
+   if ( cache->store ) {
+      return cache_write_stored_file( cache->store, path,
+         &cache->task->growing_buffer );
+   }
+   else {
+      return gbuf_save( &cache->task->growing_buffer, path );
+   }
+}
+
+static void delete_cache_file( struct cache* cache, const char* path ) {
+   if ( cache->store ) {
+      cache_delete_stored_file( cache->store, path );
+   }
+   else {
+      fs_delete_file( path );
+   }
 }
 
 void cache_print( struct cache* cache ) {
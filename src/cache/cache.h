@@ -16,10 +16,13 @@ struct cache_entry {
    bool modified;
 };
 
+// The library is restored only when every file it was compiled from still has
+// the same contents.
 struct cache_dependency {
    struct cache_dependency* next;
    struct str path;
-   time_t mtime;
+   unsigned long long hash;
+   size_t size;
 };
 
 struct cache_entry_list {
@@ -27,6 +30,91 @@ struct cache_entry_list {
    struct cache_entry* tail;
 };
 
+// A precompiled header holds the tokens that an #included header produces for
+// the parser, and the preprocessor state left behind by the header.
+struct pch_token {
+   const char* text;
+   struct pos pos;
+   int type;
+   int length;
+};
+
+struct pch_token_list {
+   struct pch_token* tokens;
+   int count;
+   int capacity;
+};
+
+struct pch_macro {
+   const char* name;
+   zbcx_List params;
+   struct pch_token_list body;
+   struct pos pos;
+   bool func_like;
+   bool variadic;
+};
+
+// A file read while the header was processed. The contents of the file are
+// compared against the hash before the precompiled header is used.
+struct pch_file {
+   const char* path;
+   const char* guard_macro;
+   unsigned long long hash;
+   size_t size;
+   bool once;
+};
+
+// An include-history entry created while the header was processed. The parent
+// is an index into the list of entries, or -1 for the entry of the file that
+// #included the header.
+struct pch_include {
+   const char* altern_name;
+   int parent;
+   int file;
+   int line;
+};
+
+struct pch {
+   const char* path;
+   // Describes the options and preprocessor state the header was compiled
+   // with.
+   const char* key;
+   zbcx_List files;
+   zbcx_List includes;
+   zbcx_List macros;
+   struct pch_token_list tokens;
+   int lines;
+   bool raw_define;
+   bool raw_include;
+};
+
+// Within a session, the object of the main library is kept together with the
+// options it was compiled with and the files found while compiling it.
+struct cache_object {
+   const char* key;
+   zbcx_List files;
+   const char* data;
+   size_t size;
+};
+
+struct cache_object_file {
+   const char* path;
+   unsigned long long hash;
+   size_t size;
+};
+
+// Files of the cache kept in memory.
+struct cache_stored_file {
+   struct cache_stored_file* next;
+   char* path;
+   char* data;
+   size_t size;
+};
+
+struct cache_store {
+   struct cache_stored_file* head;
+};
+
 struct cache {
    struct task* task;
    struct str dir_path;
@@ -35,6 +123,9 @@ struct cache {
    struct cache_entry_list removed_entries;
    struct cache_dependency* free_dependencies;
    struct gbuf* buffer;
+   // When present, the files of the cache are kept here instead of in the
+   // cache directory.
+   struct cache_store* store;
    int lifetime;
 };
 
@@ -59,5 +150,29 @@ void cache_save_lib( struct task* task, struct field_writer* writer,
 struct library* cache_restore_lib( struct cache* cache,
    struct field_reader* reader );
 void cache_print( struct cache* cache );
+struct pch* cache_get_pch( struct cache* cache, const char* path,
+   const char* key );
+void cache_add_pch( struct cache* cache, struct pch* pch );
+void cache_save_pch( struct field_writer* writer, struct pch* pch );
+struct pch* cache_restore_pch( struct field_reader* reader );
+struct pch* cache_alloc_pch( void );
+void cache_append_pch_token( struct pch_token_list* list,
+   struct pch_token* token );
+unsigned long long cache_hash_contents( const char* data, size_t size );
+bool cache_hash_file( struct task* task, const char* path,
+   unsigned long long* hash, size_t* size );
+struct cache_object* cache_get_object( struct cache* cache );
+void cache_add_object( struct cache* cache, struct gbuf* object );
+void cache_save_object( struct cache* cache, struct field_writer* writer,
+   struct gbuf* object );
+struct cache_object* cache_restore_object( struct field_reader* reader );
+bool cache_fresh_object( struct task* task, struct cache_object* object );
+void cache_init_store( struct cache_store* store );
+void cache_deinit_store( struct cache_store* store );
+void cache_read_stored_file( struct cache_store* store, const char* path,
+   struct file_contents* contents );
+bool cache_write_stored_file( struct cache_store* store, const char* path,
+   struct gbuf* buffer );
+void cache_delete_stored_file( struct cache_store* store, const char* path );
 
 #endif
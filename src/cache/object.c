@@ -0,0 +1,227 @@
+#include <string.h>
+#include <stdio.h>
+
+#include "cache.h"
+
+// Kept object
+// ==========================================================================
+// The object is reused only when the options are the same and every file found
+// while compiling the main library, including the files of the imported
+// libraries, still has the same contents. The files of a library taken from
+// the cache are saved with the contents the library was compiled from.
+
+#define WF( saver, field ) \
+   f_wf( saver->w, field )
+#define WV( saver, field, value ) \
+   f_wv( saver->w, field, value, sizeof( *( value ) ) )
+#define WS( saver, field, value ) \
+   f_ws( saver->w, field, value )
+
+#define RF( restorer, field ) \
+   f_rf( restorer->r, field )
+#define RV( restorer, field, value ) \
+   f_rv( restorer->r, field, value, sizeof( *( value ) ) )
+#define RS( restorer, field ) \
+   f_rs( restorer->r, field )
+
+enum {
+   F_DATA,
+   F_END,
+   F_FILE,
+   F_HASH,
+   F_KEY,
+   F_OBJECT,
+   F_PATH,
+   F_SIZE,
+};
+
+struct saver {
+   struct field_writer* w;
+   struct cache* cache;
+   struct task* task;
+};
+
+struct restorer {
+   struct field_reader* r;
+   struct cache_object* object;
+};
+
+static void save_object( struct saver* saver, struct gbuf* object );
+static void save_file_list( struct saver* saver );
+static void save_file( struct saver* saver, const char* path,
+   unsigned long long hash, size_t size );
+static void save_data( struct saver* saver, struct gbuf* object );
+static void restore_object( struct restorer* restorer );
+static void restore_file_list( struct restorer* restorer );
+static const char* create_key( struct task* task );
+static void append_list( struct str* key, const char* prefix,
+   const zbcx_List* list );
+static void append_number( struct str* key, const char* prefix, int value );
+
+void cache_save_object( struct cache* cache, struct field_writer* writer,
+   struct gbuf* object ) {
+   struct saver saver;
+   saver.w = writer;
+   saver.cache = cache;
+   saver.task = cache->task;
+   save_object( &saver, object );
+}
+
+static void save_object( struct saver* saver, struct gbuf* object ) {
+   WF( saver, F_OBJECT );
+   WS( saver, F_KEY, create_key( saver->task ) );
+   save_file_list( saver );
+   save_data( saver, object );
+   WF( saver, F_END );
+}
+
+static void save_file_list( struct saver* saver ) {
+   // Libraries used by the compilation.
+   struct cache_entry* entry = saver->cache->entries.head;
+   while ( entry ) {
+      if ( entry->lib ) {
+         struct cache_dependency* dep = entry->dependency;
+         while ( dep ) {
+            save_file( saver, dep->path.value, dep->hash, dep->size );
+            dep = dep->next;
+         }
+      }
+      entry = entry->next;
+   }
+   struct file_entry* file = saver->task->file_entries;
+   while ( file ) {
+      unsigned long long hash = 0;
+      size_t size = 0;
+      // A file that cannot be read is saved with a size that no file can have,
+      // so the object is never reused.
+      if ( ! cache_hash_file( saver->task, file->full_path.value, &hash,
+         &size ) ) {
+         size = ( size_t ) -1;
+      }
+      save_file( saver, file->full_path.value, hash, size );
+      file = file->next;
+   }
+}
+
+static void save_file( struct saver* saver, const char* path,
+   unsigned long long hash, size_t size ) {
+   WF( saver, F_FILE );
+   WS( saver, F_PATH, path );
+   WV( saver, F_HASH, &hash );
+   WV( saver, F_SIZE, &size );
+   WF( saver, F_END );
+}
+
+static void save_data( struct saver* saver, struct gbuf* object ) {
+   size_t size = 0;
+   struct gbuf_seg* segment = object->head_segment;
+   while ( segment ) {
+      size += segment->used;
+      segment = segment->next;
+   }
+   WV( saver, F_SIZE, &size );
+   WF( saver, F_DATA );
+   segment = object->head_segment;
+   while ( segment ) {
+      gbuf_write( saver->w->output, segment->data, segment->used );
+      segment = segment->next;
+   }
+}
+
+// NOTE: The data of the object points into the data being read.
+struct cache_object* cache_restore_object( struct field_reader* reader ) {
+   struct restorer restorer;
+   restorer.r = reader;
+   restorer.object = mem_alloc( sizeof( *restorer.object ) );
+   zbcx_list_init( &restorer.object->files );
+   restore_object( &restorer );
+   return restorer.object;
+}
+
+static void restore_object( struct restorer* restorer ) {
+   RF( restorer, F_OBJECT );
+   restorer->object->key = RS( restorer, F_KEY );
+   restore_file_list( restorer );
+   RV( restorer, F_SIZE, &restorer->object->size );
+   RF( restorer, F_DATA );
+   restorer->object->data = restorer->r->data;
+   restorer->r->data += restorer->object->size;
+   RF( restorer, F_END );
+}
+
+static void restore_file_list( struct restorer* restorer ) {
+   while ( f_peek( restorer->r ) == F_FILE ) {
+      RF( restorer, F_FILE );
+      struct cache_object_file* file = mem_alloc( sizeof( *file ) );
+      file->path = RS( restorer, F_PATH );
+      RV( restorer, F_HASH, &file->hash );
+      RV( restorer, F_SIZE, &file->size );
+      RF( restorer, F_END );
+      zbcx_list_append( &restorer->object->files, file );
+   }
+}
+
+bool cache_fresh_object( struct task* task, struct cache_object* object ) {
+   if ( strcmp( object->key, create_key( task ) ) != 0 ) {
+      return false;
+   }
+   zbcx_ListIter i;
+   zbcx_list_iterate( &object->files, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct cache_object_file* file = zbcx_list_data( &i );
+      unsigned long long hash = 0;
+      size_t size = 0;
+      if ( ! ( cache_hash_file( task, file->path, &hash, &size ) &&
+         size == file->size && hash == file->hash ) ) {
+         return false;
+      }
+      zbcx_list_next( &i );
+   }
+   return true;
+}
+
+// The key holds the options that affect the object.
+static const char* create_key( struct task* task ) {
+   const zbcx_Options* options = task->options;
+   struct str key;
+   str_init( &key );
+   str_append( &key, "S" );
+   str_append( &key, options->source_file );
+   str_append( &key, "\n" );
+   append_list( &key, "I", &options->includes );
+   append_list( &key, "D", &options->defines );
+   append_list( &key, "L", &options->library_links );
+   append_number( &key, "T", options->tab_size );
+   append_number( &key, "O", options->opt_level );
+   append_number( &key, "C", options->one_column );
+   append_number( &key, "A", options->write_asserts );
+   append_number( &key, "W", options->slade_mode );
+   if ( options->cache.pch_header ) {
+      str_append( &key, "P" );
+      str_append( &key, options->cache.pch_header );
+      str_append( &key, "\n" );
+   }
+   const char* value = t_intern_text( task, key.value, key.length );
+   str_deinit( &key );
+   return value;
+}
+
+static void append_list( struct str* key, const char* prefix,
+   const zbcx_List* list ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( list, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      str_append( key, prefix );
+      str_append( key, zbcx_list_data( &i ) );
+      str_append( key, "\n" );
+      zbcx_list_next( &i );
+   }
+}
+
+static void append_number( struct str* key, const char* prefix, int value ) {
+   char text[ 12 ];
+   snprintf( text, sizeof( text ), "%d", value );
+   str_append( key, prefix );
+   str_append( key, text );
+   str_append( key, "\n" );
+}
@@ -0,0 +1,347 @@
+#include <string.h>
+
+#include "cache.h"
+
+// Save
+// ==========================================================================
+
+#define WF( saver, field ) \
+   f_wf( saver->w, field )
+#define WV( saver, field, value ) \
+   f_wv( saver->w, field, value, sizeof( *( value ) ) )
+#define WS( saver, field, value ) \
+   f_ws( saver->w, field, value )
+
+enum {
+   F_ALTERNNAME,
+   F_BODY,
+   F_COLUMN,
+   F_END,
+   F_FILE,
+   F_FUNCLIKE,
+   F_GUARDMACRO,
+   F_HASH,
+   F_ID,
+   F_INCLUDE,
+   F_KEY,
+   F_LENGTH,
+   F_LINE,
+   F_LINES,
+   F_MACRO,
+   F_NAME,
+   F_ONCE,
+   F_PARAM,
+   F_PARENT,
+   F_PATH,
+   F_PCH,
+   F_POS,
+   F_RAWDEFINE,
+   F_RAWINCLUDE,
+   F_SIZE,
+   F_TEXT,
+   F_TOKEN,
+   F_TYPE,
+   F_VARIADIC,
+};
+
+struct saver {
+   struct field_writer* w;
+   struct pch* pch;
+};
+
+static void save_pch( struct saver* saver );
+static void save_file_list( struct saver* saver );
+static void save_include_list( struct saver* saver );
+static void save_macro_list( struct saver* saver );
+static void save_macro( struct saver* saver, struct pch_macro* macro );
+static void save_token_list( struct saver* saver,
+   struct pch_token_list* list );
+static void save_token( struct saver* saver, struct pch_token* token );
+static void save_pos( struct saver* saver, struct pos* pos );
+
+void cache_save_pch( struct field_writer* writer, struct pch* pch ) {
+   struct saver saver;
+   saver.w = writer;
+   saver.pch = pch;
+   save_pch( &saver );
+}
+
+static void save_pch( struct saver* saver ) {
+   WF( saver, F_PCH );
+   WS( saver, F_PATH, saver->pch->path );
+   WS( saver, F_KEY, saver->pch->key );
+   save_file_list( saver );
+   save_include_list( saver );
+   save_macro_list( saver );
+   save_token_list( saver, &saver->pch->tokens );
+   WV( saver, F_LINES, &saver->pch->lines );
+   WV( saver, F_RAWDEFINE, &saver->pch->raw_define );
+   WV( saver, F_RAWINCLUDE, &saver->pch->raw_include );
+   WF( saver, F_END );
+}
+
+static void save_file_list( struct saver* saver ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &saver->pch->files, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_file* file = zbcx_list_data( &i );
+      WF( saver, F_FILE );
+      WS( saver, F_PATH, file->path );
+      if ( file->guard_macro ) {
+         WS( saver, F_GUARDMACRO, file->guard_macro );
+      }
+      WV( saver, F_HASH, &file->hash );
+      WV( saver, F_SIZE, &file->size );
+      WV( saver, F_ONCE, &file->once );
+      WF( saver, F_END );
+      zbcx_list_next( &i );
+   }
+}
+
+static void save_include_list( struct saver* saver ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &saver->pch->includes, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_include* include = zbcx_list_data( &i );
+      WF( saver, F_INCLUDE );
+      if ( include->altern_name ) {
+         WS( saver, F_ALTERNNAME, include->altern_name );
+      }
+      WV( saver, F_PARENT, &include->parent );
+      WV( saver, F_FILE, &include->file );
+      WV( saver, F_LINE, &include->line );
+      WF( saver, F_END );
+      zbcx_list_next( &i );
+   }
+}
+
+static void save_macro_list( struct saver* saver ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &saver->pch->macros, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      save_macro( saver, zbcx_list_data( &i ) );
+      zbcx_list_next( &i );
+   }
+}
+
+static void save_macro( struct saver* saver, struct pch_macro* macro ) {
+   WF( saver, F_MACRO );
+   WS( saver, F_NAME, macro->name );
+   zbcx_ListIter i;
+   zbcx_list_iterate( &macro->params, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      WS( saver, F_PARAM, zbcx_list_data( &i ) );
+      zbcx_list_next( &i );
+   }
+   WF( saver, F_BODY );
+   save_token_list( saver, &macro->body );
+   save_pos( saver, &macro->pos );
+   WV( saver, F_FUNCLIKE, &macro->func_like );
+   WV( saver, F_VARIADIC, &macro->variadic );
+   WF( saver, F_END );
+}
+
+static void save_token_list( struct saver* saver,
+   struct pch_token_list* list ) {
+   for ( int i = 0; i < list->count; ++i ) {
+      save_token( saver, &list->tokens[ i ] );
+   }
+}
+
+static void save_token( struct saver* saver, struct pch_token* token ) {
+   WF( saver, F_TOKEN );
+   WV( saver, F_TYPE, &token->type );
+   if ( token->text ) {
+      WS( saver, F_TEXT, token->text );
+      WV( saver, F_LENGTH, &token->length );
+   }
+   save_pos( saver, &token->pos );
+   WF( saver, F_END );
+}
+
+static void save_pos( struct saver* saver, struct pos* pos ) {
+   WF( saver, F_POS );
+   WV( saver, F_LINE, &pos->line );
+   WV( saver, F_COLUMN, &pos->column );
+   WV( saver, F_ID, &pos->id );
+   WF( saver, F_END );
+}
+
+// Restore
+// ==========================================================================
+
+#define RF( restorer, field ) \
+   f_rf( restorer->r, field )
+#define RV( restorer, field, value ) \
+   f_rv( restorer->r, field, value, sizeof( *( value ) ) )
+#define RS( restorer, field ) \
+   f_rs( restorer->r, field )
+
+struct restorer {
+   struct field_reader* r;
+   struct pch* pch;
+};
+
+static void restore_pch( struct restorer* restorer );
+static void restore_file_list( struct restorer* restorer );
+static void restore_include_list( struct restorer* restorer );
+static void restore_macro_list( struct restorer* restorer );
+static void restore_macro( struct restorer* restorer );
+static void restore_token_list( struct restorer* restorer,
+   struct pch_token_list* list );
+static void restore_token( struct restorer* restorer,
+   struct pch_token_list* list );
+static void restore_pos( struct restorer* restorer, struct pos* pos );
+
+// NOTE: The strings of the restored header point into the data being read, so
+// the data needs to remain available for as long as the header is used.
+struct pch* cache_restore_pch( struct field_reader* reader ) {
+   struct restorer restorer;
+   restorer.r = reader;
+   restorer.pch = cache_alloc_pch();
+   restore_pch( &restorer );
+   return restorer.pch;
+}
+
+static void restore_pch( struct restorer* restorer ) {
+   RF( restorer, F_PCH );
+   restorer->pch->path = RS( restorer, F_PATH );
+   restorer->pch->key = RS( restorer, F_KEY );
+   restore_file_list( restorer );
+   restore_include_list( restorer );
+   restore_macro_list( restorer );
+   restore_token_list( restorer, &restorer->pch->tokens );
+   RV( restorer, F_LINES, &restorer->pch->lines );
+   RV( restorer, F_RAWDEFINE, &restorer->pch->raw_define );
+   RV( restorer, F_RAWINCLUDE, &restorer->pch->raw_include );
+   RF( restorer, F_END );
+}
+
+static void restore_file_list( struct restorer* restorer ) {
+   while ( f_peek( restorer->r ) == F_FILE ) {
+      RF( restorer, F_FILE );
+      struct pch_file* file = mem_alloc( sizeof( *file ) );
+      file->path = RS( restorer, F_PATH );
+      file->guard_macro = NULL;
+      if ( f_peek( restorer->r ) == F_GUARDMACRO ) {
+         file->guard_macro = RS( restorer, F_GUARDMACRO );
+      }
+      RV( restorer, F_HASH, &file->hash );
+      RV( restorer, F_SIZE, &file->size );
+      RV( restorer, F_ONCE, &file->once );
+      RF( restorer, F_END );
+      zbcx_list_append( &restorer->pch->files, file );
+   }
+}
+
+static void restore_include_list( struct restorer* restorer ) {
+   while ( f_peek( restorer->r ) == F_INCLUDE ) {
+      RF( restorer, F_INCLUDE );
+      struct pch_include* include = mem_alloc( sizeof( *include ) );
+      include->altern_name = NULL;
+      if ( f_peek( restorer->r ) == F_ALTERNNAME ) {
+         include->altern_name = RS( restorer, F_ALTERNNAME );
+      }
+      RV( restorer, F_PARENT, &include->parent );
+      RV( restorer, F_FILE, &include->file );
+      RV( restorer, F_LINE, &include->line );
+      RF( restorer, F_END );
+      zbcx_list_append( &restorer->pch->includes, include );
+   }
+}
+
+static void restore_macro_list( struct restorer* restorer ) {
+   while ( f_peek( restorer->r ) == F_MACRO ) {
+      restore_macro( restorer );
+   }
+}
+
+static void restore_macro( struct restorer* restorer ) {
+   RF( restorer, F_MACRO );
+   struct pch_macro* macro = mem_alloc( sizeof( *macro ) );
+   macro->name = RS( restorer, F_NAME );
+   zbcx_list_init( &macro->params );
+   while ( f_peek( restorer->r ) == F_PARAM ) {
+      zbcx_list_append( &macro->params, ( void* ) RS( restorer, F_PARAM ) );
+   }
+   RF( restorer, F_BODY );
+   macro->body.tokens = NULL;
+   macro->body.count = 0;
+   macro->body.capacity = 0;
+   restore_token_list( restorer, &macro->body );
+   restore_pos( restorer, &macro->pos );
+   RV( restorer, F_FUNCLIKE, &macro->func_like );
+   RV( restorer, F_VARIADIC, &macro->variadic );
+   RF( restorer, F_END );
+   zbcx_list_append( &restorer->pch->macros, macro );
+}
+
+static void restore_token_list( struct restorer* restorer,
+   struct pch_token_list* list ) {
+   while ( f_peek( restorer->r ) == F_TOKEN ) {
+      restore_token( restorer, list );
+   }
+}
+
+static void restore_token( struct restorer* restorer,
+   struct pch_token_list* list ) {
+   RF( restorer, F_TOKEN );
+   struct pch_token token;
+   RV( restorer, F_TYPE, &token.type );
+   token.text = NULL;
+   token.length = 0;
+   if ( f_peek( restorer->r ) == F_TEXT ) {
+      token.text = RS( restorer, F_TEXT );
+      RV( restorer, F_LENGTH, &token.length );
+   }
+   restore_pos( restorer, &token.pos );
+   RF( restorer, F_END );
+   cache_append_pch_token( list, &token );
+}
+
+static void restore_pos( struct restorer* restorer, struct pos* pos ) {
+   RF( restorer, F_POS );
+   RV( restorer, F_LINE, &pos->line );
+   RV( restorer, F_COLUMN, &pos->column );
+   RV( restorer, F_ID, &pos->id );
+   RF( restorer, F_END );
+}
+
+// Common
+// ==========================================================================
+
+struct pch* cache_alloc_pch( void ) {
+   struct pch* pch = mem_alloc( sizeof( *pch ) );
+   pch->path = NULL;
+   pch->key = NULL;
+   zbcx_list_init( &pch->files );
+   zbcx_list_init( &pch->includes );
+   zbcx_list_init( &pch->macros );
+   pch->tokens.tokens = NULL;
+   pch->tokens.count = 0;
+   pch->tokens.capacity = 0;
+   pch->lines = 0;
+   pch->raw_define = false;
+   pch->raw_include = false;
+   return pch;
+}
+
+void cache_append_pch_token( struct pch_token_list* list,
+   struct pch_token* token ) {
+   if ( list->count == list->capacity ) {
+      list->capacity = ( list->capacity > 0 ) ? list->capacity * 2 : 64;
+      list->tokens = mem_realloc( list->tokens,
+         sizeof( list->tokens[ 0 ] ) * list->capacity );
+   }
+   list->tokens[ list->count ] = *token;
+   ++list->count;
+}
+
+// 64-bit FNV-1a.
+unsigned long long cache_hash_contents( const char* data, size_t size ) {
+   unsigned long long hash = 14695981039346656037ull;
+   for ( size_t i = 0; i < size; ++i ) {
+      hash = ( hash ^ ( unsigned char ) data[ i ] ) * 1099511628211ull;
+   }
+   return hash;
+}
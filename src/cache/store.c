@@ -0,0 +1,112 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "cache.h"
+
+// In-memory storage
+// ==========================================================================
+// Within a session, the files of the cache are kept in memory between
+// compilations instead of in the cache directory. The memory of a compilation
+// is freed once the compilation is done, so the storage is allocated
+// separately, with malloc().
+
+static struct cache_stored_file* find_file( struct cache_store* store,
+   const char* path );
+
+void cache_init_store( struct cache_store* store ) {
+   store->head = NULL;
+}
+
+void cache_deinit_store( struct cache_store* store ) {
+   while ( store->head ) {
+      struct cache_stored_file* file = store->head;
+      store->head = file->next;
+      free( file->path );
+      free( file->data );
+      free( file );
+   }
+}
+
+static struct cache_stored_file* find_file( struct cache_store* store,
+   const char* path ) {
+   struct cache_stored_file* file = store->head;
+   while ( file && strcmp( file->path, path ) != 0 ) {
+      file = file->next;
+   }
+   return file;
+}
+
+// The contents are copied into the memory of the compilation, so they can be
+// used the same way as the contents of a file read from the cache directory.
+void cache_read_stored_file( struct cache_store* store, const char* path,
+   struct file_contents* contents ) {
+   contents->data = NULL;
+   contents->size = 0;
+   contents->err = 0;
+   contents->obtained = false;
+   struct cache_stored_file* file = find_file( store, path );
+   if ( ! file ) {
+      contents->err = ENOENT;
+      return;
+   }
+   contents->data = mem_alloc( file->size );
+   memcpy( contents->data, file->data, file->size );
+   contents->size = file->size;
+   contents->obtained = true;
+}
+
+bool cache_write_stored_file( struct cache_store* store, const char* path,
+   struct gbuf* buffer ) {
+   size_t size = 0;
+   struct gbuf_seg* segment = buffer->head_segment;
+   while ( segment ) {
+      size += segment->used;
+      segment = segment->next;
+   }
+   char* data = malloc( size > 0 ? size : 1 );
+   if ( ! data ) {
+      return false;
+   }
+   size_t offset = 0;
+   segment = buffer->head_segment;
+   while ( segment ) {
+      memcpy( data + offset, segment->data, segment->used );
+      offset += segment->used;
+      segment = segment->next;
+   }
+   struct cache_stored_file* file = find_file( store, path );
+   if ( ! file ) {
+      file = malloc( sizeof( *file ) );
+      char* file_path = malloc( strlen( path ) + 1 );
+      if ( ! ( file && file_path ) ) {
+         free( file );
+         free( file_path );
+         free( data );
+         return false;
+      }
+      strcpy( file_path, path );
+      file->path = file_path;
+      file->data = NULL;
+      file->next = store->head;
+      store->head = file;
+   }
+   free( file->data );
+   file->data = data;
+   file->size = size;
+   return true;
+}
+
+void cache_delete_stored_file( struct cache_store* store, const char* path ) {
+   struct cache_stored_file** link = &store->head;
+   while ( *link && strcmp( ( *link )->path, path ) != 0 ) {
+      link = &( *link )->next;
+   }
+   if ( *link ) {
+      struct cache_stored_file* file = *link;
+      *link = file->next;
+      free( file->path );
+      free( file->data );
+      free( file );
+   }
+}
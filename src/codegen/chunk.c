@@ -9,6 +9,16 @@ struct value_writing {
    int count;
 };
 
+struct strl_entry {
+   struct indexed_string* string;
+   // String whose tail end contains this string.
+   struct strl_entry* host;
+   int offset;
+   // Number of characters written. Zero for a string that is never
+   // referenced.
+   int length;
+};
+
 struct atag_writing {
    struct var* var;
    struct value* value;
@@ -26,13 +36,13 @@ static void do_snam( struct codegen* codegen );
 static void do_func( struct codegen* codegen );
 static void do_fnam( struct codegen* codegen );
 static void do_strl( struct codegen* codegen );
+static void merge_string_suffixes( struct strl_entry* entries, int count );
+static int compare_reversed_string( const void* a, const void* b );
 static void do_mini( struct codegen* codegen );
 static void write_mini_value( struct codegen* codegen, struct value* value );
 static void do_aray( struct codegen* codegen );
 static void do_aini( struct codegen* codegen );
 static void write_aini( struct codegen* codegen, struct var* var );
-static int count_nonzero_value( struct codegen* codegen,
-   struct var* var );
 static bool is_zero_value( struct codegen* codegen, struct value* value );
 static bool is_nonzero_value( struct codegen* codegen, struct value* value );
 static int get_value_size( struct codegen* codegen, struct value* value );
@@ -45,6 +55,8 @@ static void write_value( struct codegen* codegen,
    struct value_writing* writing, struct value* value, int base );
 static void write_aini_shary( struct codegen* codegen );
 static int count_shary_initz( struct codegen* codegen );
+static void show_aini_savings( struct codegen* codegen, struct var* var,
+   int size, int count, int saved );
 static void write_diminfo( struct codegen* codegen );
 static void do_load( struct codegen* codegen );
 static void do_mimp( struct codegen* codegen );
@@ -79,6 +91,7 @@ void c_write_chunk_obj( struct codegen* codegen ) {
    c_add_int( codegen, 0 );
    c_add_int( codegen, 0 );
    c_write_user_code( codegen );
+   int phase = t_enter_timing( codegen->task, TIMING_CHUNKS );
    int chunk_pos = c_tell( codegen );
    do_sptr( codegen );
    do_svct( codegen );
@@ -147,7 +160,9 @@ void c_write_chunk_obj( struct codegen* codegen ) {
    c_seek( codegen, 0 );
    c_add_sized( codegen, "ACS\0", 4 );
    c_add_int( codegen, dummy_offset );
+   t_enter_timing( codegen->task, TIMING_FLUSH );
    c_flush( codegen );
+   t_leave_timing( codegen->task, phase );
 }
 
 static void do_sptr( struct codegen* codegen ) {
@@ -401,68 +416,151 @@ static void do_fnam( struct codegen* codegen ) {
 }
 
 static void do_strl( struct codegen* codegen ) {
-   if ( ! zbcx_list_size( &codegen->used_strings ) ) {
+   int count = zbcx_list_size( &codegen->used_strings );
+   if ( ! count ) {
       return;
    }
-   int size = 0;
+   struct strl_entry* entries = mem_alloc( sizeof( *entries ) * count );
+   int dropped = 0;
+   int k = 0;
    zbcx_ListIter i;
    zbcx_list_iterate( &codegen->used_strings, &i );
    while ( ! zbcx_list_end( &i ) ) {
-      struct indexed_string* string = zbcx_list_data( &i );
-      // Plus one for the NUL character.
-      size += string->length + 1;
+      entries[ k ].string = zbcx_list_data( &i );
+      entries[ k ].host = NULL;
+      entries[ k ].offset = 0;
+      entries[ k ].length = entries[ k ].string->length;
+      // A string given an index in advance by order_strings() but never
+      // referenced by the code is written as an empty string.
+      if ( codegen->task->options->opt_level >= 1 &&
+         entries[ k ].string->usage == 0 ) {
+         entries[ k ].length = 0;
+         dropped += entries[ k ].string->length;
+      }
+      ++k;
       zbcx_list_next( &i );
    }
-   int offset = 
+   // The key used to encrypt a string depends on the offset of the string, so
+   // a string cannot share its characters with another string in an
+   // encrypted table.
+   if ( codegen->task->options->opt_level >= 1 &&
+      ! codegen->task->library_main->encrypt_str ) {
+      merge_string_suffixes( entries, count );
+   }
+   int offset =
       // String count, padded with a zero on each size.
       sizeof( int ) * 3 +
       // String offsets.
-      sizeof( int ) * zbcx_list_size( &codegen->used_strings );
-   int padding = alignpad( offset + size, 4 );
+      sizeof( int ) * count;
    int offset_initial = offset;
+   int saved = 0;
+   for ( k = 0; k < count; ++k ) {
+      if ( ! entries[ k ].host ) {
+         entries[ k ].offset = offset;
+         // Plus one for the NUL character.
+         offset += entries[ k ].length + 1;
+      }
+   }
+   for ( k = 0; k < count; ++k ) {
+      struct strl_entry* host = entries[ k ].host;
+      if ( host ) {
+         entries[ k ].offset = host->offset + host->length -
+            entries[ k ].length;
+         saved += entries[ k ].length + 1;
+      }
+   }
+   int size = offset - offset_initial;
+   int padding = alignpad( offset, 4 );
    const char* name = "STRL";
    if ( codegen->task->library_main->encrypt_str ) {
       name = "STRE";
    }
    c_add_str( codegen, name );
-   c_add_int( codegen, offset + size + padding );
+   c_add_int( codegen, offset_initial + size + padding );
    // String count.
    c_add_int( codegen, 0 );
-   c_add_int( codegen, zbcx_list_size( &codegen->used_strings ) );
+   c_add_int( codegen, count );
    c_add_int( codegen, 0 );
    // Offsets.
-   zbcx_list_iterate( &codegen->used_strings, &i );
-   while ( ! zbcx_list_end( &i ) ) {
-      struct indexed_string* string = zbcx_list_data( &i );
-      c_add_int( codegen, offset );
-      offset += string->length + 1;
-      zbcx_list_next( &i );
+   for ( k = 0; k < count; ++k ) {
+      c_add_int( codegen, entries[ k ].offset );
    }
    // Strings.
-   offset = offset_initial;
-   zbcx_list_iterate( &codegen->used_strings, &i );
-   while ( ! zbcx_list_end( &i ) ) {
-      struct indexed_string* string = zbcx_list_data( &i );
+   for ( k = 0; k < count; ++k ) {
+      struct indexed_string* string = entries[ k ].string;
+      if ( entries[ k ].host ) {
+         continue;
+      }
       if ( codegen->task->library_main->encrypt_str ) {
-         int key = offset * STR_ENCRYPTION_CONSTANT;
+         int key = entries[ k ].offset * STR_ENCRYPTION_CONSTANT;
          // Each character of the string is encoded, including the NUL
          // character.
-         for ( int i = 0; i <= string->length; ++i ) {
-            char ch = ( char )
-               ( ( ( int ) string->value[ i ] ) ^ ( key + i / 2 ) );
+         for ( int i = 0; i <= entries[ k ].length; ++i ) {
+            int value = ( i < entries[ k ].length ) ? string->value[ i ] : 0;
+            char ch = ( char ) ( value ^ ( key + i / 2 ) );
             c_add_byte( codegen, ch );
          }
-         offset += string->length + 1;
       }
       else {
-         c_add_sized( codegen, string->value, string->length + 1 );
+         c_add_sized( codegen, string->value, entries[ k ].length );
+         c_add_byte( codegen, 0 );
       }
-      zbcx_list_next( &i );
    }
    while ( padding ) {
       c_add_byte( codegen, 0 );
       --padding;
    }
+   mem_free( entries );
+   if ( codegen->task->options->opt_level >= 1 &&
+      codegen->task->options->acc_stats ) {
+      t_diag( codegen->task, DIAG_NONE,
+         "  string table: %d string%s, %d byte%s saved by suffix merging, "
+         "%d byte%s of unreferenced strings dropped",
+         count, count == 1 ? "" : "s",
+         saved, saved == 1 ? "" : "s",
+         dropped, dropped == 1 ? "" : "s" );
+   }
+}
+
+// Finds strings that are the tail end of another string. Such a string does
+// not need to be written; its offset can point into the other string.
+static void merge_string_suffixes( struct strl_entry* entries, int count ) {
+   struct strl_entry** sorted = mem_alloc( sizeof( *sorted ) * count );
+   for ( int i = 0; i < count; ++i ) {
+      sorted[ i ] = &entries[ i ];
+   }
+   // After sorting by the reversed text, a string that is a suffix of another
+   // string is placed right before a string that it is a suffix of.
+   qsort( sorted, count, sizeof( *sorted ), compare_reversed_string );
+   for ( int i = count - 2; i >= 0; --i ) {
+      struct strl_entry* entry = sorted[ i ];
+      struct strl_entry* next_entry = sorted[ i + 1 ];
+      if ( entry->length <= next_entry->length && memcmp(
+         entry->string->value, next_entry->string->value +
+         next_entry->length - entry->length, entry->length ) == 0 ) {
+         sorted[ i ]->host = sorted[ i + 1 ]->host ?
+            sorted[ i + 1 ]->host : sorted[ i + 1 ];
+      }
+   }
+   mem_free( sorted );
+}
+
+static int compare_reversed_string( const void* a, const void* b ) {
+   const struct strl_entry* entry_a = *( const struct strl_entry* const* ) a;
+   const struct strl_entry* entry_b = *( const struct strl_entry* const* ) b;
+   int i = entry_a->length - 1;
+   int k = entry_b->length - 1;
+   while ( i >= 0 && k >= 0 ) {
+      unsigned char ch_a = entry_a->string->value[ i ];
+      unsigned char ch_b = entry_b->string->value[ k ];
+      if ( ch_a != ch_b ) {
+         return ch_a < ch_b ? -1 : 1;
+      }
+      --i;
+      --k;
+   }
+   // The shorter string comes first.
+   return entry_a->length - entry_b->length;
 }
 
 static void do_mini( struct codegen* codegen ) {
@@ -577,10 +675,13 @@ static void do_aini( struct codegen* codegen ) {
 }
 
 static void write_aini( struct codegen* codegen, struct var* var ) {
-   int count = count_nonzero_value( codegen, var );
+   int count = c_count_nonzero_value( codegen, var );
    if ( count == 0 ) {
       return;
    }
+   if ( count < var->size && codegen->task->options->acc_stats ) {
+      show_aini_savings( codegen, var, var->size, count, 0 );
+   }
    c_add_str( codegen, "AINI" );
    c_add_int( codegen,
       sizeof( int ) + // Array index.
@@ -591,8 +692,10 @@ static void write_aini( struct codegen* codegen, struct var* var ) {
    write_value_list( codegen, &writing, var->value );
 }
 
-static int count_nonzero_value( struct codegen* codegen,
-   struct var* var ) {
+// Returns the number of elements up to and including the last non-zero
+// element of the array. The elements after it are left for the game engine to
+// zero.
+int c_count_nonzero_value( struct codegen* codegen, struct var* var ) {
    int count = 0;
    struct value* value = var->value;
    while ( value ) {
@@ -719,10 +822,21 @@ static void write_value( struct codegen* codegen,
 }
 
 static void write_aini_shary( struct codegen* codegen ) {
+   int count = count_shary_initz( codegen );
+   if ( count < codegen->shary.size && codegen->task->options->acc_stats ) {
+      // Compared with the chunk written for the variables in declaration
+      // order, which also leaves out the zero elements at the end.
+      int saved = 0;
+      if ( codegen->task->options->opt_level >= 1 ) {
+         saved = ( int ) sizeof( int ) * ( codegen->shary.data_offset +
+            codegen->shary.unordered_initz_size - count );
+      }
+      show_aini_savings( codegen, NULL, codegen->shary.size, count, saved );
+   }
    c_add_str( codegen, "AINI" );
    c_add_int( codegen,
       sizeof( int ) +
-      sizeof( int ) * count_shary_initz( codegen ) );
+      sizeof( int ) * count );
    c_add_int( codegen, codegen->shary.index );
    // Write null-element/dimension-tracker.
    c_add_int( codegen, 0 );
@@ -753,7 +867,7 @@ static int count_shary_initz( struct codegen* codegen ) {
    zbcx_list_iterate( &codegen->shary.vars, &i );
    while ( ! zbcx_list_end( &i ) ) {
       struct var* var = zbcx_list_data( &i );
-      int count = count_nonzero_value( codegen, var );
+      int count = c_count_nonzero_value( codegen, var );
       if ( count != 0 ) {
          index = var->index + count;
       }
@@ -763,6 +877,32 @@ static int count_shary_initz( struct codegen* codegen ) {
    return count;
 }
 
+// Bytes saved by the layout of the shared array are given in `saved`. The
+// zero elements at the end of an array were already left out before.
+static void show_aini_savings( struct codegen* codegen, struct var* var,
+   int size, int count, int saved ) {
+   struct str name;
+   str_init( &name );
+   if ( var ) {
+      t_copy_name( var->name, false, &name );
+   }
+   else {
+      str_append( &name, "(shared array)" );
+   }
+   if ( saved > 0 ) {
+      t_diag( codegen->task, DIAG_NONE,
+         "  array %s: %d of %d element%s initialized, %d byte%s saved by "
+         "reordering", name.value, count, size, size == 1 ? "" : "s", saved,
+         saved == 1 ? "" : "s" );
+   }
+   else {
+      t_diag( codegen->task, DIAG_NONE,
+         "  array %s: %d of %d element%s initialized", name.value, count,
+         size, size == 1 ? "" : "s" );
+   }
+   str_deinit( &name );
+}
+
 static void write_diminfo( struct codegen* codegen ) {
    zbcx_ListIter i;
    zbcx_list_iterate( &codegen->shary.dims, &i );
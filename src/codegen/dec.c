@@ -16,6 +16,9 @@ struct nestedfunc_writing {
 static void write_null_handler( struct codegen* codegen );
 static void write_script( struct codegen* codegen, struct script* script );
 static void write_func( struct codegen* codegen, struct func* func );
+static int optimize_body( struct codegen* codegen, struct pos* pos,
+   int param_size, int size );
+static int flush_body( struct codegen* codegen, struct pos* pos );
 static void init_func_record( struct func_record* record, struct func* func );
 static void alloc_param_indexes( struct func_record* func,
    struct param* param );
@@ -117,6 +120,7 @@ static void write_script( struct codegen* codegen, struct script* script ) {
       assign_nested_call_ids( codegen, script->nested_funcs );
    }
    alloc_param_indexes( &record, script->params );
+   int param_size = record.start_index;
    alloc_funcscopevars_indexes( &record, &script->funcscope_vars );
    c_write_block( codegen, script->body );
    c_pcd( codegen, PCD_TERMINATE );
@@ -129,7 +133,13 @@ static void write_script( struct codegen* codegen, struct script* script ) {
       write_nested_funcs( codegen, &writing );
       script->size += writing.temps_size;
    }
-   c_flush_pcode( codegen );
+   // The nested functions of a script save and restore their variables by
+   // position, so their slots are left alone.
+   else if ( codegen->task->options->opt_level >= 1 ) {
+      script->size = optimize_body( codegen, &script->pos, param_size,
+         script->size );
+   }
+   script->offset = flush_body( codegen, &script->pos );
 }
 
 static void write_func( struct codegen* codegen, struct func* func ) {
@@ -143,11 +153,17 @@ static void write_func( struct codegen* codegen, struct func* func ) {
       assign_nested_call_ids( codegen, impl->nested_funcs );
    }
    alloc_param_indexes( &record, func->params );
+   int param_size = record.start_index;
    alloc_funcscopevars_indexes( &record, &impl->funcscope_vars );
    c_write_block( codegen, impl->body );
-   if ( func->return_spec == SPEC_VOID && ! func->ref ) {
+   if ( func->return_spec == SPEC_VOID && ! func->ref &&
+      ! c_is_restarted( codegen ) ) {
       c_pcd( codegen, PCD_RETURNVOID );
    }
+   // Self tail calls jump back to the start of the function.
+   if ( record.entry_point ) {
+      c_prepend_node( codegen, &record.entry_point->node );
+   }
    impl->size = record.size;
    codegen->func = NULL;
    if ( impl->nested_funcs ) {
@@ -157,7 +173,58 @@ static void write_func( struct codegen* codegen, struct func* func ) {
       write_nested_funcs( codegen, &writing );
       impl->size += writing.temps_size;
    }
-   c_flush_pcode( codegen );
+   else if ( codegen->task->options->opt_level >= 1 ) {
+      impl->size = optimize_body( codegen, &func->object.pos, param_size,
+         impl->size );
+   }
+   impl->obj_pos = flush_body( codegen, &func->object.pos );
+}
+
+// Bodies generated from the same code, like those of getters and wrappers
+// created by macros, are written only once and shared by their entries.
+static int flush_body( struct codegen* codegen, struct pos* pos ) {
+   int saved = 0;
+   int obj_pos = c_flush_body( codegen, &saved );
+   if ( saved > 0 && codegen->task->options->acc_stats ) {
+      t_diag( codegen->task, DIAG_POS | DIAG_NOTE, pos,
+         "body identical to an earlier body, %d byte%s saved by sharing it",
+         saved, saved == 1 ? "" : "s" );
+   }
+   return obj_pos;
+}
+
+// Returns the new number of slots used by the body.
+static int optimize_body( struct codegen* codegen, struct pos* pos,
+   int param_size, int size ) {
+   int packed_size = size;
+   int hoisted = 0;
+   int reduced = 0;
+   int reused = 0;
+   if ( codegen->task->options->opt_level >= 2 ) {
+      packed_size = c_optimize_loops( codegen, packed_size, &hoisted,
+         &reduced );
+   }
+   packed_size = c_number_local_values( codegen, packed_size, &reused );
+   packed_size = c_pack_local_slots( codegen, param_size, packed_size );
+   if ( codegen->task->options->acc_stats ) {
+      if ( hoisted > 0 || reduced > 0 ) {
+         t_diag( codegen->task, DIAG_POS | DIAG_NOTE, pos,
+            "%d loop-invariant computation%s moved, %d offset%s "
+            "strength-reduced", hoisted, hoisted == 1 ? "" : "s", reduced,
+            reduced == 1 ? "" : "s" );
+      }
+      if ( reused > 0 ) {
+         t_diag( codegen->task, DIAG_POS | DIAG_NOTE, pos,
+            "%d repeated computation%s replaced by a saved value", reused,
+            reused == 1 ? "" : "s" );
+      }
+      if ( packed_size < size ) {
+         t_diag( codegen->task, DIAG_POS | DIAG_NOTE, pos,
+            "local variable space reduced from %d to %d slot%s", size,
+            packed_size, packed_size == 1 ? "" : "s" );
+      }
+   }
+   return packed_size;
 }
 
 static void init_func_record( struct func_record* record, struct func* func ) {
@@ -165,6 +232,7 @@ static void init_func_record( struct func_record* record, struct func* func ) {
    record->start_index = 0;
    record->array_index = 0;
    record->size = 0;
+   record->entry_point = NULL;
    record->nested_func = false;
 }
 
@@ -648,6 +716,11 @@ static void write_one_nestedfunc( struct codegen* codegen,
       --param_index;
       ++i;
    }
+   // Self tail calls jump past the prologue, keeping the return address and
+   // the saved variables of the current call.
+   if ( record.entry_point ) {
+      c_append_node( codegen, &record.entry_point->node );
+   }
    c_seek_node( codegen, codegen->node_tail );
    // Epilogue:
    // -----------------------------------------------------------------------
@@ -698,18 +771,23 @@ static void write_one_nestedfunc( struct codegen* codegen,
 static void patch_nestedfunc_addresses( struct codegen* codegen,
    struct func* func ) {
    struct func_user* impl = func->impl;
-   // Correct calls to function.
+   // Correct calls to function. Self tail calls that restart the function
+   // have no prologue jump and are never returned to.
    struct call* call = impl->nested_calls;
    while ( call ) {
-      call->nested_call->prologue_jump->point = impl->prologue_point;
+      if ( call->nested_call->prologue_jump ) {
+         call->nested_call->prologue_jump->point = impl->prologue_point;
+      }
       call = call->nested_call->next;
    }
    // Populate return-table.
    call = impl->nested_calls;
    while ( call ) {
-      struct c_casejump* entry = c_create_casejump( codegen,
-         call->nested_call->id, call->nested_call->return_point );
-      c_append_casejump( impl->return_table, entry );
+      if ( call->nested_call->return_point ) {
+         struct c_casejump* entry = c_create_casejump( codegen,
+            call->nested_call->id, call->nested_call->return_point );
+         c_append_casejump( impl->return_table, entry );
+      }
       call = call->nested_call->next;
    }
 }
@@ -161,6 +161,10 @@ static void call_local_user_func( struct codegen* codegen,
    struct result* result, struct call* call );
 static void call_user_func( struct codegen* codegen, struct result* result,
    struct call* call );
+static bool is_tail_call( struct codegen* codegen, struct call* call );
+static void restart_func( struct codegen* codegen, struct result* result,
+   struct call* call );
+static void assign_params( struct codegen* codegen, struct param* param );
 static void write_call_args( struct codegen* codegen, struct call* call );
 static void push_arg( struct codegen* codegen, struct param* param,
    struct expr* expr );
@@ -170,6 +174,8 @@ static void visit_sample_call( struct codegen* codegen, struct result* result,
    struct call* call );
 static void visit_internal_call( struct codegen* codegen,
    struct result* result, struct call* call );
+static struct indexed_string* get_constant_string( struct codegen* codegen,
+   struct node* node );
 static void write_executewait( struct codegen* codegen, struct call* call,
    bool named_impl );
 static void call_array_length( struct codegen* codegen, struct result* result,
@@ -548,6 +554,12 @@ static void lt_str( struct codegen* codegen, struct result* result,
 
 static void concat_str( struct codegen* codegen, struct result* result,
    struct binary* binary ) {
+   if ( binary->folded ) {
+      c_push_string( codegen,
+         t_lookup_string( codegen->task, binary->value ) );
+      result->status = R_VALUE;
+      return;
+   }
    c_pcd( codegen, PCD_BEGINPRINT );
    push_operand( codegen, binary->lside );
    c_pcd( codegen, PCD_PRINTSTRING );
@@ -1697,7 +1709,10 @@ static void visit_ded_call( struct codegen* codegen, struct result* result,
 static void visit_user_call( struct codegen* codegen, struct result* result,
    struct call* call ) {
    struct func_user* impl = call->func->impl;
-   if ( impl->local ) {
+   if ( is_tail_call( codegen, call ) ) {
+      restart_func( codegen, result, call );
+   }
+   else if ( impl->local ) {
       call_local_user_func( codegen, result, call );
    }
    else {
@@ -1734,6 +1749,52 @@ static void call_user_func( struct codegen* codegen, struct result* result,
    }
 }
 
+// A function at the top level starts with its local variables zeroed, so it
+// is only restarted when none of them depend on it. The variables of a nested
+// function are not reset between calls.
+static bool is_tail_call( struct codegen* codegen, struct call* call ) {
+   if ( call->tail && codegen->task->options->opt_level >= 1 &&
+      codegen->func && codegen->func->func == call->func ) {
+      struct func_user* impl = call->func->impl;
+      return ( codegen->func->nested_func || ! impl->uninit_locals );
+   }
+   return false;
+}
+
+// Assigns the arguments to the parameters and jumps back to the start of the
+// function, instead of calling the function again.
+static void restart_func( struct codegen* codegen, struct result* result,
+   struct call* call ) {
+   write_call_args( codegen, call );
+   assign_params( codegen, call->func->params );
+   if ( ! codegen->func->entry_point ) {
+      codegen->func->entry_point = c_create_point( codegen );
+   }
+   struct c_jump* jump = c_create_jump( codegen, PCD_GOTO );
+   c_append_node( codegen, &jump->node );
+   jump->point = codegen->func->entry_point;
+   if ( call->func->return_spec != SPEC_VOID ) {
+      result->status = R_VALUE;
+   }
+   if ( codegen->task->options->acc_stats ) {
+      t_diag( codegen->task, DIAG_POS | DIAG_NOTE, &call->pos,
+         "self tail call turned into a jump to the start of the function" );
+   }
+}
+
+// The arguments are on the stack in the order of the parameters, so the last
+// parameter is assigned first.
+static void assign_params( struct codegen* codegen, struct param* param ) {
+   if ( param ) {
+      assign_params( codegen, param->next );
+      int i = param->size;
+      while ( i > 0 ) {
+         --i;
+         c_pcd( codegen, PCD_ASSIGNSCRIPTVAR, param->index + i );
+      }
+   }
+}
+
 static void write_call_args( struct codegen* codegen, struct call* call ) {
    struct param* param = call->func->params;
    // Push arguments.
@@ -1993,8 +2054,18 @@ static void visit_internal_call( struct codegen* codegen,
          ( impl->id == INTERN_FUNC_ACS_NAMEDEXECUTEWAIT ) );
    }
    else if ( impl->id == INTERN_FUNC_STR_LENGTH ) {
-      visit_operand( codegen, result, call->operand );
-      c_pcd( codegen, PCD_STRLEN );
+      // The length of a string constant is known at compile time.
+      struct access* access = ( struct access* ) call->operand;
+      struct indexed_string* string = get_constant_string( codegen,
+         access->lside );
+      if ( string ) {
+         c_pcd( codegen, PCD_PUSHNUMBER, string->length );
+         result->status = R_VALUE;
+      }
+      else {
+         visit_operand( codegen, result, call->operand );
+         c_pcd( codegen, PCD_STRLEN );
+      }
    }
    else if ( impl->id == INTERN_FUNC_STR_AT ) {
       visit_operand( codegen, result, call->operand );
@@ -2006,6 +2077,47 @@ static void visit_internal_call( struct codegen* codegen,
    }
 }
 
+static struct indexed_string* get_constant_string( struct codegen* codegen,
+   struct node* node ) {
+   while ( node->type == NODE_PAREN ) {
+      node = ( ( struct paren* ) node )->inside;
+   }
+   switch ( node->type ) {
+   case NODE_INDEXED_STRING_USAGE:
+      return ( ( struct indexed_string_usage* ) node )->string;
+   case NODE_BINARY:
+      {
+         struct binary* binary = ( struct binary* ) node;
+         if ( binary->folded &&
+            binary->operand_type == BINARYOPERAND_PRIMITIVESTR ) {
+            return t_lookup_string( codegen->task, binary->value );
+         }
+      }
+      break;
+   case NODE_NAME_USAGE:
+      {
+         struct name_usage* usage = ( struct name_usage* ) node;
+         if ( usage->object->type == NODE_CONSTANT ) {
+            struct constant* constant = ( struct constant* ) usage->object;
+            if ( constant->has_str ) {
+               return t_lookup_string( codegen->task, constant->value );
+            }
+         }
+         else if ( usage->object->type == NODE_ENUMERATOR ) {
+            struct enumerator* enumerator =
+               ( struct enumerator* ) usage->object;
+            if ( enumerator->has_str ) {
+               return t_lookup_string( codegen->task, enumerator->value );
+            }
+         }
+      }
+      break;
+   default:
+      break;
+   }
+   return NULL;
+}
+
 static void write_executewait( struct codegen* codegen, struct call* call,
    bool named_impl ) {
    zbcx_ListIter i;
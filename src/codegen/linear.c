@@ -1,4 +1,5 @@
 #include <stdarg.h>
+#include <string.h>
 
 #include "phase.h"
 #include "pcode.h"
@@ -20,6 +21,16 @@ static void write_jump( struct codegen* codegen, struct c_jump* jump );
 static void write_casejump( struct codegen* codegen, struct c_casejump* jump );
 static void write_sortedcasejump( struct codegen* codegen,
    struct c_sortedcasejump* sorted_jump );
+static void create_digest( struct codegen* codegen );
+static void add_digest_point( struct codegen* codegen,
+   struct c_point* point );
+static void add_digest( struct codegen* codegen, int value );
+static unsigned int hash_digest( struct codegen* codegen );
+static struct body_record* find_body( struct codegen* codegen,
+   unsigned int hash );
+static void add_body( struct codegen* codegen, unsigned int hash,
+   int obj_pos, int size );
+static void discard_pcode( struct codegen* codegen );
 
 static void* alloc_node( struct codegen* codegen, int type ) {
    if ( codegen->free_nodes[ type ] ) {
@@ -58,6 +69,38 @@ void c_append_node( struct codegen* codegen, struct c_node* node ) {
    codegen->node = node;
 }
 
+void c_prepend_node( struct codegen* codegen, struct c_node* node ) {
+   node->next = codegen->node_head;
+   codegen->node_head = node;
+   if ( ! codegen->node_tail ) {
+      codegen->node_tail = node;
+   }
+}
+
+// Unlinks the node following `prev`, or the first node when `prev` is NULL,
+// and frees it. The node and, for a pcode, its argument list go back to the
+// free lists for reuse by later nodes.
+void c_remove_node( struct codegen* codegen, struct c_node* prev ) {
+   struct c_node* node = prev ? prev->next : codegen->node_head;
+   if ( prev ) {
+      prev->next = node->next;
+   }
+   else {
+      codegen->node_head = node->next;
+   }
+   if ( codegen->node_tail == node ) {
+      codegen->node_tail = prev;
+   }
+   if ( codegen->node == node ) {
+      codegen->node = prev;
+   }
+   if ( ( struct c_node* ) codegen->pcode == node ) {
+      codegen->pcode = NULL;
+      codegen->pcodearg_tail = NULL;
+   }
+   free_node( codegen, node );
+}
+
 static void free_node( struct codegen* codegen, struct c_node* node ) {
    node->next = codegen->free_nodes[ node->type ];
    codegen->free_nodes[ node->type ] = node;
@@ -70,6 +113,7 @@ static void free_node( struct codegen* codegen, struct c_node* node ) {
          codegen->free_pcode_args = arg;
          arg = next_arg;
       }
+      pcode->args = NULL;
    }
 }
 
@@ -366,3 +410,180 @@ static void write_sortedcasejump( struct codegen* codegen,
       jump = jump->next;
    }
 }
+
+// Writes the body of a function or script, unless a body with the same
+// instructions has already been written, in which case the body is dropped
+// and the existing body is shared. Returns the position of the body in the
+// object. `saved` receives the number of bytes that were not written.
+int c_flush_body( struct codegen* codegen, int* saved ) {
+   *saved = 0;
+   if ( codegen->task->options->opt_level < 1 ) {
+      int obj_pos = c_tell( codegen );
+      c_flush_pcode( codegen );
+      return obj_pos;
+   }
+   create_digest( codegen );
+   unsigned int hash = hash_digest( codegen );
+   struct body_record* body = find_body( codegen, hash );
+   if ( body ) {
+      discard_pcode( codegen );
+      *saved = body->size;
+      return body->obj_pos;
+   }
+   int obj_pos = c_tell( codegen );
+   c_flush_pcode( codegen );
+   add_body( codegen, hash, obj_pos, c_tell( codegen ) - obj_pos );
+   return obj_pos;
+}
+
+// The digest lists the nodes of the body. A point is identified by the order
+// in which it appears in the body, not by its position in the object, so two
+// bodies with the same instructions have the same digest wherever they are.
+static void create_digest( struct codegen* codegen ) {
+   codegen->bodies.digest_size = 0;
+   int count = 0;
+   struct c_node* node = codegen->node_head;
+   while ( node ) {
+      if ( node->type == C_NODE_POINT ) {
+         // Temporarily store the number of the point in its position. The
+         // position is assigned when the point is written.
+         ( ( struct c_point* ) node )->obj_pos = count;
+         ++count;
+      }
+      node = node->next;
+   }
+   node = codegen->node_head;
+   while ( node ) {
+      add_digest( codegen, node->type );
+      switch ( node->type ) {
+      case C_NODE_JUMP:
+         {
+            struct c_jump* jump = ( struct c_jump* ) node;
+            add_digest( codegen, jump->opcode );
+            add_digest_point( codegen, jump->point );
+         }
+         break;
+      case C_NODE_CASEJUMP:
+         {
+            struct c_casejump* jump = ( struct c_casejump* ) node;
+            add_digest( codegen, jump->value );
+            add_digest_point( codegen, jump->point );
+         }
+         break;
+      case C_NODE_SORTEDCASEJUMP:
+         {
+            struct c_sortedcasejump* sorted_jump =
+               ( struct c_sortedcasejump* ) node;
+            add_digest( codegen, sorted_jump->count );
+            struct c_casejump* jump = sorted_jump->head;
+            while ( jump ) {
+               add_digest( codegen, jump->value );
+               add_digest_point( codegen, jump->point );
+               jump = jump->next;
+            }
+         }
+         break;
+      case C_NODE_PCODE:
+         {
+            struct c_pcode* pcode = ( struct c_pcode* ) node;
+            add_digest( codegen, pcode->code );
+            add_digest( codegen, pcode->optimize );
+            struct c_pcode_arg* arg = pcode->args;
+            while ( arg ) {
+               if ( arg->point ) {
+                  add_digest( codegen, 1 );
+                  add_digest_point( codegen, arg->point );
+               }
+               else {
+                  add_digest( codegen, 0 );
+                  add_digest( codegen, arg->value );
+               }
+               arg = arg->next;
+            }
+            // Mark the end of the arguments.
+            add_digest( codegen, -1 );
+         }
+         break;
+      default:
+         break;
+      }
+      node = node->next;
+   }
+   node = codegen->node_head;
+   while ( node ) {
+      if ( node->type == C_NODE_POINT ) {
+         ( ( struct c_point* ) node )->obj_pos = 0;
+      }
+      node = node->next;
+   }
+}
+
+static void add_digest_point( struct codegen* codegen,
+   struct c_point* point ) {
+   add_digest( codegen, point->obj_pos );
+}
+
+static void add_digest( struct codegen* codegen, int value ) {
+   if ( codegen->bodies.digest_size == codegen->bodies.digest_capacity ) {
+      codegen->bodies.digest_capacity = codegen->bodies.digest_capacity ?
+         codegen->bodies.digest_capacity * 2 : 256;
+      codegen->bodies.digest = mem_realloc( codegen->bodies.digest,
+         sizeof( *codegen->bodies.digest ) *
+         codegen->bodies.digest_capacity );
+   }
+   codegen->bodies.digest[ codegen->bodies.digest_size ] = value;
+   ++codegen->bodies.digest_size;
+}
+
+// FNV-1a.
+static unsigned int hash_digest( struct codegen* codegen ) {
+   unsigned int hash = 2166136261u;
+   for ( int i = 0; i < codegen->bodies.digest_size; ++i ) {
+      hash ^= ( unsigned int ) codegen->bodies.digest[ i ];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+static struct body_record* find_body( struct codegen* codegen,
+   unsigned int hash ) {
+   struct body_record* body =
+      codegen->bodies.table[ hash % BODY_TABLE_SIZE ];
+   while ( body ) {
+      if ( body->hash == hash &&
+         body->digest_size == codegen->bodies.digest_size &&
+         memcmp( body->digest, codegen->bodies.digest,
+            sizeof( *body->digest ) * body->digest_size ) == 0 ) {
+         return body;
+      }
+      body = body->next;
+   }
+   return NULL;
+}
+
+static void add_body( struct codegen* codegen, unsigned int hash,
+   int obj_pos, int size ) {
+   struct body_record* body = mem_alloc( sizeof( *body ) );
+   body->digest = mem_alloc( sizeof( *body->digest ) *
+      codegen->bodies.digest_size );
+   memcpy( body->digest, codegen->bodies.digest,
+      sizeof( *body->digest ) * codegen->bodies.digest_size );
+   body->digest_size = codegen->bodies.digest_size;
+   body->hash = hash;
+   body->obj_pos = obj_pos;
+   body->size = size;
+   body->next = codegen->bodies.table[ hash % BODY_TABLE_SIZE ];
+   codegen->bodies.table[ hash % BODY_TABLE_SIZE ] = body;
+}
+
+static void discard_pcode( struct codegen* codegen ) {
+   struct c_node* node = codegen->node_head;
+   while ( node ) {
+      struct c_node* next_node = node->next;
+      free_node( codegen, node );
+      node = next_node;
+   }
+   codegen->node = NULL;
+   codegen->node_head = NULL;
+   codegen->node_tail = NULL;
+}
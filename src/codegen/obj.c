@@ -6,7 +6,7 @@
 #include "pcode.h"
 
 static void next_buffer( struct codegen* codegen );
-static struct buffer* alloc_buffer( void );
+static struct buffer* alloc_buffer( int start );
 static void write_opc( struct codegen* codegen, int );
 static void write_arg( struct codegen* codegen, int );
 static void write_args( struct codegen* codegen );
@@ -16,7 +16,7 @@ static void push_immediate( struct codegen* codegen, int );
 static bool is_byte_value( int );
 
 void c_init_obj( struct codegen* codegen ) {
-   codegen->buffer_head = alloc_buffer();
+   codegen->buffer_head = alloc_buffer( 0 );
    codegen->buffer = codegen->buffer_head;
    codegen->opc = PCD_NONE;
    codegen->opc_args = 0;
@@ -27,9 +27,10 @@ void c_init_obj( struct codegen* codegen ) {
    codegen->push_immediate = false;
 }
 
-static struct buffer* alloc_buffer( void ) {
+static struct buffer* alloc_buffer( int start ) {
    struct buffer* buffer = mem_alloc( sizeof( *buffer ) );
    buffer->next = NULL;
+   buffer->start = start;
    buffer->used = 0;
    buffer->pos = 0;
    return buffer;
@@ -59,7 +60,8 @@ static void next_buffer( struct codegen* codegen ) {
       codegen->buffer->pos = 0;
    }
    else {
-      struct buffer* buffer = alloc_buffer();
+      struct buffer* buffer = alloc_buffer( codegen->buffer->start +
+         codegen->buffer->used );
       codegen->buffer->next = buffer;
       codegen->buffer = buffer;
    }
@@ -121,85 +123,66 @@ void c_add_opc( struct codegen* codegen, int code ) {
       default:
          goto binary_fold;
       }
+      int op = FOLD_MINUS;
       switch ( code ) {
-      case PCD_UNARYMINUS:
-         codegen->immediate_tail->value = ( - codegen->immediate_tail->value );
-         break;
-      case PCD_NEGATELOGICAL:
-         codegen->immediate_tail->value = ( ! codegen->immediate_tail->value );
-         break;
-      case PCD_NEGATEBINARY:
-         codegen->immediate_tail->value = ( ~ codegen->immediate_tail->value );
-         break;
-      default:
-         break;
+      case PCD_NEGATELOGICAL: op = FOLD_LOG_NOT; break;
+      case PCD_NEGATEBINARY: op = FOLD_BIT_NOT; break;
+      default: break;
       }
+      t_fold_unary( op, codegen->immediate_tail->value,
+         &codegen->immediate_tail->value );
       goto finish;
    }
    // Binary constant folding:
    // -----------------------------------------------------------------------
    binary_fold: {
+      int op = FOLD_ADD;
       switch ( code ) {
-      case PCD_ORLOGICAL:
-      case PCD_ANDLOGICAL:
-      case PCD_ORBITWISE:
-      case PCD_EORBITWISE:
-      case PCD_ANDBITWISE:
-      case PCD_EQ:
-      case PCD_NE:
-      case PCD_LT:
-      case PCD_LE:
-      case PCD_GT:
-      case PCD_GE:
-      case PCD_LSHIFT:
-      case PCD_RSHIFT:
-      case PCD_ADD:
-      case PCD_SUBTRACT:
-      case PCD_MULTIPLY:
-      case PCD_DIVIDE:
-      case PCD_MODULUS:
-         if ( codegen->immediate_count >= 2 ) {
-            break;
-         }
-         // FALLTHROUGH
+      case PCD_ORLOGICAL: op = FOLD_LOG_OR; break;
+      case PCD_ANDLOGICAL: op = FOLD_LOG_AND; break;
+      case PCD_ORBITWISE: op = FOLD_BIT_OR; break;
+      case PCD_EORBITWISE: op = FOLD_BIT_XOR; break;
+      case PCD_ANDBITWISE: op = FOLD_BIT_AND; break;
+      case PCD_EQ: op = FOLD_EQ; break;
+      case PCD_NE: op = FOLD_NEQ; break;
+      case PCD_LT: op = FOLD_LT; break;
+      case PCD_LE: op = FOLD_LTE; break;
+      case PCD_GT: op = FOLD_GT; break;
+      case PCD_GE: op = FOLD_GTE; break;
+      case PCD_LSHIFT: op = FOLD_SHIFT_L; break;
+      case PCD_RSHIFT: op = FOLD_SHIFT_R; break;
+      case PCD_ADD: op = FOLD_ADD; break;
+      case PCD_SUBTRACT: op = FOLD_SUB; break;
+      case PCD_MULTIPLY: op = FOLD_MUL; break;
+      case PCD_DIVIDE: op = FOLD_DIV; break;
+      case PCD_MODULUS: op = FOLD_MOD; break;
+      case PCD_FIXEDMUL: op = FOLD_FIXED_MUL; break;
+      case PCD_FIXEDDIV: op = FOLD_FIXED_DIV; break;
       default:
          goto direct;
       }
+      if ( codegen->immediate_count < 2 ) {
+         goto direct;
+      }
       struct immediate* second_last = codegen->immediate;
       struct immediate* last = second_last->next;
       while ( last->next ) {
          second_last = last;
          last = last->next;
       }
-      int l = second_last->value;
-      int r = last->value;
+      // An operation that cannot be folded, like a division by zero, is left
+      // for the game engine to perform.
+      int value = 0;
+      if ( ! t_fold_binary( op, second_last->value, last->value, &value ) ) {
+         goto direct;
+      }
       last->next = codegen->free_immediate;
       codegen->free_immediate = last;
       --codegen->immediate_count;
       last = second_last;
       last->next = NULL;
+      last->value = value;
       codegen->immediate_tail = last;
-      switch ( code ) {
-      case PCD_ORLOGICAL: last->value = ( l || r ); break;
-      case PCD_ANDLOGICAL: last->value = ( l && r ); break;
-      case PCD_ORBITWISE: last->value = l | r; break;
-      case PCD_EORBITWISE: last->value = l ^ r; break;
-      case PCD_ANDBITWISE: last->value = l & r; break;
-      case PCD_EQ: last->value = ( l == r ); break;
-      case PCD_NE: last->value = ( l != r ); break;
-      case PCD_LT: last->value = ( l < r ); break;
-      case PCD_LE: last->value = ( l <= r ); break;
-      case PCD_GT: last->value = ( l > r ); break;
-      case PCD_GE: last->value = ( l >= r ); break;
-      case PCD_LSHIFT: last->value = l << r; break;
-      case PCD_RSHIFT: last->value = l >> r; break;
-      case PCD_ADD: last->value = l + r; break;
-      case PCD_SUBTRACT: last->value = l - r; break;
-      case PCD_MULTIPLY: last->value = l * r; break;
-      case PCD_DIVIDE: last->value = l / r; break;
-      case PCD_MODULUS: last->value = l % r; break;
-      default: break;
-      }
       goto finish;
    }
    // Direct instructions:
@@ -225,17 +208,9 @@ void c_add_opc( struct codegen* codegen, int code ) {
          ++count;
       }
       int direct = d_pcode->direct_code;
-      if ( codegen->compress && count == d_pcode->argc ) {
-         switch ( code ) {
-         case PCD_LSPEC1: direct = PCD_LSPEC1DIRECTB; break;
-         case PCD_LSPEC2: direct = PCD_LSPEC2DIRECTB; break;
-         case PCD_LSPEC3: direct = PCD_LSPEC3DIRECTB; break;
-         case PCD_LSPEC4: direct = PCD_LSPEC4DIRECTB; break;
-         case PCD_LSPEC5: direct = PCD_LSPEC5DIRECTB; break;
-         case PCD_DELAY: direct = PCD_DELAYDIRECTB; break;
-         case PCD_RANDOM: direct = PCD_RANDOMDIRECTB; break;
-         default: break;
-         }
+      if ( codegen->compress && count == d_pcode->argc &&
+         d_pcode->direct_byte_code != PCD_NONE ) {
+         direct = d_pcode->direct_byte_code;
       }
       write_opc( codegen, direct );
       // Some instructions have other arguments that need to be written
@@ -629,26 +604,22 @@ int c_tell( struct codegen* codegen ) {
    if ( codegen->immediate_count ) {
       push_immediate( codegen, codegen->immediate_count );
    }
-   int pos = 0;
-   struct buffer* buffer = codegen->buffer_head;
-   while ( buffer != codegen->buffer ) {
-      pos += buffer->used;
-      buffer = buffer->next;
-   }
-   pos += buffer->pos;
-   return pos;
+   return codegen->buffer->start + codegen->buffer->pos;
 }
 
+// Jumps are patched in the order they are written, so the search starts from
+// the current buffer when possible.
 void c_seek( struct codegen* codegen, int pos ) {
-   struct buffer* buffer = codegen->buffer_head;
-   int absolute_pos = 0;
+   struct buffer* buffer = codegen->buffer;
+   if ( pos < buffer->start ) {
+      buffer = codegen->buffer_head;
+   }
    while ( buffer ) {
-      if ( pos < absolute_pos + buffer->used ) {
+      if ( pos < buffer->start + buffer->used ) {
          codegen->buffer = buffer;
-         codegen->buffer->pos = pos - absolute_pos;
+         codegen->buffer->pos = pos - buffer->start;
          return;
       }
-      absolute_pos += buffer->used;
       buffer = buffer->next;
    }
 }
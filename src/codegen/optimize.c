@@ -0,0 +1,1758 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "phase.h"
+#include "pcode.h"
+#include "linear.h"
+
+// Liveness-based packing of local variable slots.
+// ==========================================================================
+// Local variables get their slots while the code is generated, and a slot is
+// only freed when the scope of its variable ends. This pass works on the
+// linear code of a function, just before it is written: it determines where
+// each slot is live, then reassigns the slots so variables and temporaries
+// that are never live at the same time share a slot.
+
+enum { SLOTSET_BITS = 32 };
+
+struct slot_packing {
+   struct codegen* codegen;
+   struct c_node** nodes;
+   // For each node: the slots live on entry and on exit, as bit sets.
+   u32* live_in;
+   u32* live_out;
+   u32* interference;
+   u32* scratch;
+   int* slots;
+   int node_count;
+   int set_size;
+   int param_size;
+   int size;
+};
+
+static bool collect_nodes( struct slot_packing* packing );
+static struct c_node** collect_linear_nodes( struct codegen* codegen,
+   int* node_count );
+static bool has_known_control_flow( struct c_node** nodes, int count );
+static void release_linear_points( struct c_node** nodes, int count );
+static bool is_slot_pcode( int code );
+static bool reads_slot( int code );
+static bool writes_slot( int code );
+static int get_slot( struct c_node* node );
+static int get_point_node( struct c_point* point );
+static void compute_liveness( struct slot_packing* packing );
+static bool update_node_liveness( struct slot_packing* packing, int node );
+static void union_node_live_in( struct slot_packing* packing, u32* set,
+   int node );
+static void build_interference( struct slot_packing* packing );
+static void add_interference( struct slot_packing* packing, int a, int b );
+static bool interferes( struct slot_packing* packing, int a, int b );
+static int assign_slots( struct slot_packing* packing );
+static void rename_slots( struct slot_packing* packing );
+static bool is_self_copy( struct c_node* push, struct c_node* assign );
+static void set_add( u32* set, int slot );
+static void set_remove( u32* set, int slot );
+static bool set_contains( u32* set, int slot );
+
+// Returns the new number of slots used by the function. Slots below
+// `param_size` hold the arguments and keep their positions.
+int c_pack_local_slots( struct codegen* codegen, int param_size, int size ) {
+   if ( size <= param_size ) {
+      return size;
+   }
+   struct slot_packing packing;
+   packing.codegen = codegen;
+   packing.param_size = param_size;
+   packing.size = size;
+   packing.set_size = ( size + SLOTSET_BITS - 1 ) / SLOTSET_BITS;
+   if ( ! collect_nodes( &packing ) ) {
+      release_linear_points( packing.nodes, packing.node_count );
+      mem_free( packing.nodes );
+      return size;
+   }
+   int set_bytes = sizeof( u32 ) * packing.set_size;
+   packing.live_in = mem_alloc( set_bytes * packing.node_count );
+   packing.live_out = mem_alloc( set_bytes * packing.node_count );
+   packing.interference = mem_alloc( set_bytes * size );
+   packing.scratch = mem_alloc( set_bytes );
+   packing.slots = mem_alloc( sizeof( int ) * size );
+   memset( packing.live_in, 0, set_bytes * packing.node_count );
+   memset( packing.live_out, 0, set_bytes * packing.node_count );
+   memset( packing.interference, 0, set_bytes * size );
+   compute_liveness( &packing );
+   build_interference( &packing );
+   int packed_size = assign_slots( &packing );
+   rename_slots( &packing );
+   release_linear_points( packing.nodes, packing.node_count );
+   mem_free( packing.nodes );
+   mem_free( packing.live_in );
+   mem_free( packing.live_out );
+   mem_free( packing.interference );
+   mem_free( packing.scratch );
+   mem_free( packing.slots );
+   return packed_size;
+}
+
+static bool collect_nodes( struct slot_packing* packing ) {
+   packing->nodes = collect_linear_nodes( packing->codegen,
+      &packing->node_count );
+   if ( ! has_known_control_flow( packing->nodes, packing->node_count ) ) {
+      return false;
+   }
+   for ( int i = 0; i < packing->node_count; ++i ) {
+      struct c_node* node = packing->nodes[ i ];
+      if ( node->type == C_NODE_PCODE &&
+         is_slot_pcode( ( ( struct c_pcode* ) node )->code ) ) {
+         int slot = get_slot( node );
+         if ( slot < 0 || slot >= packing->size ) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+// Numbers the nodes of the linear code. Each point is tagged with the negated
+// position of its node, until release_linear_points() is called.
+static struct c_node** collect_linear_nodes( struct codegen* codegen,
+   int* node_count ) {
+   int count = 0;
+   struct c_node* node = codegen->node_head;
+   while ( node ) {
+      ++count;
+      node = node->next;
+   }
+   struct c_node** nodes = mem_alloc( sizeof( *nodes ) * ( count + 1 ) );
+   count = 0;
+   node = codegen->node_head;
+   while ( node ) {
+      nodes[ count ] = node;
+      if ( node->type == C_NODE_POINT ) {
+         struct c_point* point = ( struct c_point* ) node;
+         point->obj_pos = -( count + 1 );
+      }
+      ++count;
+      node = node->next;
+   }
+   *node_count = count;
+   return nodes;
+}
+
+// Checks that the control flow of the function can be fully determined.
+static bool has_known_control_flow( struct c_node** nodes, int count ) {
+   for ( int i = 0; i < count; ++i ) {
+      struct c_node* node = nodes[ i ];
+      switch ( node->type ) {
+         struct c_pcode* pcode;
+         struct c_casejump* casejump;
+      case C_NODE_JUMP:
+         if ( get_point_node( ( ( struct c_jump* ) node )->point ) < 0 ) {
+            return false;
+         }
+         break;
+      case C_NODE_CASEJUMP:
+         if ( get_point_node( ( ( struct c_casejump* ) node )->point ) < 0 ) {
+            return false;
+         }
+         break;
+      case C_NODE_SORTEDCASEJUMP:
+         casejump = ( ( struct c_sortedcasejump* ) node )->head;
+         while ( casejump ) {
+            if ( get_point_node( casejump->point ) < 0 ) {
+               return false;
+            }
+            casejump = casejump->next;
+         }
+         break;
+      case C_NODE_PCODE:
+         pcode = ( struct c_pcode* ) node;
+         // Addresses taken by instructions make the control flow unknown.
+         if ( pcode->patch ) {
+            return false;
+         }
+         switch ( pcode->code ) {
+         case PCD_GOTO:
+         case PCD_IFGOTO:
+         case PCD_IFNOTGOTO:
+         case PCD_CASEGOTOSORTED:
+         case PCD_GOTOSTACK:
+            return false;
+         default:
+            break;
+         }
+         break;
+      default:
+         break;
+      }
+   }
+   return true;
+}
+
+static void release_linear_points( struct c_node** nodes, int count ) {
+   for ( int i = 0; i < count; ++i ) {
+      if ( nodes[ i ]->type == C_NODE_POINT ) {
+         ( ( struct c_point* ) nodes[ i ] )->obj_pos = 0;
+      }
+   }
+}
+
+static bool is_slot_pcode( int code ) {
+   return ( reads_slot( code ) || writes_slot( code ) );
+}
+
+static bool reads_slot( int code ) {
+   switch ( code ) {
+   case PCD_PUSHSCRIPTVAR:
+   case PCD_ADDSCRIPTVAR:
+   case PCD_SUBSCRIPTVAR:
+   case PCD_MULSCRIPTVAR:
+   case PCD_DIVSCRIPTVAR:
+   case PCD_MODSCRIPTVAR:
+   case PCD_INCSCRIPTVAR:
+   case PCD_DECSCRIPTVAR:
+   case PCD_ANDSCRIPTVAR:
+   case PCD_EORSCRIPTVAR:
+   case PCD_ORSCRIPTVAR:
+   case PCD_LSSCRIPTVAR:
+   case PCD_RSSCRIPTVAR:
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool writes_slot( int code ) {
+   return ( code == PCD_ASSIGNSCRIPTVAR ||
+      ( code != PCD_PUSHSCRIPTVAR && reads_slot( code ) ) );
+}
+
+static int get_slot( struct c_node* node ) {
+   struct c_pcode* pcode = ( struct c_pcode* ) node;
+   return pcode->args ? pcode->args->value : -1;
+}
+
+static int get_point_node( struct c_point* point ) {
+   if ( point && point->obj_pos < 0 ) {
+      return -point->obj_pos - 1;
+   }
+   return -1;
+}
+
+static void compute_liveness( struct slot_packing* packing ) {
+   bool changed = true;
+   while ( changed ) {
+      changed = false;
+      for ( int i = packing->node_count - 1; i >= 0; --i ) {
+         if ( update_node_liveness( packing, i ) ) {
+            changed = true;
+         }
+      }
+   }
+}
+
+static bool update_node_liveness( struct slot_packing* packing, int node ) {
+   u32* live_in = packing->live_in + node * packing->set_size;
+   u32* live_out = packing->live_out + node * packing->set_size;
+   struct c_node* current = packing->nodes[ node ];
+   bool falls_through = true;
+   switch ( current->type ) {
+      struct c_jump* jump;
+      struct c_casejump* casejump;
+   case C_NODE_JUMP:
+      jump = ( struct c_jump* ) current;
+      union_node_live_in( packing, live_out, get_point_node( jump->point ) );
+      falls_through = ( jump->opcode != PCD_GOTO );
+      break;
+   case C_NODE_CASEJUMP:
+      casejump = ( struct c_casejump* ) current;
+      union_node_live_in( packing, live_out,
+         get_point_node( casejump->point ) );
+      break;
+   case C_NODE_SORTEDCASEJUMP:
+      casejump = ( ( struct c_sortedcasejump* ) current )->head;
+      while ( casejump ) {
+         union_node_live_in( packing, live_out,
+            get_point_node( casejump->point ) );
+         casejump = casejump->next;
+      }
+      break;
+   case C_NODE_PCODE:
+      switch ( ( ( struct c_pcode* ) current )->code ) {
+      case PCD_TERMINATE:
+      case PCD_RETURNVOID:
+      case PCD_RETURNVAL:
+         falls_through = false;
+         break;
+      // The variables keep their values when a script restarts.
+      case PCD_RESTART:
+         union_node_live_in( packing, live_out, 0 );
+         falls_through = false;
+         break;
+      default:
+         break;
+      }
+      break;
+   default:
+      break;
+   }
+   if ( falls_through && node + 1 < packing->node_count ) {
+      union_node_live_in( packing, live_out, node + 1 );
+   }
+   // live-in = use + ( live-out - def )
+   bool changed = false;
+   u32* updated = packing->scratch;
+   memcpy( updated, live_out, sizeof( u32 ) * packing->set_size );
+   if ( current->type == C_NODE_PCODE ) {
+      int code = ( ( struct c_pcode* ) current )->code;
+      if ( writes_slot( code ) ) {
+         set_remove( updated, get_slot( current ) );
+      }
+      if ( reads_slot( code ) ) {
+         set_add( updated, get_slot( current ) );
+      }
+   }
+   for ( int i = 0; i < packing->set_size; ++i ) {
+      if ( updated[ i ] != live_in[ i ] ) {
+         live_in[ i ] = updated[ i ];
+         changed = true;
+      }
+   }
+   return changed;
+}
+
+static void union_node_live_in( struct slot_packing* packing, u32* set,
+   int node ) {
+   u32* live_in = packing->live_in + node * packing->set_size;
+   for ( int i = 0; i < packing->set_size; ++i ) {
+      set[ i ] |= live_in[ i ];
+   }
+}
+
+static void build_interference( struct slot_packing* packing ) {
+   // A slot written by an instruction cannot share space with the slots that
+   // are live after the instruction.
+   for ( int i = 0; i < packing->node_count; ++i ) {
+      struct c_node* node = packing->nodes[ i ];
+      if ( node->type == C_NODE_PCODE &&
+         writes_slot( ( ( struct c_pcode* ) node )->code ) ) {
+         int slot = get_slot( node );
+         u32* live_out = packing->live_out + i * packing->set_size;
+         for ( int other = 0; other < packing->size; ++other ) {
+            if ( set_contains( live_out, other ) ) {
+               add_interference( packing, slot, other );
+            }
+         }
+      }
+   }
+   // Slots read before being written rely on their initial value: zero for
+   // variables, the argument for parameters. Such a slot can share space with
+   // neither a parameter nor another slot read before being written.
+   if ( packing->node_count > 0 ) {
+      u32* live_in = packing->live_in;
+      for ( int slot = 0; slot < packing->size; ++slot ) {
+         if ( set_contains( live_in, slot ) || slot < packing->param_size ) {
+            for ( int other = 0; other < packing->size; ++other ) {
+               if ( set_contains( live_in, other ) ||
+                  other < packing->param_size ) {
+                  add_interference( packing, slot, other );
+               }
+            }
+         }
+      }
+   }
+}
+
+static void add_interference( struct slot_packing* packing, int a, int b ) {
+   if ( a != b ) {
+      set_add( packing->interference + a * packing->set_size, b );
+      set_add( packing->interference + b * packing->set_size, a );
+   }
+}
+
+static bool interferes( struct slot_packing* packing, int a, int b ) {
+   return set_contains( packing->interference + a * packing->set_size, b );
+}
+
+// Greedily gives each slot the lowest slot not taken by an interfering slot.
+// Slots never referenced are dropped.
+static int assign_slots( struct slot_packing* packing ) {
+   bool* referenced = mem_alloc( sizeof( bool ) * packing->size );
+   memset( referenced, 0, sizeof( bool ) * packing->size );
+   for ( int i = 0; i < packing->node_count; ++i ) {
+      struct c_node* node = packing->nodes[ i ];
+      if ( node->type == C_NODE_PCODE &&
+         is_slot_pcode( ( ( struct c_pcode* ) node )->code ) ) {
+         referenced[ get_slot( node ) ] = true;
+      }
+   }
+   int packed_size = packing->param_size;
+   for ( int slot = 0; slot < packing->size; ++slot ) {
+      packing->slots[ slot ] = -1;
+      if ( slot < packing->param_size ) {
+         packing->slots[ slot ] = slot;
+      }
+      else if ( referenced[ slot ] ) {
+         int candidate = 0;
+         int other = 0;
+         while ( other < slot ) {
+            if ( packing->slots[ other ] == candidate &&
+               interferes( packing, slot, other ) ) {
+               ++candidate;
+               other = 0;
+            }
+            else {
+               ++other;
+            }
+         }
+         packing->slots[ slot ] = candidate;
+         if ( candidate + 1 > packed_size ) {
+            packed_size = candidate + 1;
+         }
+      }
+   }
+   mem_free( referenced );
+   return packed_size;
+}
+
+static void rename_slots( struct slot_packing* packing ) {
+   for ( int i = 0; i < packing->node_count; ++i ) {
+      struct c_node* node = packing->nodes[ i ];
+      if ( node->type == C_NODE_PCODE ) {
+         struct c_pcode* pcode = ( struct c_pcode* ) node;
+         if ( is_slot_pcode( pcode->code ) ) {
+            pcode->args->value = packing->slots[ pcode->args->value ];
+         }
+      }
+   }
+   // Copying a variable into another variable that now shares its slot does
+   // nothing.
+   struct c_node* prev = NULL;
+   int i = 0;
+   while ( i < packing->node_count ) {
+      if ( i + 1 < packing->node_count &&
+         is_self_copy( packing->nodes[ i ], packing->nodes[ i + 1 ] ) ) {
+         c_remove_node( packing->codegen, prev );
+         c_remove_node( packing->codegen, prev );
+         i += 2;
+      }
+      else {
+         prev = packing->nodes[ i ];
+         ++i;
+      }
+   }
+}
+
+static bool is_self_copy( struct c_node* push, struct c_node* assign ) {
+   if ( push->type != C_NODE_PCODE || assign->type != C_NODE_PCODE ) {
+      return false;
+   }
+   struct c_pcode* push_pcode = ( struct c_pcode* ) push;
+   struct c_pcode* assign_pcode = ( struct c_pcode* ) assign;
+   return ( push_pcode->optimize && assign_pcode->optimize &&
+      push_pcode->code == PCD_PUSHSCRIPTVAR &&
+      assign_pcode->code == PCD_ASSIGNSCRIPTVAR &&
+      push_pcode->args->value == assign_pcode->args->value );
+}
+
+static void set_add( u32* set, int slot ) {
+   set[ slot / SLOTSET_BITS ] |= ( u32 ) 1 << ( slot % SLOTSET_BITS );
+}
+
+static void set_remove( u32* set, int slot ) {
+   set[ slot / SLOTSET_BITS ] &= ~( ( u32 ) 1 << ( slot % SLOTSET_BITS ) );
+}
+
+static bool set_contains( u32* set, int slot ) {
+   return ( set[ slot / SLOTSET_BITS ] &
+      ( ( u32 ) 1 << ( slot % SLOTSET_BITS ) ) ) != 0;
+}
+
+// Local value numbering.
+// ==========================================================================
+// Element offsets are computed anew every time an element is accessed, so a
+// statement like `a[ i ].x += a[ i ].y` pushes and scales `i` twice, and every
+// use of an array reference reads its dimension information again. This pass
+// simulates the stack of each basic block with value numbers. A pure
+// computation that is repeated within a block is saved in a new slot the
+// first time it is computed and loaded from that slot afterwards. The slots
+// can later be shared with other variables by c_pack_local_slots().
+
+enum { VALUE_UNKNOWN = -1 };
+
+struct value_number {
+   int code;
+   int arg;
+   int left;
+   int right;
+   int next;
+   // Occurrences of the value in the current block.
+   int block;
+   int occurrence_head;
+   int occurrence_tail;
+   int occurrence_count;
+   int max_cost;
+};
+
+struct stack_value {
+   int number;
+   int start;
+   bool constant;
+};
+
+struct value_occurrence {
+   int start;
+   int end;
+   int next;
+};
+
+struct block_value {
+   int number;
+   int cost;
+};
+
+struct value_numbering {
+   struct codegen* codegen;
+   struct c_node** nodes;
+   struct value_number* numbers;
+   int* buckets;
+   struct stack_value* stack;
+   struct value_occurrence* occurrences;
+   int* block_numbers;
+   int* versions;
+   int* store_slot;
+   int* replace_slot;
+   bool* consumed;
+   int node_count;
+   int bucket_count;
+   int number_count;
+   int stack_size;
+   int occurrence_count;
+   int block_number_count;
+   int block;
+   int version;
+   int memory;
+   int size;
+   int reused;
+};
+
+static void number_block_values( struct value_numbering* numbering,
+   int start, int end );
+static void number_pcode( struct value_numbering* numbering, int node );
+static void push_value( struct value_numbering* numbering, int node,
+   int number, int start, bool constant );
+static struct stack_value pop_value( struct value_numbering* numbering );
+static void push_computed_value( struct value_numbering* numbering,
+   int node, int code, int arg, struct stack_value* left,
+   struct stack_value* right );
+static int find_value_number( struct value_numbering* numbering, int code,
+   int arg, int left, int right );
+static void add_occurrence( struct value_numbering* numbering, int number,
+   int start, int end );
+static void select_block_values( struct value_numbering* numbering );
+static int compare_block_value( const void* a, const void* b );
+static void select_value( struct value_numbering* numbering, int number );
+static bool range_touched( struct value_numbering* numbering,
+   struct value_occurrence* occurrence );
+static void rewrite_values( struct value_numbering* numbering );
+static bool is_pure_binary_pcode( int code );
+static bool is_commutative_pcode( int code );
+static bool is_pure_unary_pcode( int code );
+static bool is_memory_pcode( int code );
+static bool is_element_pcode( int code );
+
+// Returns the new number of slots used by the function, including the slots
+// created for saved values. The number of computations replaced by a load is
+// stored in `reused`.
+int c_number_local_values( struct codegen* codegen, int size, int* reused ) {
+   struct value_numbering numbering;
+   numbering.codegen = codegen;
+   numbering.node_count = 0;
+   *reused = 0;
+   struct c_node* node = codegen->node_head;
+   while ( node ) {
+      ++numbering.node_count;
+      node = node->next;
+   }
+   if ( numbering.node_count == 0 ) {
+      return size;
+   }
+   int count = numbering.node_count;
+   numbering.bucket_count = 1;
+   while ( numbering.bucket_count < count ) {
+      numbering.bucket_count <<= 1;
+   }
+   numbering.nodes = mem_alloc( sizeof( *numbering.nodes ) * count );
+   numbering.numbers = mem_alloc( sizeof( *numbering.numbers ) * count );
+   numbering.buckets = mem_alloc( sizeof( int ) * numbering.bucket_count );
+   numbering.stack = mem_alloc( sizeof( *numbering.stack ) * count );
+   numbering.occurrences = mem_alloc(
+      sizeof( *numbering.occurrences ) * count );
+   numbering.block_numbers = mem_alloc( sizeof( int ) * count );
+   numbering.versions = mem_alloc( sizeof( int ) * ( UCHAR_MAX + 1 ) );
+   numbering.store_slot = mem_alloc( sizeof( int ) * count );
+   numbering.replace_slot = mem_alloc( sizeof( int ) * count );
+   numbering.consumed = mem_alloc( sizeof( bool ) * count );
+   for ( int i = 0; i < numbering.bucket_count; ++i ) {
+      numbering.buckets[ i ] = VALUE_UNKNOWN;
+   }
+   for ( int i = 0; i <= UCHAR_MAX; ++i ) {
+      numbering.versions[ i ] = 0;
+   }
+   numbering.number_count = 0;
+   numbering.block = 0;
+   numbering.version = 0;
+   numbering.memory = 0;
+   numbering.size = size;
+   numbering.reused = 0;
+   int i = 0;
+   node = codegen->node_head;
+   while ( node ) {
+      numbering.nodes[ i ] = node;
+      numbering.store_slot[ i ] = -1;
+      numbering.replace_slot[ i ] = -1;
+      numbering.consumed[ i ] = false;
+      ++i;
+      node = node->next;
+   }
+   // A block is a run of instructions that is only entered at its first
+   // instruction.
+   int start = 0;
+   for ( i = 0; i < count; ++i ) {
+      if ( numbering.nodes[ i ]->type != C_NODE_PCODE ) {
+         number_block_values( &numbering, start, i );
+         start = i + 1;
+      }
+   }
+   number_block_values( &numbering, start, count );
+   if ( numbering.size > size ) {
+      rewrite_values( &numbering );
+      *reused = numbering.reused;
+   }
+   mem_free( numbering.nodes );
+   mem_free( numbering.numbers );
+   mem_free( numbering.buckets );
+   mem_free( numbering.stack );
+   mem_free( numbering.occurrences );
+   mem_free( numbering.block_numbers );
+   mem_free( numbering.versions );
+   mem_free( numbering.store_slot );
+   mem_free( numbering.replace_slot );
+   mem_free( numbering.consumed );
+   return numbering.size;
+}
+
+static void number_block_values( struct value_numbering* numbering,
+   int start, int end ) {
+   if ( end - start < 2 ) {
+      return;
+   }
+   ++numbering->block;
+   numbering->stack_size = 0;
+   numbering->occurrence_count = 0;
+   numbering->block_number_count = 0;
+   for ( int i = start; i < end; ++i ) {
+      number_pcode( numbering, i );
+   }
+   select_block_values( numbering );
+}
+
+static void number_pcode( struct value_numbering* numbering, int node ) {
+   struct c_pcode* pcode = ( struct c_pcode* ) numbering->nodes[ node ];
+   struct stack_value left;
+   struct stack_value right;
+   int code = pcode->code;
+   int arg = pcode->args ? pcode->args->value : 0;
+   bool known = ( pcode->optimize && ! pcode->patch );
+   if ( known && code == PCD_PUSHNUMBER ) {
+      push_value( numbering, node,
+         find_value_number( numbering, code, arg, 0, 0 ), node, true );
+   }
+   else if ( known && code == PCD_PUSHSCRIPTVAR && arg <= UCHAR_MAX ) {
+      push_value( numbering, node, find_value_number( numbering, code, arg,
+         numbering->versions[ arg ], 0 ), node, false );
+   }
+   else if ( known && is_pure_binary_pcode( code ) ) {
+      right = pop_value( numbering );
+      left = pop_value( numbering );
+      push_computed_value( numbering, node, code, 0, &left, &right );
+   }
+   else if ( known && is_pure_unary_pcode( code ) ) {
+      left = pop_value( numbering );
+      push_computed_value( numbering, node, code, 0, &left, NULL );
+   }
+   else if ( known && is_memory_pcode( code ) ) {
+      push_value( numbering, node, find_value_number( numbering, code, arg,
+         numbering->memory, 0 ), node, false );
+   }
+   else if ( known && is_element_pcode( code ) ) {
+      left = pop_value( numbering );
+      push_computed_value( numbering, node, code, arg, &left, NULL );
+   }
+   else if ( known && code == PCD_DUP ) {
+      left = pop_value( numbering );
+      if ( left.number != VALUE_UNKNOWN ) {
+         ++numbering->stack_size;
+      }
+      else {
+         push_value( numbering, node, VALUE_UNKNOWN, VALUE_UNKNOWN, false );
+      }
+      // The copy is made by the DUP instruction alone.
+      push_value( numbering, node, left.number, node, left.constant );
+   }
+   else if ( known && code == PCD_DROP ) {
+      pop_value( numbering );
+   }
+   else if ( known && writes_slot( code ) && arg <= UCHAR_MAX ) {
+      if ( code != PCD_INCSCRIPTVAR && code != PCD_DECSCRIPTVAR ) {
+         pop_value( numbering );
+      }
+      numbering->versions[ arg ] = ++numbering->version;
+      // A computation that is still in progress now contains the store, so it
+      // cannot be replaced by a load without losing the store.
+      for ( int i = 0; i < numbering->stack_size; ++i ) {
+         numbering->stack[ i ].start = VALUE_UNKNOWN;
+      }
+   }
+   // Any other instruction can use the stack in any way, and can change any
+   // variable or array outside the function.
+   else {
+      numbering->stack_size = 0;
+      ++numbering->memory;
+      if ( writes_slot( code ) && arg <= UCHAR_MAX ) {
+         numbering->versions[ arg ] = ++numbering->version;
+      }
+   }
+}
+
+static void push_value( struct value_numbering* numbering, int node,
+   int number, int start, bool constant ) {
+   struct stack_value* value = &numbering->stack[ numbering->stack_size ];
+   value->number = number;
+   value->start = start;
+   value->constant = constant;
+   ++numbering->stack_size;
+   if ( number != VALUE_UNKNOWN && start != VALUE_UNKNOWN && ! constant &&
+      node - start + 1 >= 3 ) {
+      add_occurrence( numbering, number, start, node );
+   }
+}
+
+static struct stack_value pop_value( struct value_numbering* numbering ) {
+   if ( numbering->stack_size > 0 ) {
+      --numbering->stack_size;
+      return numbering->stack[ numbering->stack_size ];
+   }
+   else {
+      struct stack_value value = { VALUE_UNKNOWN, VALUE_UNKNOWN, false };
+      return value;
+   }
+}
+
+static void push_computed_value( struct value_numbering* numbering,
+   int node, int code, int arg, struct stack_value* left,
+   struct stack_value* right ) {
+   if ( left->number == VALUE_UNKNOWN ||
+      ( right && right->number == VALUE_UNKNOWN ) ) {
+      push_value( numbering, node, VALUE_UNKNOWN, VALUE_UNKNOWN, false );
+      return;
+   }
+   int left_number = left->number;
+   int right_number = right ? right->number : 0;
+   // Operands of a commutative operation are ordered so both orders produce
+   // the same value number.
+   if ( right && is_commutative_pcode( code ) &&
+      left_number > right_number ) {
+      left_number = right->number;
+      right_number = left->number;
+   }
+   // Element reads depend on the contents of memory.
+   if ( is_element_pcode( code ) ) {
+      right_number = numbering->memory;
+   }
+   int number = find_value_number( numbering, code, arg, left_number,
+      right_number );
+   int start = left->start;
+   if ( right && right->start == VALUE_UNKNOWN ) {
+      start = VALUE_UNKNOWN;
+   }
+   bool constant = ( left->constant && ( ! right || right->constant ) &&
+      ! is_element_pcode( code ) );
+   push_value( numbering, node, number, start, constant );
+}
+
+static int find_value_number( struct value_numbering* numbering, int code,
+   int arg, int left, int right ) {
+   unsigned int hash = ( unsigned int ) code * 31u + ( unsigned int ) arg;
+   hash = hash * 31u + ( unsigned int ) left;
+   hash = hash * 31u + ( unsigned int ) right;
+   hash &= ( unsigned int ) numbering->bucket_count - 1;
+   int number = numbering->buckets[ hash ];
+   while ( number != VALUE_UNKNOWN ) {
+      struct value_number* value = &numbering->numbers[ number ];
+      if ( value->code == code && value->arg == arg && value->left == left &&
+         value->right == right ) {
+         return number;
+      }
+      number = value->next;
+   }
+   number = numbering->number_count;
+   ++numbering->number_count;
+   struct value_number* value = &numbering->numbers[ number ];
+   value->code = code;
+   value->arg = arg;
+   value->left = left;
+   value->right = right;
+   value->next = numbering->buckets[ hash ];
+   value->block = 0;
+   numbering->buckets[ hash ] = number;
+   return number;
+}
+
+static void add_occurrence( struct value_numbering* numbering, int number,
+   int start, int end ) {
+   struct value_number* value = &numbering->numbers[ number ];
+   if ( value->block != numbering->block ) {
+      value->block = numbering->block;
+      value->occurrence_head = VALUE_UNKNOWN;
+      value->occurrence_tail = VALUE_UNKNOWN;
+      value->occurrence_count = 0;
+      value->max_cost = 0;
+      numbering->block_numbers[ numbering->block_number_count ] = number;
+      ++numbering->block_number_count;
+   }
+   int index = numbering->occurrence_count;
+   ++numbering->occurrence_count;
+   struct value_occurrence* occurrence = &numbering->occurrences[ index ];
+   occurrence->start = start;
+   occurrence->end = end;
+   occurrence->next = VALUE_UNKNOWN;
+   if ( value->occurrence_tail != VALUE_UNKNOWN ) {
+      numbering->occurrences[ value->occurrence_tail ].next = index;
+   }
+   else {
+      value->occurrence_head = index;
+   }
+   value->occurrence_tail = index;
+   ++value->occurrence_count;
+   if ( end - start + 1 > value->max_cost ) {
+      value->max_cost = end - start + 1;
+   }
+}
+
+// Larger computations are considered first, so a computation that contains
+// a smaller one is replaced whole.
+static void select_block_values( struct value_numbering* numbering ) {
+   int count = 0;
+   for ( int i = 0; i < numbering->block_number_count; ++i ) {
+      int number = numbering->block_numbers[ i ];
+      if ( numbering->numbers[ number ].occurrence_count >= 2 ) {
+         numbering->block_numbers[ count ] = number;
+         ++count;
+      }
+   }
+   if ( count == 0 ) {
+      return;
+   }
+   struct block_value* values = mem_alloc( sizeof( *values ) * count );
+   for ( int i = 0; i < count; ++i ) {
+      values[ i ].number = numbering->block_numbers[ i ];
+      values[ i ].cost = numbering->numbers[ values[ i ].number ].max_cost;
+   }
+   qsort( values, count, sizeof( *values ), compare_block_value );
+   for ( int i = 0; i < count; ++i ) {
+      select_value( numbering, values[ i ].number );
+   }
+   mem_free( values );
+}
+
+static int compare_block_value( const void* a, const void* b ) {
+   const struct block_value* value_a = a;
+   const struct block_value* value_b = b;
+   if ( value_a->cost != value_b->cost ) {
+      return value_b->cost - value_a->cost;
+   }
+   return value_a->number - value_b->number;
+}
+
+static void select_value( struct value_numbering* numbering, int number ) {
+   struct value_number* value = &numbering->numbers[ number ];
+   // The first computation of the value that is still in place saves the
+   // value. The later computations that do not overlap a rewritten range are
+   // replaced by a load.
+   struct value_occurrence* first = NULL;
+   int saved = 0;
+   int index = value->occurrence_head;
+   while ( index != VALUE_UNKNOWN ) {
+      struct value_occurrence* occurrence = &numbering->occurrences[ index ];
+      if ( ! first ) {
+         if ( ! numbering->consumed[ occurrence->start ] ) {
+            first = occurrence;
+         }
+      }
+      else if ( ! range_touched( numbering, occurrence ) ) {
+         saved += occurrence->end - occurrence->start;
+      }
+      index = occurrence->next;
+   }
+   // Saving the value costs two instructions.
+   if ( ! first || saved <= 2 || numbering->store_slot[ first->end ] != -1 ||
+      numbering->size >= UCHAR_MAX ) {
+      return;
+   }
+   int slot = numbering->size;
+   ++numbering->size;
+   numbering->store_slot[ first->end ] = slot;
+   index = value->occurrence_head;
+   while ( index != VALUE_UNKNOWN ) {
+      struct value_occurrence* occurrence = &numbering->occurrences[ index ];
+      if ( occurrence != first && occurrence->start > first->end &&
+         ! range_touched( numbering, occurrence ) ) {
+         numbering->replace_slot[ occurrence->start ] = slot;
+         for ( int i = occurrence->start; i <= occurrence->end; ++i ) {
+            numbering->consumed[ i ] = true;
+         }
+         ++numbering->reused;
+      }
+      index = occurrence->next;
+   }
+}
+
+static bool range_touched( struct value_numbering* numbering,
+   struct value_occurrence* occurrence ) {
+   for ( int i = occurrence->start; i <= occurrence->end; ++i ) {
+      if ( numbering->consumed[ i ] || numbering->store_slot[ i ] != -1 ) {
+         return true;
+      }
+   }
+   return false;
+}
+
+static void rewrite_values( struct value_numbering* numbering ) {
+   struct codegen* codegen = numbering->codegen;
+   struct c_node* prev = NULL;
+   for ( int i = 0; i < numbering->node_count; ++i ) {
+      struct c_node* node = numbering->nodes[ i ];
+      if ( numbering->consumed[ i ] ) {
+         c_remove_node( codegen, prev );
+         if ( numbering->replace_slot[ i ] != -1 ) {
+            c_seek_node( codegen, prev );
+            c_pcd( codegen, PCD_PUSHSCRIPTVAR, numbering->replace_slot[ i ] );
+            prev = codegen->node;
+         }
+      }
+      else {
+         prev = node;
+         if ( numbering->store_slot[ i ] != -1 ) {
+            c_seek_node( codegen, node );
+            c_pcd( codegen, PCD_DUP );
+            c_pcd( codegen, PCD_ASSIGNSCRIPTVAR, numbering->store_slot[ i ] );
+            prev = codegen->node;
+         }
+      }
+   }
+   c_seek_node( codegen, codegen->node_tail );
+}
+
+static bool is_pure_binary_pcode( int code ) {
+   switch ( code ) {
+   case PCD_ADD:
+   case PCD_SUBTRACT:
+   case PCD_MULTIPLY:
+   case PCD_DIVIDE:
+   case PCD_MODULUS:
+   case PCD_LSHIFT:
+   case PCD_RSHIFT:
+   case PCD_ANDBITWISE:
+   case PCD_ORBITWISE:
+   case PCD_EORBITWISE:
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool is_commutative_pcode( int code ) {
+   switch ( code ) {
+   case PCD_ADD:
+   case PCD_MULTIPLY:
+   case PCD_ANDBITWISE:
+   case PCD_ORBITWISE:
+   case PCD_EORBITWISE:
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool is_pure_unary_pcode( int code ) {
+   return ( code == PCD_UNARYMINUS || code == PCD_NEGATEBINARY );
+}
+
+static bool is_memory_pcode( int code ) {
+   switch ( code ) {
+   case PCD_PUSHMAPVAR:
+   case PCD_PUSHWORLDVAR:
+   case PCD_PUSHGLOBALVAR:
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool is_element_pcode( int code ) {
+   switch ( code ) {
+   case PCD_PUSHMAPARRAY:
+   case PCD_PUSHWORLDARRAY:
+   case PCD_PUSHGLOBALARRAY:
+   case PCD_PUSHSCRIPTARRAY:
+      return true;
+   default:
+      return false;
+   }
+}
+
+// Loop optimization.
+// ==========================================================================
+// Loops are written exactly as in the source, so a computation that produces
+// the same value in every iteration, like the size of a sub-array read from
+// the dimension information, runs again in every iteration. This pass finds
+// the loops of the linear code and moves such computations in front of the
+// loop. An offset that changes by a fixed amount whenever a loop counter is
+// incremented, like `i * 3 + 1`, is replaced by a variable that is advanced
+// together with the counter.
+
+enum {
+   LOOPVALUE_VARIANT,
+   LOOPVALUE_INVARIANT,
+   LOOPVALUE_INDUCTION
+};
+
+struct loop_value {
+   int kind;
+   int start;
+   // For an induction value: the counter it depends on, and how much the
+   // value changes when the counter is incremented by one.
+   int var;
+   int factor;
+   int constant_value;
+   bool constant;
+};
+
+struct loop_candidate {
+   int start;
+   int end;
+   int kind;
+   int var;
+   int factor;
+   int slot;
+   // Set when the same computation appears earlier in the loop, in which case
+   // the variable of the earlier computation is reused.
+   bool repeated;
+};
+
+struct loop_optimization {
+   struct codegen* codegen;
+   struct c_node** nodes;
+   struct c_jump** done_jumps;
+   struct loop_value* stack;
+   struct loop_candidate* candidates;
+   bool* consumed;
+   int writes[ UCHAR_MAX + 1 ];
+   bool induction[ UCHAR_MAX + 1 ];
+   int node_count;
+   int done_count;
+   int stack_size;
+   int candidate_count;
+   int start;
+   int end;
+   int size;
+   int hoisted;
+   int reduced;
+   bool memory_written;
+};
+
+static bool find_loop( struct loop_optimization* optimization );
+static bool is_loop_entered_at_start( struct loop_optimization* optimization );
+static bool node_jumps_into_loop( struct loop_optimization* optimization,
+   struct c_node* node );
+static bool is_in_loop( struct loop_optimization* optimization,
+   struct c_point* point );
+static bool analyze_loop_writes( struct loop_optimization* optimization );
+static bool get_increment( struct loop_optimization* optimization, int node,
+   int* step );
+static void find_loop_candidates( struct loop_optimization* optimization );
+static void visit_loop_pcode( struct loop_optimization* optimization,
+   int node );
+static void push_loop_value( struct loop_optimization* optimization,
+   struct loop_value* value, int node );
+static struct loop_value pop_loop_value(
+   struct loop_optimization* optimization );
+static void combine_loop_values( int code, struct loop_value* left,
+   struct loop_value* right, struct loop_value* result );
+static void select_loop_candidates( struct loop_optimization* optimization );
+static int compare_loop_candidate( const void* a, const void* b );
+static int get_induction_update_cost( struct loop_optimization* optimization,
+   struct loop_candidate* candidate );
+static struct loop_candidate* find_same_candidate(
+   struct loop_optimization* optimization, struct loop_candidate* candidate );
+static bool same_pcode( struct c_pcode* a, struct c_pcode* b );
+static void rewrite_loop( struct loop_optimization* optimization );
+static void update_induction_value( struct loop_optimization* optimization,
+   struct loop_candidate* candidate );
+static bool preserves_memory( int code );
+
+// Returns the new number of slots used by the function, including the slots
+// created for the moved computations.
+int c_optimize_loops( struct codegen* codegen, int size, int* hoisted,
+   int* reduced ) {
+   struct loop_optimization optimization;
+   optimization.codegen = codegen;
+   optimization.done_jumps = NULL;
+   optimization.done_count = 0;
+   optimization.size = size;
+   optimization.hoisted = 0;
+   optimization.reduced = 0;
+   bool checked = false;
+   while ( true ) {
+      optimization.nodes = collect_linear_nodes( codegen,
+         &optimization.node_count );
+      bool found = false;
+      if ( checked || has_known_control_flow( optimization.nodes,
+         optimization.node_count ) ) {
+         checked = true;
+         found = find_loop( &optimization );
+      }
+      if ( found && is_loop_entered_at_start( &optimization ) &&
+         analyze_loop_writes( &optimization ) ) {
+         int count = optimization.node_count;
+         optimization.stack = mem_alloc(
+            sizeof( *optimization.stack ) * count );
+         optimization.candidates = mem_alloc(
+            sizeof( *optimization.candidates ) * count );
+         optimization.consumed = mem_alloc( sizeof( bool ) * count );
+         memset( optimization.consumed, 0, sizeof( bool ) * count );
+         find_loop_candidates( &optimization );
+         select_loop_candidates( &optimization );
+         rewrite_loop( &optimization );
+         mem_free( optimization.stack );
+         mem_free( optimization.candidates );
+         mem_free( optimization.consumed );
+      }
+      release_linear_points( optimization.nodes, optimization.node_count );
+      mem_free( optimization.nodes );
+      if ( ! found ) {
+         break;
+      }
+   }
+   if ( optimization.done_jumps ) {
+      mem_free( optimization.done_jumps );
+   }
+   *hoisted += optimization.hoisted;
+   *reduced += optimization.reduced;
+   return optimization.size;
+}
+
+// Finds the innermost loop not yet optimized. A loop ends with a jump back to
+// an earlier point.
+static bool find_loop( struct loop_optimization* optimization ) {
+   int best_start = -1;
+   int best_end = -1;
+   for ( int i = 0; i < optimization->node_count; ++i ) {
+      struct c_node* node = optimization->nodes[ i ];
+      if ( node->type != C_NODE_JUMP ) {
+         continue;
+      }
+      struct c_jump* jump = ( struct c_jump* ) node;
+      int target = get_point_node( jump->point );
+      if ( target >= i ) {
+         continue;
+      }
+      bool done = false;
+      for ( int k = 0; k < optimization->done_count; ++k ) {
+         if ( optimization->done_jumps[ k ] == jump ) {
+            done = true;
+            break;
+         }
+      }
+      if ( ! done && ( best_end == -1 ||
+         i - target < best_end - best_start ) ) {
+         best_start = target;
+         best_end = i;
+      }
+   }
+   if ( best_end == -1 ) {
+      return false;
+   }
+   optimization->done_jumps = mem_realloc( optimization->done_jumps,
+      sizeof( *optimization->done_jumps ) * ( optimization->done_count + 1 ) );
+   optimization->done_jumps[ optimization->done_count ] =
+      ( struct c_jump* ) optimization->nodes[ best_end ];
+   ++optimization->done_count;
+   optimization->start = best_start;
+   optimization->end = best_end;
+   // The condition of while-loops and for-loops is placed after the body, and
+   // is reached with a jump written right before the body.
+   if ( best_start > 0 &&
+      optimization->nodes[ best_start - 1 ]->type == C_NODE_JUMP ) {
+      struct c_jump* jump = ( struct c_jump* )
+         optimization->nodes[ best_start - 1 ];
+      int target = get_point_node( jump->point );
+      if ( jump->opcode == PCD_GOTO && target > best_start &&
+         target <= best_end ) {
+         optimization->start = best_start - 1;
+      }
+   }
+   return true;
+}
+
+// Code placed in front of the loop only runs for every entry into the loop
+// when the loop can only be entered from the front.
+static bool is_loop_entered_at_start(
+   struct loop_optimization* optimization ) {
+   if ( optimization->start == 0 ) {
+      return false;
+   }
+   for ( int i = 0; i < optimization->node_count; ++i ) {
+      if ( ( i < optimization->start || i > optimization->end ) &&
+         node_jumps_into_loop( optimization, optimization->nodes[ i ] ) ) {
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool node_jumps_into_loop( struct loop_optimization* optimization,
+   struct c_node* node ) {
+   switch ( node->type ) {
+      struct c_casejump* casejump;
+   case C_NODE_JUMP:
+      return is_in_loop( optimization, ( ( struct c_jump* ) node )->point );
+   case C_NODE_CASEJUMP:
+      return is_in_loop( optimization,
+         ( ( struct c_casejump* ) node )->point );
+   case C_NODE_SORTEDCASEJUMP:
+      casejump = ( ( struct c_sortedcasejump* ) node )->head;
+      while ( casejump ) {
+         if ( is_in_loop( optimization, casejump->point ) ) {
+            return true;
+         }
+         casejump = casejump->next;
+      }
+      return false;
+   default:
+      return false;
+   }
+}
+
+static bool is_in_loop( struct loop_optimization* optimization,
+   struct c_point* point ) {
+   int node = get_point_node( point );
+   return ( node >= optimization->start && node <= optimization->end );
+}
+
+// Finds the variables changed in the loop, and whether memory can change. A
+// counter is a variable only ever changed by adding a constant.
+static bool analyze_loop_writes( struct loop_optimization* optimization ) {
+   for ( int i = 0; i <= UCHAR_MAX; ++i ) {
+      optimization->writes[ i ] = 0;
+      optimization->induction[ i ] = true;
+   }
+   optimization->memory_written = false;
+   for ( int i = optimization->start; i <= optimization->end; ++i ) {
+      struct c_node* node = optimization->nodes[ i ];
+      if ( node->type != C_NODE_PCODE ) {
+         continue;
+      }
+      struct c_pcode* pcode = ( struct c_pcode* ) node;
+      if ( writes_slot( pcode->code ) ) {
+         int slot = get_slot( node );
+         if ( slot < 0 || slot > UCHAR_MAX ) {
+            return false;
+         }
+         int step = 0;
+         ++optimization->writes[ slot ];
+         if ( ! get_increment( optimization, i, &step ) ) {
+            optimization->induction[ slot ] = false;
+         }
+      }
+      else if ( ! pcode->optimize || ! preserves_memory( pcode->code ) ) {
+         optimization->memory_written = true;
+      }
+   }
+   return true;
+}
+
+static bool get_increment( struct loop_optimization* optimization, int node,
+   int* step ) {
+   struct c_pcode* pcode = ( struct c_pcode* ) optimization->nodes[ node ];
+   switch ( pcode->code ) {
+   case PCD_INCSCRIPTVAR:
+      *step = 1;
+      return true;
+   case PCD_DECSCRIPTVAR:
+      *step = -1;
+      return true;
+   case PCD_ADDSCRIPTVAR:
+   case PCD_SUBSCRIPTVAR:
+      if ( node > optimization->start &&
+         optimization->nodes[ node - 1 ]->type == C_NODE_PCODE ) {
+         struct c_pcode* operand = ( struct c_pcode* )
+            optimization->nodes[ node - 1 ];
+         if ( operand->code == PCD_PUSHNUMBER && operand->optimize ) {
+            *step = ( pcode->code == PCD_ADDSCRIPTVAR ) ?
+               operand->args->value :
+               ( int ) ( 0u - ( unsigned int ) operand->args->value );
+            return true;
+         }
+      }
+      return false;
+   default:
+      return false;
+   }
+}
+
+static void find_loop_candidates( struct loop_optimization* optimization ) {
+   optimization->stack_size = 0;
+   optimization->candidate_count = 0;
+   for ( int i = optimization->start; i <= optimization->end; ++i ) {
+      if ( optimization->nodes[ i ]->type == C_NODE_PCODE ) {
+         visit_loop_pcode( optimization, i );
+      }
+      else {
+         optimization->stack_size = 0;
+      }
+   }
+}
+
+static void visit_loop_pcode( struct loop_optimization* optimization,
+   int node ) {
+   struct c_pcode* pcode = ( struct c_pcode* ) optimization->nodes[ node ];
+   struct loop_value value = { LOOPVALUE_VARIANT, node, 0, 0, 0, false };
+   struct loop_value left;
+   struct loop_value right;
+   int code = pcode->code;
+   int arg = pcode->args ? pcode->args->value : 0;
+   if ( ! pcode->optimize ) {
+      optimization->stack_size = 0;
+   }
+   else if ( code == PCD_PUSHNUMBER ) {
+      value.kind = LOOPVALUE_INVARIANT;
+      value.constant = true;
+      value.constant_value = arg;
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( code == PCD_PUSHSCRIPTVAR ) {
+      if ( arg < 0 || arg > UCHAR_MAX ) {
+         value.start = -1;
+      }
+      else if ( optimization->writes[ arg ] == 0 ) {
+         value.kind = LOOPVALUE_INVARIANT;
+      }
+      else if ( optimization->induction[ arg ] ) {
+         value.kind = LOOPVALUE_INDUCTION;
+         value.var = arg;
+         value.factor = 1;
+      }
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( is_memory_pcode( code ) ) {
+      if ( ! optimization->memory_written ) {
+         value.kind = LOOPVALUE_INVARIANT;
+      }
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( is_pure_binary_pcode( code ) ) {
+      right = pop_loop_value( optimization );
+      left = pop_loop_value( optimization );
+      combine_loop_values( code, &left, &right, &value );
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( is_pure_unary_pcode( code ) ) {
+      left = pop_loop_value( optimization );
+      value.start = left.start;
+      if ( left.kind == LOOPVALUE_INVARIANT ) {
+         value.kind = LOOPVALUE_INVARIANT;
+      }
+      else if ( left.kind == LOOPVALUE_INDUCTION &&
+         code == PCD_UNARYMINUS ) {
+         value = left;
+         value.factor = ( int ) ( 0u - ( unsigned int ) left.factor );
+      }
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( is_element_pcode( code ) ) {
+      left = pop_loop_value( optimization );
+      value.start = left.start;
+      if ( left.kind == LOOPVALUE_INVARIANT &&
+         ! optimization->memory_written ) {
+         value.kind = LOOPVALUE_INVARIANT;
+      }
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( code == PCD_DUP ) {
+      left = pop_loop_value( optimization );
+      push_loop_value( optimization, &left, -1 );
+      // The copy depends on a value computed before it, so it cannot be
+      // moved on its own.
+      value.start = -1;
+      push_loop_value( optimization, &value, node );
+   }
+   else if ( code == PCD_DROP ) {
+      pop_loop_value( optimization );
+   }
+   else if ( writes_slot( code ) ) {
+      if ( code != PCD_INCSCRIPTVAR && code != PCD_DECSCRIPTVAR ) {
+         pop_loop_value( optimization );
+      }
+      // A computation that is still in progress now contains the store, which
+      // must stay in the loop.
+      for ( int i = 0; i < optimization->stack_size; ++i ) {
+         optimization->stack[ i ].start = -1;
+      }
+   }
+   else {
+      optimization->stack_size = 0;
+   }
+}
+
+// Pushes a value. A value computed by the instructions that precede it is
+// recorded as a candidate for moving when it does not change in the loop, or
+// for strength reduction when it follows a counter.
+static void push_loop_value( struct loop_optimization* optimization,
+   struct loop_value* value, int node ) {
+   optimization->stack[ optimization->stack_size ] = *value;
+   ++optimization->stack_size;
+   if ( node < 0 || value->start < 0 || value->constant ) {
+      return;
+   }
+   int cost = node - value->start + 1;
+   if ( ( value->kind == LOOPVALUE_INVARIANT && cost >= 2 ) ||
+      ( value->kind == LOOPVALUE_INDUCTION && cost >= 3 ) ) {
+      struct loop_candidate* candidate =
+         &optimization->candidates[ optimization->candidate_count ];
+      candidate->start = value->start;
+      candidate->end = node;
+      candidate->kind = value->kind;
+      candidate->var = value->var;
+      candidate->factor = value->factor;
+      candidate->slot = -1;
+      candidate->repeated = false;
+      ++optimization->candidate_count;
+   }
+}
+
+static struct loop_value pop_loop_value(
+   struct loop_optimization* optimization ) {
+   if ( optimization->stack_size > 0 ) {
+      --optimization->stack_size;
+      return optimization->stack[ optimization->stack_size ];
+   }
+   else {
+      struct loop_value value = { LOOPVALUE_VARIANT, -1, 0, 0, 0, false };
+      return value;
+   }
+}
+
+static void combine_loop_values( int code, struct loop_value* left,
+   struct loop_value* right, struct loop_value* result ) {
+   int start = ( left->start >= 0 && right->start >= 0 ) ?
+      left->start : -1;
+   // Constant operands are folded, so the constant can be used as a factor.
+   if ( left->constant && right->constant ) {
+      unsigned int l = ( unsigned int ) left->constant_value;
+      unsigned int r = ( unsigned int ) right->constant_value;
+      result->kind = LOOPVALUE_INVARIANT;
+      switch ( code ) {
+      case PCD_ADD:
+         result->constant_value = ( int ) ( l + r );
+         result->constant = true;
+         break;
+      case PCD_SUBTRACT:
+         result->constant_value = ( int ) ( l - r );
+         result->constant = true;
+         break;
+      case PCD_MULTIPLY:
+         result->constant_value = ( int ) ( l * r );
+         result->constant = true;
+         break;
+      case PCD_DIVIDE:
+      case PCD_MODULUS:
+         result->kind = LOOPVALUE_VARIANT;
+         break;
+      default:
+         break;
+      }
+   }
+   else if ( left->kind == LOOPVALUE_INVARIANT &&
+      right->kind == LOOPVALUE_INVARIANT ) {
+      // A division is not moved, because it might divide by zero in a loop
+      // that never runs.
+      if ( code != PCD_DIVIDE && code != PCD_MODULUS ) {
+         result->kind = LOOPVALUE_INVARIANT;
+      }
+   }
+   else if ( code == PCD_ADD || code == PCD_SUBTRACT ) {
+      bool subtract = ( code == PCD_SUBTRACT );
+      if ( left->kind == LOOPVALUE_INDUCTION &&
+         right->kind == LOOPVALUE_INVARIANT ) {
+         *result = *left;
+      }
+      else if ( left->kind == LOOPVALUE_INVARIANT &&
+         right->kind == LOOPVALUE_INDUCTION ) {
+         *result = *right;
+         if ( subtract ) {
+            result->factor = ( int ) ( 0u - ( unsigned int ) right->factor );
+         }
+      }
+   }
+   else if ( code == PCD_MULTIPLY || code == PCD_LSHIFT ) {
+      struct loop_value* counter = left;
+      struct loop_value* constant = right;
+      if ( code == PCD_MULTIPLY && left->constant ) {
+         counter = right;
+         constant = left;
+      }
+      if ( counter->kind == LOOPVALUE_INDUCTION && constant->constant ) {
+         unsigned int factor = ( unsigned int ) counter->factor;
+         unsigned int amount = ( unsigned int ) constant->constant_value;
+         if ( code == PCD_MULTIPLY ) {
+            factor *= amount;
+         }
+         else if ( amount < 32 ) {
+            factor <<= amount;
+         }
+         else {
+            factor = 0;
+         }
+         if ( factor != 0 ) {
+            *result = *counter;
+            result->factor = ( int ) factor;
+         }
+      }
+   }
+   result->start = start;
+   if ( start < 0 ) {
+      result->kind = LOOPVALUE_VARIANT;
+      result->constant = false;
+   }
+}
+
+// Larger computations are considered first, so a computation that contains
+// a smaller one is handled whole.
+static void select_loop_candidates( struct loop_optimization* optimization ) {
+   qsort( optimization->candidates, optimization->candidate_count,
+      sizeof( *optimization->candidates ), compare_loop_candidate );
+   for ( int i = 0; i < optimization->candidate_count; ++i ) {
+      struct loop_candidate* candidate = &optimization->candidates[ i ];
+      bool touched = false;
+      for ( int k = candidate->start; k <= candidate->end; ++k ) {
+         if ( optimization->consumed[ k ] ) {
+            touched = true;
+            break;
+         }
+      }
+      if ( touched ) {
+         continue;
+      }
+      struct loop_candidate* same = find_same_candidate( optimization,
+         candidate );
+      if ( same ) {
+         candidate->slot = same->slot;
+         candidate->repeated = true;
+         for ( int k = candidate->start; k <= candidate->end; ++k ) {
+            optimization->consumed[ k ] = true;
+         }
+         continue;
+      }
+      if ( optimization->size >= UCHAR_MAX ) {
+         continue;
+      }
+      // Each increment of the counter now also has to advance the
+      // replacement variable.
+      if ( candidate->kind == LOOPVALUE_INDUCTION &&
+         get_induction_update_cost( optimization, candidate ) >=
+         candidate->end - candidate->start ) {
+         continue;
+      }
+      candidate->slot = optimization->size;
+      ++optimization->size;
+      for ( int k = candidate->start; k <= candidate->end; ++k ) {
+         optimization->consumed[ k ] = true;
+      }
+      if ( candidate->kind == LOOPVALUE_INDUCTION ) {
+         ++optimization->reduced;
+      }
+      else {
+         ++optimization->hoisted;
+      }
+   }
+}
+
+static int compare_loop_candidate( const void* a, const void* b ) {
+   const struct loop_candidate* candidate_a = a;
+   const struct loop_candidate* candidate_b = b;
+   int cost_a = candidate_a->end - candidate_a->start;
+   int cost_b = candidate_b->end - candidate_b->start;
+   if ( cost_a != cost_b ) {
+      return cost_b - cost_a;
+   }
+   return candidate_a->start - candidate_b->start;
+}
+
+static int get_induction_update_cost( struct loop_optimization* optimization,
+   struct loop_candidate* candidate ) {
+   int cost = 0;
+   for ( int i = optimization->start; i <= optimization->end; ++i ) {
+      struct c_node* node = optimization->nodes[ i ];
+      int step = 0;
+      if ( node->type == C_NODE_PCODE &&
+         writes_slot( ( ( struct c_pcode* ) node )->code ) &&
+         get_slot( node ) == candidate->var &&
+         get_increment( optimization, i, &step ) ) {
+         unsigned int amount = ( unsigned int ) step *
+            ( unsigned int ) candidate->factor;
+         if ( amount != 0 ) {
+            cost += ( amount == 1 || amount == UINT_MAX ) ? 1 : 2;
+         }
+      }
+   }
+   return cost;
+}
+
+static struct loop_candidate* find_same_candidate(
+   struct loop_optimization* optimization, struct loop_candidate* candidate ) {
+   for ( int i = 0; i < optimization->candidate_count; ++i ) {
+      struct loop_candidate* other = &optimization->candidates[ i ];
+      if ( other != candidate && other->slot != -1 && ! other->repeated &&
+         other->kind == candidate->kind &&
+         other->end - other->start == candidate->end - candidate->start ) {
+         int k = 0;
+         while ( k <= other->end - other->start && same_pcode(
+            ( struct c_pcode* ) optimization->nodes[ other->start + k ],
+            ( struct c_pcode* ) optimization->nodes[ candidate->start + k ] ) ) {
+            ++k;
+         }
+         if ( k > other->end - other->start ) {
+            return other;
+         }
+      }
+   }
+   return NULL;
+}
+
+static bool same_pcode( struct c_pcode* a, struct c_pcode* b ) {
+   if ( a->code != b->code ) {
+      return false;
+   }
+   struct c_pcode_arg* arg_a = a->args;
+   struct c_pcode_arg* arg_b = b->args;
+   while ( arg_a && arg_b && arg_a->value == arg_b->value ) {
+      arg_a = arg_a->next;
+      arg_b = arg_b->next;
+   }
+   return ( arg_a == NULL && arg_b == NULL );
+}
+
+static void rewrite_loop( struct loop_optimization* optimization ) {
+   struct codegen* codegen = optimization->codegen;
+   struct c_node** nodes = optimization->nodes;
+   // Compute the initial values in front of the loop.
+   c_seek_node( codegen, nodes[ optimization->start - 1 ] );
+   for ( int i = 0; i < optimization->candidate_count; ++i ) {
+      struct loop_candidate* candidate = &optimization->candidates[ i ];
+      if ( candidate->slot == -1 || candidate->repeated ) {
+         continue;
+      }
+      for ( int k = candidate->start; k <= candidate->end; ++k ) {
+         struct c_pcode* pcode = ( struct c_pcode* ) nodes[ k ];
+         c_opc( codegen, pcode->code );
+         struct c_pcode_arg* arg = pcode->args;
+         while ( arg ) {
+            c_arg( codegen, arg->value );
+            arg = arg->next;
+         }
+      }
+      c_pcd( codegen, PCD_ASSIGNSCRIPTVAR, candidate->slot );
+   }
+   // Replace the computations in the loop with the variables.
+   for ( int i = 0; i < optimization->candidate_count; ++i ) {
+      struct loop_candidate* candidate = &optimization->candidates[ i ];
+      if ( candidate->slot == -1 ) {
+         continue;
+      }
+      for ( int k = candidate->start + 1; k <= candidate->end; ++k ) {
+         c_remove_node( codegen, nodes[ candidate->start ] );
+      }
+      struct c_pcode* pcode = ( struct c_pcode* ) nodes[ candidate->start ];
+      pcode->code = PCD_PUSHSCRIPTVAR;
+      pcode->args->value = candidate->slot;
+      if ( candidate->kind == LOOPVALUE_INDUCTION && ! candidate->repeated ) {
+         update_induction_value( optimization, candidate );
+      }
+   }
+   c_seek_node( codegen, codegen->node_tail );
+}
+
+static void update_induction_value( struct loop_optimization* optimization,
+   struct loop_candidate* candidate ) {
+   struct codegen* codegen = optimization->codegen;
+   for ( int i = optimization->start; i <= optimization->end; ++i ) {
+      struct c_node* node = optimization->nodes[ i ];
+      int step = 0;
+      if ( ! optimization->consumed[ i ] && node->type == C_NODE_PCODE &&
+         writes_slot( ( ( struct c_pcode* ) node )->code ) &&
+         get_slot( node ) == candidate->var &&
+         get_increment( optimization, i, &step ) ) {
+         int amount = ( int ) ( ( unsigned int ) step *
+            ( unsigned int ) candidate->factor );
+         c_seek_node( codegen, node );
+         if ( amount == 1 ) {
+            c_pcd( codegen, PCD_INCSCRIPTVAR, candidate->slot );
+         }
+         else if ( amount == -1 ) {
+            c_pcd( codegen, PCD_DECSCRIPTVAR, candidate->slot );
+         }
+         else if ( amount != 0 ) {
+            c_pcd( codegen, PCD_PUSHNUMBER, amount );
+            c_pcd( codegen, PCD_ADDSCRIPTVAR, candidate->slot );
+         }
+      }
+   }
+}
+
+// Instructions that change neither arrays nor variables outside the
+// function, and do not let other scripts run.
+static bool preserves_memory( int code ) {
+   switch ( code ) {
+   case PCD_PUSHNUMBER:
+   case PCD_PUSHSCRIPTVAR:
+   case PCD_EQ:
+   case PCD_NE:
+   case PCD_LT:
+   case PCD_GT:
+   case PCD_LE:
+   case PCD_GE:
+   case PCD_ANDLOGICAL:
+   case PCD_ORLOGICAL:
+   case PCD_NEGATELOGICAL:
+   case PCD_DUP:
+   case PCD_DROP:
+   case PCD_SWAP:
+   case PCD_BEGINPRINT:
+   case PCD_PRINTSTRING:
+   case PCD_PRINTNUMBER:
+   case PCD_PRINTCHARACTER:
+   case PCD_ENDPRINT:
+   case PCD_ENDPRINTBOLD:
+   case PCD_ENDLOG:
+   case PCD_TAGSTRING:
+   case PCD_TERMINATE:
+   case PCD_RETURNVOID:
+   case PCD_RETURNVAL:
+      return true;
+   default:
+      return ( is_pure_binary_pcode( code ) || is_pure_unary_pcode( code ) ||
+         is_memory_pcode( code ) || is_element_pcode( code ) );
+   }
+}
@@ -418,38 +418,47 @@ struct pcode* c_get_pcode_info( int code ) {
    return NULL;
 }
 
-static struct direct_pcode g_direct_pcode_table[] = {
-   { PCD_LSPEC1, PCD_LSPEC1DIRECT, 1 },
-   { PCD_LSPEC2, PCD_LSPEC2DIRECT, 2 },
-   { PCD_LSPEC3, PCD_LSPEC3DIRECT, 3 },
-   { PCD_LSPEC4, PCD_LSPEC4DIRECT, 4 },
-   { PCD_LSPEC5, PCD_LSPEC5DIRECT, 5 },
-   { PCD_DELAY, PCD_DELAYDIRECT, 1 },
-   { PCD_RANDOM, PCD_RANDOMDIRECT, 2 },
-   { PCD_THINGCOUNT, PCD_THINGCOUNTDIRECT, 2 },
-   { PCD_TAGWAIT, PCD_TAGWAITDIRECT, 1 },
-   { PCD_POLYWAIT, PCD_POLYWAITDIRECT, 1 },
-   { PCD_CHANGEFLOOR, PCD_CHANGEFLOORDIRECT, 2 },
-   { PCD_CHANGECEILING, PCD_CHANGECEILINGDIRECT, 2 },
-   { PCD_SCRIPTWAIT, PCD_SCRIPTWAITDIRECT, 1 },
-   { PCD_CONSOLECOMMAND, PCD_CONSOLECOMMANDDIRECT, 3 },
-   { PCD_SETGRAVITY, PCD_SETGRAVITYDIRECT, 1 },
-   { PCD_SETAIRCONTROL, PCD_SETAIRCONTROLDIRECT, 1 },
-   { PCD_GIVEINVENTORY, PCD_GIVEINVENTORYDIRECT, 2 },
-   { PCD_TAKEINVENTORY, PCD_TAKEINVENTORYDIRECT, 2 },
-   { PCD_CHECKINVENTORY, PCD_CHECKINVENTORYDIRECT, 1 },
-   { PCD_SPAWN, PCD_SPAWNDIRECT, 6 },
-   { PCD_SPAWNSPOT, PCD_SPAWNSPOTDIRECT, 4 },
-   { PCD_SETMUSIC, PCD_SETMUSICDIRECT, 3 },
-   { PCD_LOCALSETMUSIC, PCD_LOCALSETMUSICDIRECT, 3 },
-   { PCD_SETFONT, PCD_SETFONTDIRECT, 1 }
+// Indexed by instruction code. Instructions without a direct form are left
+// zeroed.
+static const struct direct_pcode g_direct_pcode_table[ PCD_TOTAL ] = {
+   [ PCD_LSPEC1 ] = { PCD_LSPEC1, PCD_LSPEC1DIRECT, PCD_LSPEC1DIRECTB, 1 },
+   [ PCD_LSPEC2 ] = { PCD_LSPEC2, PCD_LSPEC2DIRECT, PCD_LSPEC2DIRECTB, 2 },
+   [ PCD_LSPEC3 ] = { PCD_LSPEC3, PCD_LSPEC3DIRECT, PCD_LSPEC3DIRECTB, 3 },
+   [ PCD_LSPEC4 ] = { PCD_LSPEC4, PCD_LSPEC4DIRECT, PCD_LSPEC4DIRECTB, 4 },
+   [ PCD_LSPEC5 ] = { PCD_LSPEC5, PCD_LSPEC5DIRECT, PCD_LSPEC5DIRECTB, 5 },
+   [ PCD_DELAY ] = { PCD_DELAY, PCD_DELAYDIRECT, PCD_DELAYDIRECTB, 1 },
+   [ PCD_RANDOM ] = { PCD_RANDOM, PCD_RANDOMDIRECT, PCD_RANDOMDIRECTB, 2 },
+   [ PCD_THINGCOUNT ] = { PCD_THINGCOUNT, PCD_THINGCOUNTDIRECT, PCD_NONE, 2 },
+   [ PCD_TAGWAIT ] = { PCD_TAGWAIT, PCD_TAGWAITDIRECT, PCD_NONE, 1 },
+   [ PCD_POLYWAIT ] = { PCD_POLYWAIT, PCD_POLYWAITDIRECT, PCD_NONE, 1 },
+   [ PCD_CHANGEFLOOR ] = { PCD_CHANGEFLOOR, PCD_CHANGEFLOORDIRECT,
+      PCD_NONE, 2 },
+   [ PCD_CHANGECEILING ] = { PCD_CHANGECEILING, PCD_CHANGECEILINGDIRECT,
+      PCD_NONE, 2 },
+   [ PCD_SCRIPTWAIT ] = { PCD_SCRIPTWAIT, PCD_SCRIPTWAITDIRECT, PCD_NONE, 1 },
+   [ PCD_CONSOLECOMMAND ] = { PCD_CONSOLECOMMAND, PCD_CONSOLECOMMANDDIRECT,
+      PCD_NONE, 3 },
+   [ PCD_SETGRAVITY ] = { PCD_SETGRAVITY, PCD_SETGRAVITYDIRECT, PCD_NONE, 1 },
+   [ PCD_SETAIRCONTROL ] = { PCD_SETAIRCONTROL, PCD_SETAIRCONTROLDIRECT,
+      PCD_NONE, 1 },
+   [ PCD_GIVEINVENTORY ] = { PCD_GIVEINVENTORY, PCD_GIVEINVENTORYDIRECT,
+      PCD_NONE, 2 },
+   [ PCD_TAKEINVENTORY ] = { PCD_TAKEINVENTORY, PCD_TAKEINVENTORYDIRECT,
+      PCD_NONE, 2 },
+   [ PCD_CHECKINVENTORY ] = { PCD_CHECKINVENTORY, PCD_CHECKINVENTORYDIRECT,
+      PCD_NONE, 1 },
+   [ PCD_SPAWN ] = { PCD_SPAWN, PCD_SPAWNDIRECT, PCD_NONE, 6 },
+   [ PCD_SPAWNSPOT ] = { PCD_SPAWNSPOT, PCD_SPAWNSPOTDIRECT, PCD_NONE, 4 },
+   [ PCD_SETMUSIC ] = { PCD_SETMUSIC, PCD_SETMUSICDIRECT, PCD_NONE, 3 },
+   [ PCD_LOCALSETMUSIC ] = { PCD_LOCALSETMUSIC, PCD_LOCALSETMUSICDIRECT,
+      PCD_NONE, 3 },
+   [ PCD_SETFONT ] = { PCD_SETFONT, PCD_SETFONTDIRECT, PCD_NONE, 1 }
 };
 
 const struct direct_pcode* c_get_direct_pcode( int code ) {
-   for ( int i = 0; i < ARRAY_SIZE( g_direct_pcode_table ); ++i ) {
-      if ( g_direct_pcode_table[ i ].code == code ) {
-         return &g_direct_pcode_table[ i ];
-      }
+   if ( code > PCD_NONE && code < PCD_TOTAL &&
+      g_direct_pcode_table[ code ].code == code ) {
+      return &g_direct_pcode_table[ code ];
    }
    return NULL;
 }
@@ -405,6 +405,9 @@ struct pcode {
 struct direct_pcode {
    int code;
    int direct_code;
+   // Used instead of the direct form when every argument fits in a byte and
+   // the object file is compressed. PCD_NONE when there is no such form.
+   int direct_byte_code;
    int argc;
 };
 
@@ -16,6 +16,7 @@ static void setup_diminfo( struct codegen* codegen );
 static int append_dim( struct codegen* codegen, struct dim* dim );
 static bool same_dim( struct dim* dim, zbcx_ListIter i );
 static void setup_data( struct codegen* codegen );
+static void order_shary_vars( struct codegen* codegen );
 static void patch_initz( struct codegen* codegen );
 static void patch_initz_list( struct codegen* codegen, zbcx_List* vars );
 static void patch_value( struct codegen* codegen, struct value* value );
@@ -23,6 +24,8 @@ static void sort_vars( struct codegen* codegen );
 static bool is_initz_zero( struct value* value );
 static void assign_indexes( struct codegen* codegen );
 static void create_assert_strings( struct codegen* codegen );
+static void order_strings( struct codegen* codegen );
+static int compare_string_usage( const void* a, const void* b );
 
 void c_init( struct codegen* codegen, struct task* task ) {
    codegen->task = task;
@@ -61,8 +64,15 @@ void c_init( struct codegen* codegen, struct task* task ) {
    codegen->shary.diminfo_size = 0;
    codegen->shary.diminfo_offset = 0;
    codegen->shary.data_offset = 0;
+   codegen->shary.unordered_initz_size = 0;
    codegen->shary.dim_counter_var = false;
    codegen->shary.used = false;
+   for ( int i = 0; i < BODY_TABLE_SIZE; ++i ) {
+      codegen->bodies.table[ i ] = NULL;
+   }
+   codegen->bodies.digest = NULL;
+   codegen->bodies.digest_size = 0;
+   codegen->bodies.digest_capacity = 0;
    codegen->null_handler = NULL;
    codegen->object_size = 0;
    codegen->dummy_script_offset = 0;
@@ -71,6 +81,9 @@ void c_init( struct codegen* codegen, struct task* task ) {
 void c_publish( struct codegen* codegen ) {
    // Reserve index 0 for the empty string.
    c_append_string( codegen, codegen->task->empty_string );
+   if ( codegen->task->options->opt_level >= 1 ) {
+      order_strings( codegen );
+   }
    clarify_vars( codegen );
    clarify_funcs( codegen );
    assign_func_indexes( codegen );
@@ -358,6 +371,9 @@ static bool same_dim( struct dim* dim, zbcx_ListIter i ) {
 }
 
 static void setup_data( struct codegen* codegen ) {
+   if ( codegen->task->options->opt_level >= 1 ) {
+      order_shary_vars( codegen );
+   }
    codegen->shary.data_offset = codegen->shary.size;
    zbcx_ListIter i;
    zbcx_list_iterate( &codegen->shary.vars, &i );
@@ -370,6 +386,47 @@ static void setup_data( struct codegen* codegen ) {
    }
 }
 
+// The AINI chunk of the shared array initializes the elements up to the last
+// non-zero element, so every zero element before it is written too. Place the
+// variables with initializers first, and among those, place last the variable
+// with the most zero elements at its end. The zero elements of the other
+// variables then come after the last non-zero element and are not written.
+static void order_shary_vars( struct codegen* codegen ) {
+   zbcx_List initz_vars;
+   zbcx_List zero_vars;
+   zbcx_list_init( &initz_vars );
+   zbcx_list_init( &zero_vars );
+   struct var* last_var = NULL;
+   int last_var_zeros = 0;
+   int offset = 0;
+   while ( zbcx_list_size( &codegen->shary.vars ) > 0 ) {
+      struct var* var = zbcx_list_shift( &codegen->shary.vars );
+      int count = c_count_nonzero_value( codegen, var );
+      if ( count != 0 ) {
+         codegen->shary.unordered_initz_size = offset + count;
+      }
+      offset += var->size;
+      if ( count == 0 ) {
+         zbcx_list_append( &zero_vars, var );
+      }
+      else if ( ! last_var || var->size - count > last_var_zeros ) {
+         if ( last_var ) {
+            zbcx_list_append( &initz_vars, last_var );
+         }
+         last_var = var;
+         last_var_zeros = var->size - count;
+      }
+      else {
+         zbcx_list_append( &initz_vars, var );
+      }
+   }
+   if ( last_var ) {
+      zbcx_list_append( &initz_vars, last_var );
+   }
+   zbcx_list_merge( &codegen->shary.vars, &initz_vars );
+   zbcx_list_merge( &codegen->shary.vars, &zero_vars );
+}
+
 static void patch_initz( struct codegen* codegen ) {
    patch_initz_list( codegen, &codegen->vars );
    patch_initz_list( codegen, &codegen->shary.vars );
@@ -647,8 +704,56 @@ static void create_assert_strings( struct codegen* codegen ) {
    codegen->assert_prefix->used = true;
 }
 
+// Gives the most frequently referenced strings the lowest runtime indexes, so
+// the instructions that push them can use a single-byte argument.
+static void order_strings( struct codegen* codegen ) {
+   int count = 0;
+   struct indexed_string* string = codegen->task->str_table.head;
+   while ( string ) {
+      if ( string->usage > 0 ) {
+         ++count;
+      }
+      string = string->next;
+   }
+   if ( count == 0 ) {
+      return;
+   }
+   struct indexed_string** strings = mem_alloc( sizeof( *strings ) * count );
+   count = 0;
+   string = codegen->task->str_table.head;
+   while ( string ) {
+      if ( string->usage > 0 ) {
+         strings[ count ] = string;
+         ++count;
+      }
+      string = string->next;
+   }
+   qsort( strings, count, sizeof( *strings ), compare_string_usage );
+   for ( int i = 0; i < count && codegen->runtime_index <= UCHAR_MAX; ++i ) {
+      c_append_string( codegen, strings[ i ] );
+      // The references are counted again as the code is written. A string
+      // that the code never references, because it was folded away, is left
+      // out of the string table.
+      strings[ i ]->usage = 0;
+   }
+   mem_free( strings );
+}
+
+static int compare_string_usage( const void* a, const void* b ) {
+   const struct indexed_string* string_a =
+      *( const struct indexed_string* const* ) a;
+   const struct indexed_string* string_b =
+      *( const struct indexed_string* const* ) b;
+   if ( string_a->usage != string_b->usage ) {
+      return string_b->usage - string_a->usage;
+   }
+   // Keep the order of appearance for strings used equally often.
+   return string_a->index - string_b->index;
+}
+
 void c_append_string( struct codegen* codegen,
    struct indexed_string* string ) {
+   ++string->usage;
    // Allocate the index that the game engine will use for finding the string.
    if ( ! ( string->index_runtime >= 0 ) ) {
       string->index_runtime = codegen->runtime_index;
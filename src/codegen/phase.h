@@ -12,6 +12,9 @@ enum { ARRAYREF_SIZE = PRIMITIVE_SIZE + PRIMITIVE_SIZE };
 struct buffer {
    struct buffer* next;
    char data[ BUFFER_SIZE ];
+   // Position of the first byte of the buffer in the object. A buffer is
+   // filled up before the next buffer is started, so this does not change.
+   int start;
    int used;
    int pos;
 };
@@ -27,11 +30,26 @@ struct local_record {
    int func_size;
 };
 
+// Body of a function or script that has been written to the object. The
+// digest describes the instructions of the body independently of where the
+// body is located in the object.
+struct body_record {
+   struct body_record* next;
+   int* digest;
+   int digest_size;
+   unsigned int hash;
+   int obj_pos;
+   int size;
+};
+
+enum { BODY_TABLE_SIZE = 256 };
+
 struct func_record {
    struct func* func;
    int start_index;
    int array_index;
    int size;
+   struct c_point* entry_point;
    bool nested_func;
 };
 
@@ -103,9 +121,18 @@ struct codegen {
       int diminfo_size;
       int diminfo_offset;
       int data_offset;
+      // Number of data elements the AINI chunk would initialize with the
+      // variables in declaration order.
+      int unordered_initz_size;
       bool dim_counter_var;
       bool used;
    } shary;
+   struct {
+      struct body_record* table[ BODY_TABLE_SIZE ];
+      int* digest;
+      int digest_size;
+      int digest_capacity;
+   } bodies;
    struct func* null_handler;
    int object_size;
    int dummy_script_offset;
@@ -142,6 +169,7 @@ void c_add_block_visit( struct codegen* codegen );
 void c_pop_block_visit( struct codegen* codegen );
 void c_write_block( struct codegen* codegen, struct block* stmt );
 void c_write_stmt( struct codegen* codegen, struct node* node );
+bool c_is_restarted( struct codegen* codegen );
 void c_visit_expr( struct codegen* codegen, struct expr* );
 void c_visit_var( struct codegen* codegen, struct var* var );
 struct pcode* c_get_pcode_info( int code );
@@ -153,6 +181,8 @@ void c_point_arg( struct codegen* codegen, struct c_point* point );
 void c_pcd( struct codegen* codegen, int code, ... );
 void c_seek_node( struct codegen* codegen, struct c_node* node );
 void c_append_node( struct codegen* codegen, struct c_node* node );
+void c_prepend_node( struct codegen* codegen, struct c_node* node );
+void c_remove_node( struct codegen* codegen, struct c_node* prev );
 struct c_point* c_create_point( struct codegen* codegen );
 struct c_jump* c_create_jump( struct codegen* codegen, int opcode );
 struct c_casejump* c_create_casejump( struct codegen* codegen, int value,
@@ -161,6 +191,11 @@ struct c_sortedcasejump* c_create_sortedcasejump( struct codegen* codegen );
 void c_append_casejump( struct c_sortedcasejump* sorted_jump,
    struct c_casejump* jump );
 void c_flush_pcode( struct codegen* codegen );
+int c_flush_body( struct codegen* codegen, int* saved );
+int c_optimize_loops( struct codegen* codegen, int size, int* hoisted,
+   int* reduced );
+int c_number_local_values( struct codegen* codegen, int size, int* reused );
+int c_pack_local_slots( struct codegen* codegen, int param_size, int size );
 void p_visit_inline_asm( struct codegen* codegen,
    struct inline_asm* inline_asm );
 void c_write_opc( struct codegen* codegen, int opcode );
@@ -177,6 +212,7 @@ void c_push_dimtrack( struct codegen* codegen );
 void c_update_dimtrack( struct codegen* codegen );
 void c_inc_dimtrack( struct codegen* codegen );
 int c_total_param_size( struct func* func );
+int c_count_nonzero_value( struct codegen* codegen, struct var* var );
 void c_init_local_var( struct codegen* codegen, struct var* var );
 void c_bail( struct codegen* codegen );
 bool c_is_array( struct var* var );
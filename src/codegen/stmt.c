@@ -1070,7 +1070,7 @@ static void visit_return( struct codegen* codegen, struct return_stmt* stmt ) {
       c_append_node( codegen, &epilogue_jump->node );
       stmt->epilogue_jump = epilogue_jump;
    }
-   else {
+   else if ( ! c_is_restarted( codegen ) ) {
       if ( stmt->return_value ) {
          c_pcd( codegen, PCD_RETURNVAL );
       }
@@ -1080,6 +1080,15 @@ static void visit_return( struct codegen* codegen, struct return_stmt* stmt ) {
    }
 }
 
+// Nothing is returned after a tail call that restarts the function.
+bool c_is_restarted( struct codegen* codegen ) {
+   if ( codegen->node && codegen->node->type == C_NODE_JUMP ) {
+      struct c_jump* jump = ( struct c_jump* ) codegen->node;
+      return ( jump->point && jump->point == codegen->func->entry_point );
+   }
+   return false;
+}
+
 static void visit_paltrans( struct codegen* codegen, struct paltrans* trans ) {
    c_push_expr( codegen, trans->number );
    c_pcd( codegen, PCD_STARTTRANSLATION );
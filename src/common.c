@@ -12,10 +12,16 @@
 // ==========================================================================
 
 // Linked list of current allocations. The head is the most recent allocation.
-// This way, a short-term allocation can be found and removed quicker.
+// The list is doubly linked, so an allocation can be removed without searching
+// for it.
 static struct alloc {
    struct alloc* next;
+   struct alloc* prev;
+   size_t size;
 }* g_alloc = NULL;
+
+// Totals of the current compilation, for the timings report.
+static struct mem_stats g_stats;
 // Allocation sizes for bulk allocation.
 static struct {
    size_t size;
@@ -24,14 +30,7 @@ static struct {
    { sizeof( struct func ), 128 },
    { sizeof( struct func_aspec ), 256 },
    { sizeof( zbcx_ListLink ), 256 },
-   { sizeof( struct expr ), 256 },
-   { sizeof( struct indexed_string_usage ), 256 },
-   { sizeof( struct binary ), 256 },
-   { sizeof( struct name_usage ), 256 },
-   { sizeof( struct literal ), 256 },
-   { sizeof( struct block ), 256 },
    { sizeof( struct name ), 256 },
-   { sizeof( struct call ), 256 },
    { sizeof( struct constant ), 256 },
    { sizeof( struct param ), 256 }
 };
@@ -49,10 +48,27 @@ static struct {
    size_t slots_used;
 } g_bulk;
 
+// Arena for the nodes of the syntax tree. The nodes live until the end of the
+// compilation and are never freed individually, so they are placed one after
+// the other, in the order they are parsed, in large chunks.
+enum {
+   ARENA_CHUNK_SIZE = 65536,
+   ARENA_ALIGNMENT = sizeof( union { void* ptr; long long num; double real; } )
+};
+static struct {
+   char* chunk;
+   size_t left;
+} g_arena;
+
 static void unlink_alloc( struct alloc* );
 
 void mem_init( void ) {
+   g_stats.allocated = 0;
+   g_stats.current = 0;
+   g_stats.peak = 0;
    g_bulk.slots_used = 0;
+   g_arena.chunk = NULL;
+   g_arena.left = 0;
    size_t i = 0;
    while ( i < ARRAY_SIZE( g_bulk_sizes ) ) {
       // Find slot with specified allocation size.
@@ -89,6 +105,7 @@ void* mem_realloc( void* block, size_t size ) {
    if ( block ) {
       alloc = ( struct alloc* ) block - 1;
       unlink_alloc( alloc );
+      g_stats.current -= alloc->size;
    }
    alloc = realloc( alloc, sizeof( *alloc ) + size );
    if ( ! alloc ) {
@@ -96,24 +113,31 @@ void* mem_realloc( void* block, size_t size ) {
       printf( "error: failed to allocate memory block of %zu bytes\n", size );
       exit( EXIT_FAILURE );
    }
+   alloc->size = size;
+   g_stats.allocated += size;
+   g_stats.current += size;
+   if ( g_stats.current > g_stats.peak ) {
+      g_stats.peak = g_stats.current;
+   }
    alloc->next = g_alloc;
+   alloc->prev = NULL;
+   if ( g_alloc ) {
+      g_alloc->prev = alloc;
+   }
    g_alloc = alloc;
    return alloc + 1;
 }
 
 static void unlink_alloc( struct alloc* alloc ) {
-   struct alloc* curr = g_alloc;
-   struct alloc* prev = NULL;
-   while ( curr != alloc ) {
-      prev = curr;
-      curr = curr->next;
-   }
-   if ( prev ) {
-      prev->next = alloc->next;
+   if ( alloc->prev ) {
+      alloc->prev->next = alloc->next;
    }
    else {
       g_alloc = alloc->next;
    }
+   if ( alloc->next ) {
+      alloc->next->prev = alloc->prev;
+   }
 }
 
 void* mem_slot_alloc( size_t size ) {
@@ -143,9 +167,27 @@ void* mem_slot_alloc( size_t size ) {
    return mem_alloc( size );
 }
 
+void* mem_arena_alloc( size_t size ) {
+   size = ( size + ARENA_ALIGNMENT - 1 ) & ~( ( size_t ) ARENA_ALIGNMENT - 1 );
+   // A large block would waste most of the chunk it starts, so allocate it
+   // separately.
+   if ( size > ARENA_CHUNK_SIZE / 16 ) {
+      return mem_alloc( size );
+   }
+   if ( g_arena.left < size ) {
+      g_arena.chunk = mem_alloc( ARENA_CHUNK_SIZE );
+      g_arena.left = ARENA_CHUNK_SIZE;
+   }
+   void* block = g_arena.chunk;
+   g_arena.chunk += size;
+   g_arena.left -= size;
+   return block;
+}
+
 void mem_free( void* block ) {
    struct alloc* alloc = ( struct alloc* ) block - 1;
    unlink_alloc( alloc );
+   g_stats.current -= alloc->size;
    free( alloc );
 }
 
@@ -169,6 +211,16 @@ void mem_free_all( void ) {
       free( g_alloc );
       g_alloc = next;
    }
+   g_stats.current = 0;
+   // The blocks of the bulk allocations were freed above. Until mem_init() is
+   // called again, allocate the slots separately.
+   g_bulk.slots_used = 0;
+   g_arena.chunk = NULL;
+   g_arena.left = 0;
+}
+
+void mem_get_stats( struct mem_stats* stats ) {
+   *stats = g_stats;
 }
 
 // Str
@@ -254,6 +306,7 @@ void str_append_format_va( struct str* str, const char* format,
       }
       vsnprintf( str->value + str->length, str->buffer_length - str->length,
          format, args_copy );
+      str->length += length;
    }
    va_end( args_copy );
 }
@@ -540,10 +593,21 @@ bool c_is_absolute_path( const char* path ) {
       path[ 0 ] == '/' );
 }
 
+u64 c_get_time_ns( void ) {
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER counter;
+   QueryPerformanceFrequency( &frequency );
+   QueryPerformanceCounter( &counter );
+   return ( u64 ) ( counter.QuadPart / frequency.QuadPart ) * 1000000000ull +
+      ( u64 ) ( counter.QuadPart % frequency.QuadPart ) * 1000000000ull /
+      ( u64 ) frequency.QuadPart;
+}
+
 #else
 
 #include <unistd.h>
 #include <dirent.h>
+#include <time.h>
 #include <sys/stat.h>
 
 #ifdef __APPLE__
@@ -623,6 +687,12 @@ bool c_is_absolute_path( const char* path ) {
    return ( path[ 0 ] == '/' );
 }
 
+u64 c_get_time_ns( void ) {
+   struct timespec time;
+   clock_gettime( CLOCK_MONOTONIC, &time );
+   return ( u64 ) time.tv_sec * 1000000000ull + ( u64 ) time.tv_nsec;
+}
+
 #endif
 
 void c_extract_dirname( struct str* path ) {
@@ -662,6 +732,7 @@ void fs_get_file_contents( const char* path, struct file_contents* contents ) {
    contents->data = mem_alloc( size );
    fread( contents->data, size, 1, fh );
    fclose( fh );
+   contents->size = size;
    contents->obtained = true;
    contents->err = 0;
 }
@@ -18,9 +18,19 @@ void mem_init( void );
 void* mem_alloc( size_t );
 void* mem_realloc( void*, size_t );
 void* mem_slot_alloc( size_t );
+void* mem_arena_alloc( size_t );
 void mem_free( void* );
 void mem_free_all( void );
 
+struct mem_stats {
+   // Total size of all allocations, including freed ones.
+   size_t allocated;
+   size_t current;
+   size_t peak;
+};
+
+void mem_get_stats( struct mem_stats* stats );
+
 #define ARRAY_SIZE( a ) ( sizeof( a ) / sizeof( a[ 0 ] ) )
 #define STATIC_ASSERT( ... ) \
   STATIC_ASSERT_IMPL( __VA_ARGS__,, )
@@ -107,6 +117,7 @@ struct fs_timestamp {
 
 struct file_contents {
    char* data;
+   size_t size;
    int err;
    bool obtained;
 };
@@ -130,5 +141,7 @@ void fs_get_file_contents( const char* path, struct file_contents* contents );
 void fs_strip_trailing_pathsep( struct str* path );
 bool fs_delete_file( const char* path );
 bool c_is_absolute_path( const char* path );
+// Monotonic time, for measuring durations.
+u64 c_get_time_ns( void );
 
 #endif
@@ -0,0 +1,88 @@
+#include <limits.h>
+
+#include "task.h"
+
+// Constant folding
+// ==========================================================================
+// Both the semantic phase and the code generator fold constant operations
+// using the functions below. Integers wrap around on overflow and shift
+// counts are taken modulo 32, like on the game engine. An operation whose
+// result is not well-defined at runtime, such as a division by zero, is not
+// folded; the instruction is left to be evaluated by the game engine.
+
+static int wrap( unsigned int value );
+static bool fold_fixed_div( int l, int r, int* result );
+static long long abs_ll( int value );
+
+bool t_fold_binary( int op, int l, int r, int* result ) {
+   unsigned int ul = ( unsigned int ) l;
+   unsigned int ur = ( unsigned int ) r;
+   switch ( op ) {
+   case FOLD_ADD: *result = wrap( ul + ur ); break;
+   case FOLD_SUB: *result = wrap( ul - ur ); break;
+   case FOLD_MUL: *result = wrap( ul * ur ); break;
+   case FOLD_DIV:
+   case FOLD_MOD:
+      if ( r == 0 || ( l == INT_MIN && r == -1 ) ) {
+         return false;
+      }
+      *result = ( op == FOLD_DIV ) ? l / r : l % r;
+      break;
+   case FOLD_SHIFT_L: *result = wrap( ul << ( ur & 31 ) ); break;
+   case FOLD_SHIFT_R:
+      // Arithmetic shift, even if the implementation-defined right shift of
+      // a negative number is not.
+      *result = ( l >= 0 ) ? l >> ( ur & 31 ) : ~ ( ~ l >> ( ur & 31 ) );
+      break;
+   case FOLD_BIT_AND: *result = l & r; break;
+   case FOLD_BIT_XOR: *result = l ^ r; break;
+   case FOLD_BIT_OR: *result = l | r; break;
+   case FOLD_EQ: *result = ( l == r ); break;
+   case FOLD_NEQ: *result = ( l != r ); break;
+   case FOLD_LT: *result = ( l < r ); break;
+   case FOLD_LTE: *result = ( l <= r ); break;
+   case FOLD_GT: *result = ( l > r ); break;
+   case FOLD_GTE: *result = ( l >= r ); break;
+   case FOLD_LOG_AND: *result = ( l && r ); break;
+   case FOLD_LOG_OR: *result = ( l || r ); break;
+   case FOLD_FIXED_MUL:
+      *result = wrap( ( unsigned int ) ( ( ( long long ) l * r ) >> 16 ) );
+      break;
+   case FOLD_FIXED_DIV:
+      return fold_fixed_div( l, r, result );
+   default:
+      return false;
+   }
+   return true;
+}
+
+static int wrap( unsigned int value ) {
+   return ( value > INT_MAX ) ?
+      ( int ) ( value - INT_MAX - 1 ) + INT_MIN : ( int ) value;
+}
+
+// Older versions of the game engine saturate the quotient of a fixed-point
+// division when it does not fit, newer versions do not. Only a quotient that
+// every version computes the same way is folded.
+static bool fold_fixed_div( int l, int r, int* result ) {
+   if ( r == 0 || ( abs_ll( l ) >> 14 ) >= abs_ll( r ) ) {
+      return false;
+   }
+   *result = ( int ) ( ( ( long long ) l * 65536 ) / r );
+   return true;
+}
+
+static long long abs_ll( int value ) {
+   return ( value < 0 ) ? - ( long long ) value : value;
+}
+
+bool t_fold_unary( int op, int operand, int* result ) {
+   switch ( op ) {
+   case FOLD_MINUS: *result = wrap( 0u - ( unsigned int ) operand ); break;
+   case FOLD_LOG_NOT: *result = ( ! operand ); break;
+   case FOLD_BIT_NOT: *result = ( ~ operand ); break;
+   default:
+      return false;
+   }
+   return true;
+}
@@ -114,6 +114,8 @@ static void init_options( struct options* options ) {
    options->tab_size = 4;
    options->acc_err = false;
    options->acc_stats = false;
+   options->timings = zbcx_timings_none;
+   options->low_memory = false;
    options->help = false;
    options->preprocess = false;
    options->write_asserts = true;
@@ -200,6 +202,15 @@ static bool read_options( struct options* options, char** argv ) {
       else if ( strcmp( option, "acc-stats" ) == 0 ) {
          options->acc_stats = true;
       }
+      else if ( strcmp( option, "timings" ) == 0 ) {
+         options->timings = zbcx_timings_text;
+      }
+      else if ( strcmp( option, "timings-json" ) == 0 ) {
+         options->timings = zbcx_timings_json;
+      }
+      else if ( strcmp( option, "low-memory" ) == 0 ) {
+         options->low_memory = true;
+      }
       else if ( strcmp( option, "cache" ) == 0 ) {
          options->cache.enable = true;
       }
@@ -306,6 +317,12 @@ static void print_usage( char* path ) {
       "                       created by the acc compiler\n"
       "  -acc-stats           Show compilation statistics like those shown\n"
       "                       by the acc compiler\n"
+      "  -timings             Show the time spent in each phase of the\n"
+      "                       compilation, along with memory use and\n"
+      "                       cache hits\n"
+      "  -timings-json        Same as -timings, but as a JSON object\n"
+      "  -low-memory          Free the memory used for reading the source\n"
+      "                       files once parsing is done\n"
       "  -h                   Show this help information\n"
       "  -i <directory>       Add a directory to search in for files\n"
       "  -I <directory>       Same as -i\n"
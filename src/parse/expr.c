@@ -308,7 +308,7 @@ static void read_op( struct parse* parse, struct expr_reading* reading ) {
    // Conditional
    // -----------------------------------------------------------------------
    if ( parse->tk == TK_QUESTION_MARK ) {
-      struct conditional* cond = mem_alloc( sizeof( *cond ) );
+      struct conditional* cond = mem_arena_alloc( sizeof( *cond ) );
       cond->node.type = NODE_CONDITIONAL;
       cond->pos = parse->tk_pos;
       cond->left = reading->node;
@@ -354,7 +354,7 @@ static void read_op( struct parse* parse, struct expr_reading* reading ) {
    case TK_ASSIGN_BIT_OR: op = AOP_BIT_OR; break;
    default: return;
    }
-   assign = mem_alloc( sizeof( *assign ) );
+   assign = mem_arena_alloc( sizeof( *assign ) );
    assign->node.type = NODE_ASSIGN;
    assign->op = op;
    assign->lside = reading->node;
@@ -369,7 +369,7 @@ static void read_op( struct parse* parse, struct expr_reading* reading ) {
 }
 
 static struct binary* alloc_binary( int op, struct pos* pos ) {
-   struct binary* binary = mem_slot_alloc( sizeof( *binary ) );
+   struct binary* binary = mem_arena_alloc( sizeof( *binary ) );
    binary->node.type = NODE_BINARY;
    binary->op = op;
    binary->lside = NULL;
@@ -382,7 +382,7 @@ static struct binary* alloc_binary( int op, struct pos* pos ) {
 }
 
 static struct logical* alloc_logical( int op, struct pos* pos ) {
-   struct logical* logical = mem_alloc( sizeof( *logical ) );
+   struct logical* logical = mem_arena_alloc( sizeof( *logical ) );
    logical->node.type = NODE_LOGICAL;
    logical->op = op;
    logical->lside = NULL;
@@ -427,7 +427,7 @@ static void read_unary( struct parse* parse, struct expr_reading* reading ) {
    default:
       break;
    }
-   struct unary* unary = mem_alloc( sizeof( *unary ) );
+   struct unary* unary = mem_arena_alloc( sizeof( *unary ) );
    unary->node.type = NODE_UNARY;
    unary->op = op;
    unary->operand = NULL;
@@ -448,7 +448,7 @@ static void read_inc( struct parse* parse, struct expr_reading* reading ) {
 }
 
 static struct inc* alloc_inc( struct pos pos, bool dec ) {
-   struct inc* inc = mem_alloc( sizeof( *inc ) );
+   struct inc* inc = mem_arena_alloc( sizeof( *inc ) );
    inc->node.type = NODE_INC;
    inc->operand = NULL;
    inc->pos = pos;
@@ -518,7 +518,7 @@ static void read_primary( struct parse* parse, struct expr_reading* reading ) {
 }
 
 static void read_id( struct parse* parse, struct expr_reading* reading ) {
-   struct name_usage* usage = mem_slot_alloc( sizeof( *usage ) );
+   struct name_usage* usage = mem_arena_alloc( sizeof( *usage ) );
    usage->node.type = NODE_NAME_USAGE;
    usage->text = parse->tk_text;
    usage->pos = parse->tk_pos;
@@ -528,7 +528,7 @@ static void read_id( struct parse* parse, struct expr_reading* reading ) {
 }
 
 static void read_literal( struct parse* parse, struct expr_reading* reading ) {
-   struct literal* literal = mem_slot_alloc( sizeof( *literal ) );
+   struct literal* literal = mem_arena_alloc( sizeof( *literal ) );
    literal->node.type = NODE_LITERAL;
    literal->value = p_extract_literal_value( parse );
    reading->node = &literal->node;
@@ -546,7 +546,7 @@ static void read_string( struct parse* parse, struct expr_reading* reading ) {
    struct indexed_string* string = t_intern_string( parse->task,
       parse->tk_text, parse->tk_length );
    string->in_source_code = true;
-   struct indexed_string_usage* usage = mem_slot_alloc( sizeof( *usage ) );
+   struct indexed_string_usage* usage = mem_arena_alloc( sizeof( *usage ) );
    usage->node.type = NODE_INDEXED_STRING_USAGE;
    usage->string = string;
    reading->node = &usage->node;
@@ -715,7 +715,7 @@ static int extract_radix_literal( struct parse* parse ) {
 
 static void read_fixed_literal( struct parse* parse,
    struct expr_reading* reading ) {
-   struct fixed_literal* literal = mem_slot_alloc( sizeof( *literal ) );
+   struct fixed_literal* literal = mem_arena_alloc( sizeof( *literal ) );
    literal->node.type = NODE_FIXED_LITERAL;
    literal->value = p_extract_fixed_literal_value( parse->tk_text );
    reading->node = &literal->node;
@@ -756,7 +756,7 @@ static void read_conversion( struct parse* parse,
    struct expr_reading expr;
    p_init_expr_reading( &expr, false, false, false, true );
    p_read_expr( parse, &expr );
-   struct conversion* conv = mem_alloc( sizeof( *conv ) );
+   struct conversion* conv = mem_arena_alloc( sizeof( *conv ) );
    conv->node.type = NODE_CONVERSION;
    conv->expr = expr.output_node;
    conv->spec = spec;
@@ -803,7 +803,7 @@ static void read_suffix( struct parse* parse, struct expr_reading* reading ) {
 
 static void read_subscript( struct parse* parse,
    struct expr_reading* reading ) {
-   struct subscript* subscript = mem_alloc( sizeof( *subscript ) );
+   struct subscript* subscript = mem_arena_alloc( sizeof( *subscript ) );
    subscript->node.type = NODE_SUBSCRIPT;
    subscript->pos = parse->tk_pos;
    p_read_tk( parse );
@@ -829,7 +829,7 @@ static void read_access( struct parse* parse, struct expr_reading* reading ) {
 }
 
 static struct access* alloc_access( const char* name, struct pos pos ) {
-   struct access* access = mem_alloc( sizeof( *access ) );
+   struct access* access = mem_arena_alloc( sizeof( *access ) );
    access->node.type = NODE_ACCESS;
    access->name = name;
    access->pos = pos;
@@ -930,7 +930,7 @@ static struct format_item* read_format_item( struct parse* parse ) {
       read_array_field( parse, &field );
       item->value = field.array;
       if ( field.offset ) {
-         struct format_item_array* extra = mem_alloc( sizeof( *extra ) );
+         struct format_item_array* extra = mem_arena_alloc( sizeof( *extra ) );
          extra->offset = field.offset;
          extra->length = field.length;
          item->extra = extra;
@@ -1025,7 +1025,7 @@ static void read_array_field( struct parse* parse,
 
 static void read_sure( struct parse* parse, struct expr_reading* reading ) {
    p_test_tk( parse, TK_LOG_NOT );
-   struct sure* sure = mem_alloc( sizeof( *sure ) );
+   struct sure* sure = mem_arena_alloc( sizeof( *sure ) );
    sure->node.type = NODE_SURE;
    sure->pos = parse->tk_pos;
    sure->operand = reading->node;
@@ -1042,7 +1042,7 @@ static void read_strcpy( struct parse* parse, struct expr_reading* reading ) {
    p_read_tk( parse );
    struct strcpy_reading call_r;
    read_strcpy_call( parse, &call_r );
-   struct strcpy_call* call = mem_alloc( sizeof( *call ) );
+   struct strcpy_call* call = mem_arena_alloc( sizeof( *call ) );
    call->node.type = NODE_STRCPY;
    call->array = call_r.array;
    call->array_offset = call_r.array_offset;
@@ -1111,7 +1111,7 @@ static void read_memcpy( struct parse* parse, struct expr_reading* reading ) {
    p_read_tk( parse );
    struct strcpy_reading call_r;
    read_strcpy_call( parse, &call_r );
-   struct memcpy_call* call = mem_alloc( sizeof( *call ) );
+   struct memcpy_call* call = mem_arena_alloc( sizeof( *call ) );
    call->node.type = NODE_MEMCPY;
    call->destination = call_r.array;
    call->destination_offset = call_r.array_offset;
@@ -1151,7 +1151,7 @@ static void read_func_literal( struct parse* parse,
 static void read_compound_literal( struct parse* parse,
    struct expr_reading* reading,
    struct paren_reading* paren ) {
-   struct compound_literal* literal = mem_alloc( sizeof( *literal ) );
+   struct compound_literal* literal = mem_arena_alloc( sizeof( *literal ) );
    literal->node.type = NODE_COMPOUNDLITERAL;
    literal->var = paren->var;
    reading->node = &literal->node;
@@ -1160,7 +1160,7 @@ static void read_compound_literal( struct parse* parse,
 static void read_cast( struct parse* parse, struct expr_reading* reading,
    struct paren_reading* paren ) {
    read_prefix( parse, reading );
-   struct cast* cast = mem_alloc( sizeof( *cast ) );
+   struct cast* cast = mem_arena_alloc( sizeof( *cast ) );
    cast->node.type = NODE_CAST;
    cast->operand = reading->node;
    cast->pos = paren->cast.pos;
@@ -1170,7 +1170,7 @@ static void read_cast( struct parse* parse, struct expr_reading* reading,
 
 static void read_paren_expr( struct parse* parse,
    struct expr_reading* reading ) {
-   struct paren* paren = mem_alloc( sizeof( *paren ) );
+   struct paren* paren = mem_arena_alloc( sizeof( *paren ) );
    paren->node.type = NODE_PAREN;
    paren->inside = NULL;
    p_test_tk( parse, TK_PAREN_L );
@@ -900,8 +900,12 @@ static void load_imported_lib_from_storage( struct parse* parse,
    // Try loading the library from the cache.
    bool cached = false;
    if ( parse->cache ) {
+      int phase = t_enter_timing( parse->task, TIMING_CACHE );
       lib = cache_get( parse->cache, request->file );
+      t_leave_timing( parse->task, phase );
       cached = ( lib != NULL );
+      t_count( parse->task, cached ?
+         COUNT_LIBRARY_HITS : COUNT_LIBRARY_MISSES );
    }
    if ( ! cached ) {
       lib = t_add_library( parse->task );
@@ -911,9 +915,13 @@ static void load_imported_lib_from_storage( struct parse* parse,
    zbcx_list_append( &parse->task->libraries, lib );
    // Read library from source file.
    if ( ! cached ) {
+      int phase = t_enter_timing( parse->task, TIMING_IMPORT );
       read_imported_lib( parse, request, lib );
+      t_leave_timing( parse->task, phase );
       if ( parse->cache ) {
+         phase = t_enter_timing( parse->task, TIMING_CACHE );
          cache_add( parse->cache, lib );
+         t_leave_timing( parse->task, phase );
       }
    }
    request->lib = lib;
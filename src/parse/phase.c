@@ -18,7 +18,9 @@ void p_init( struct parse* parse, struct task* task, struct cache* cache ) {
    str_init( &parse->token_presentation );
    parse->read_flags = READF_CONCATSTRINGS | READF_ESCAPESEQ;
    parse->concat_strings = false;
-   parse->macro_head = NULL;
+   for ( int i = 0; i < MACROTABLE_SIZE; ++i ) {
+      parse->macro_table[ i ] = NULL;
+   }
    parse->macro_free = NULL;
    parse->macro_param_free = NULL;
    parse->macro_expan = NULL;
@@ -49,6 +51,8 @@ void p_init( struct parse* parse, struct task* task, struct cache* cache ) {
    t_init_pos_id( &parse->wadauthor.pos, INTERNALFILE_COMPILER );
    parse->wadauthor.specified = false;
    parse->wadauthor.enabled = false;
+   parse->pch_record = NULL;
+   parse->pch_replay = NULL;
 }
 
 void p_run( struct parse* parse ) {
@@ -64,6 +68,9 @@ void p_run( struct parse* parse ) {
    if ( ! success ) {
       t_bail( parse->task );
    }
+   if ( parse->task->options->low_memory ) {
+      p_release_tk( parse );
+   }
 }
 
 static void run_phase( struct parse* parse ) {
@@ -91,6 +98,7 @@ static void run_phase( struct parse* parse ) {
 void p_diag( struct parse* parse, int flags, ... ) {
    va_list args;
    va_start( args, flags );
+   ++parse->task->diag_count;
    parse->task->options->diag(parse->task->options->context, flags, &args);
    va_end( args );
 }
@@ -4,6 +4,7 @@
 #include "../task.h"
 
 struct cache;
+struct pch;
 
 // Token types.
 enum tk {
@@ -225,6 +226,7 @@ struct token_info {
 struct macro {
    const char* name;
    struct macro* next;
+   unsigned int hash;
    struct macro_param* param_head;
    struct macro_param* param_tail;
    struct token* body;
@@ -249,6 +251,13 @@ struct macro_param {
    struct macro_param* next;
 };
 
+enum { TOKEN_CHUNK_SIZE = 256 };
+
+struct token_chunk {
+   struct token_chunk* next;
+   struct token tokens[ TOKEN_CHUNK_SIZE ];
+};
+
 struct queue_entry {
    struct queue_entry* next;
    struct token* token;
@@ -274,6 +283,7 @@ struct streamtk_iter {
 };
 
 enum { SOURCE_BUFFER_SIZE = 16384 };
+enum { MACROTABLE_SIZE = 512 };
 
 struct source {
    struct file_entry* file;
@@ -289,11 +299,24 @@ struct source {
    int buffer_pos;
 };
 
+// Progress of include-guard detection for a source file. A file is guarded
+// when an #ifndef directive and its matching #endif enclose everything else in
+// the file.
+enum include_guard {
+   INCLUDEGUARD_START,
+   INCLUDEGUARD_OPEN,
+   INCLUDEGUARD_CLOSED,
+   INCLUDEGUARD_NONE
+};
+
 struct source_entry {
    struct source_entry* prev;
    struct source* source;
    struct macro_expan* macro_expan;
    struct token_queue peeked;
+   struct ifdirc* guard_ifdirc;
+   const char* guard_macro;
+   enum include_guard guard;
    enum tk prev_tk;
    bool main;
    bool imported;
@@ -384,10 +407,36 @@ struct paren_reading {
    } cast;
 };
 
+// The tokens of the precompiled header are recorded while the header is read
+// for the first time.
+struct pch_record {
+   struct pch* pch;
+   struct file_entry* file;
+   // ID of the include-history entry created for the header. Entries created
+   // while reading the header are stored relative to this one.
+   int first_include;
+   int included_lines;
+   // Include-history entry of the file that #includes the header.
+   struct include_history_entry* parent_include;
+   // Macros defined before the header.
+   zbcx_List initial_macros;
+   bool uncacheable;
+};
+
+// When the precompiled header is available, its tokens are given to the
+// parser in place of reading the header.
+struct pch_replay {
+   struct pch* pch;
+   struct token token;
+   int next_token;
+   int first_include;
+};
+
 struct parse {
    struct task* task;
    struct token* token;
    struct token* token_free;
+   struct token_chunk* token_chunks;
    struct token token_source;
    struct token token_peeked;
    struct token token_expan;
@@ -410,7 +459,9 @@ struct parse {
       READF_SPACETAB = 0x8,
    } read_flags;
    bool concat_strings;
-   struct macro* macro_head;
+   // Macros are kept in a hash table, so looking up an identifier does not
+   // depend on the number of defined macros.
+   struct macro* macro_table[ MACROTABLE_SIZE ];
    struct macro* macro_free;
    struct macro_param* macro_param_free;
    struct macro_expan* macro_expan;
@@ -453,6 +504,8 @@ struct parse {
       bool specified;
       bool enabled;
    } wadauthor;
+   struct pch_record* pch_record;
+   struct pch_replay* pch_replay;
 };
 
 void p_init( struct parse* parse, struct task* task, struct cache* cache );
@@ -498,6 +551,7 @@ void p_present_token( struct str* str, enum tk tk );
 const char* p_present_token_temp( struct parse* parse, enum tk tk );
 int p_extract_literal_value( struct parse* parse );
 int p_extract_fixed_literal_value( const char* text );
+void p_append_lib_file( struct library* lib, struct file_entry* file );
 void p_load_included_source( struct parse* parse, const char* file_path,
    struct pos* pos );
 void p_read_script( struct parse* parse );
@@ -514,7 +568,11 @@ void p_unexpect_last_name( struct parse* parse, struct pos* pos,
    const char* subject );
 void p_load_library( struct parse* parent );
 void p_deinit_tk( struct parse* parse );
+void p_release_tk( struct parse* parse );
+void p_release_stream( struct parse* parse );
+void p_release_macros( struct parse* parse );
 void p_read_source( struct parse* parse, struct token* token );
+void p_skip_inactive_lines( struct parse* parse );
 bool p_read_dirc( struct parse* parse );
 void p_confirm_ifdircs_closed( struct parse* parse );
 struct macro* p_find_macro( struct parse* parse, const char* name );
@@ -542,6 +600,16 @@ void p_skip_semicolon( struct parse* parse );
 bool p_peek_type_path( struct parse* parse );
 void p_read_target_lib( struct parse* parse );
 void p_clear_macros( struct parse* parse );
+struct macro* p_alloc_macro( struct parse* parse );
+void p_add_macro_param( struct parse* parse, struct macro* macro,
+   const char* name );
+void p_append_macro_token( struct macro* macro, struct token* token );
+void p_append_macro( struct parse* parse, struct macro* macro );
+bool p_load_pch( struct parse* parse, struct file_entry* file );
+bool p_read_pch_token( struct parse* parse );
+void p_record_pch_token( struct parse* parse );
+void p_finish_pch_record( struct parse* parse );
+void p_break_pch_record( struct parse* parse );
 void p_define_predef_macros( struct parse* parse );
 void p_define_imported_macro( struct parse* parse );
 void p_define_included_macro( struct parse* parse );
@@ -551,6 +619,7 @@ void p_read_func_body( struct parse* parse, struct func* func );
 bool p_is_macro_defined( struct parse* parse, const char* name );
 void p_init_token( struct token* token );
 void p_pop_source( struct parse* parse );
+void p_break_include_guard( struct parse* parse );
 void p_create_cmdline_library_links( struct parse* parse );
 void p_read_local_using( struct parse* parse, zbcx_List* output );
 bool p_read_let( struct parse* parse );
@@ -93,7 +93,7 @@ static void read_block( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct block* alloc_block( void ) {
-   struct block* block = mem_alloc( sizeof( *block ) );
+   struct block* block = mem_arena_alloc( sizeof( *block ) );
    block->node.type = NODE_BLOCK;
    zbcx_list_init( &block->stmts );
    return block;
@@ -227,7 +227,7 @@ static void read_stmt( struct parse* parse, struct stmt_reading* reading,
 }
 
 static void read_case( struct parse* parse, struct stmt_reading* reading ) {
-   struct case_label* label = mem_alloc( sizeof( *label ) );
+   struct case_label* label = mem_arena_alloc( sizeof( *label ) );
    label->node.type = NODE_CASE;
    label->offset = 0;
    label->next = NULL;
@@ -245,7 +245,7 @@ static void read_case( struct parse* parse, struct stmt_reading* reading ) {
 
 static void read_default_case( struct parse* parse,
    struct stmt_reading* reading ) {
-   struct case_label* label = mem_alloc( sizeof( *label ) );
+   struct case_label* label = mem_arena_alloc( sizeof( *label ) );
    label->node.type = NODE_CASE_DEFAULT;
    label->pos = parse->tk_pos;
    label->offset = 0;
@@ -266,7 +266,7 @@ static void read_label( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct label* alloc_label( const char* name, struct pos* pos ) {
-   struct label* label = mem_alloc( sizeof( *label ) );
+   struct label* label = mem_arena_alloc( sizeof( *label ) );
    label->node.type = NODE_GOTO_LABEL;
    label->pos = *pos;
    label->name = name;
@@ -278,7 +278,7 @@ static struct label* alloc_label( const char* name, struct pos* pos ) {
 
 static void read_if( struct parse* parse, struct stmt_reading* reading ) {
    p_read_tk( parse );
-   struct if_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct if_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_IF;
    init_heavy_cond( &stmt->cond );
    p_test_tk( parse, TK_PAREN_L );
@@ -362,7 +362,7 @@ static void read_switch( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct switch_stmt* alloc_switch_stmt( void ) {
-   struct switch_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct switch_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_SWITCH;
    init_heavy_cond( &stmt->cond );
    stmt->case_head = NULL;
@@ -393,7 +393,7 @@ static void read_while( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct while_stmt* alloc_while( void ) {
-   struct while_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct while_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_WHILE;
    init_cond( &stmt->cond );
    stmt->body = NULL;
@@ -431,7 +431,7 @@ static void read_do( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct do_stmt* alloc_do( void ) {
-   struct do_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct do_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_DO;
    stmt->cond = NULL;
    stmt->body = NULL;
@@ -444,7 +444,7 @@ static struct do_stmt* alloc_do( void ) {
 static void read_for( struct parse* parse, struct stmt_reading* reading ) {
    p_test_tk( parse, TK_FOR );
    p_read_tk( parse );
-   struct for_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct for_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_FOR;
    zbcx_list_init( &stmt->init );
    zbcx_list_init( &stmt->post );
@@ -536,7 +536,7 @@ static void read_foreach( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct foreach_stmt* alloc_foreach( void ) {
-   struct foreach_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct foreach_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_FOREACH;
    stmt->key = NULL;
    stmt->value = NULL;
@@ -548,7 +548,7 @@ static struct foreach_stmt* alloc_foreach( void ) {
 }
 
 static void read_jump( struct parse* parse, struct stmt_reading* reading ) {
-   struct jump* stmt = mem_alloc( sizeof( *stmt ) );
+   struct jump* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_JUMP;
    stmt->type = JUMP_BREAK;
    stmt->next = NULL;
@@ -566,7 +566,7 @@ static void read_jump( struct parse* parse, struct stmt_reading* reading ) {
 
 static void read_script_jump( struct parse* parse,
    struct stmt_reading* reading ) {
-   struct script_jump* stmt = mem_alloc( sizeof( *stmt ) );
+   struct script_jump* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_SCRIPT_JUMP;
    stmt->type = SCRIPT_JUMP_TERMINATE;
    stmt->pos = parse->tk_pos;
@@ -584,7 +584,7 @@ static void read_script_jump( struct parse* parse,
 
 static void read_return( struct parse* parse, struct stmt_reading* reading ) {
    p_test_tk( parse, TK_RETURN );
-   struct return_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct return_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_RETURN;
    stmt->return_value = NULL;
    stmt->buildmsg = NULL;
@@ -623,7 +623,7 @@ static void read_goto( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct goto_stmt* alloc_goto_stmt( struct pos* pos ) {
-   struct goto_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct goto_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_GOTO;
    stmt->obj_pos = 0;
    stmt->label = NULL;
@@ -637,7 +637,7 @@ static struct goto_stmt* alloc_goto_stmt( struct pos* pos ) {
 static void read_paltrans( struct parse* parse,
    struct stmt_reading* reading ) {
    p_read_tk( parse );
-   struct paltrans* stmt = mem_alloc( sizeof( *stmt ) );
+   struct paltrans* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_PALTRANS;
    stmt->ranges = NULL;
    stmt->ranges_tail = NULL;
@@ -648,7 +648,7 @@ static void read_paltrans( struct parse* parse,
    p_read_expr( parse, &expr );
    stmt->number = expr.output_node;
    while ( parse->tk == TK_COMMA ) {
-      struct palrange* range = mem_alloc( sizeof( *range ) );
+      struct palrange* range = mem_arena_alloc( sizeof( *range ) );
       range->next = NULL;
       range->rgb = false;
       range->saturated = false;
@@ -770,7 +770,7 @@ static void read_palrange_tint( struct parse* parse, struct palrange* range ) {
 
 static void read_buildmsg_stmt( struct parse* parse,
    struct stmt_reading* reading ) {
-   struct buildmsg_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct buildmsg_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_BUILDMSG;
    stmt->buildmsg = read_buildmsg( parse, reading );
    reading->node = &stmt->node;
@@ -788,7 +788,7 @@ static struct buildmsg* read_buildmsg( struct parse* parse,
    p_test_tk( parse, TK_PAREN_R );
    p_read_tk( parse );
    read_block( parse, reading );
-   struct buildmsg* buildmsg = mem_alloc( sizeof( *buildmsg ) );
+   struct buildmsg* buildmsg = mem_arena_alloc( sizeof( *buildmsg ) );
    buildmsg->expr = expr.output_node;
    buildmsg->block = reading->block_node;
    zbcx_list_init( &buildmsg->usages );
@@ -797,7 +797,7 @@ static struct buildmsg* read_buildmsg( struct parse* parse,
 
 static void read_expr_stmt( struct parse* parse,
    struct stmt_reading* reading ) {
-   struct expr_stmt* stmt = mem_alloc( sizeof( *stmt ) );
+   struct expr_stmt* stmt = mem_arena_alloc( sizeof( *stmt ) );
    stmt->node.type = NODE_EXPR_STMT;
    zbcx_list_init( &stmt->expr_list );
    while ( true ) {
@@ -846,7 +846,7 @@ static void read_assert( struct parse* parse, struct stmt_reading* reading ) {
 }
 
 static struct assert* alloc_assert( struct pos* pos ) {
-   struct assert* assert = mem_alloc( sizeof( *assert ) );
+   struct assert* assert = mem_arena_alloc( sizeof( *assert ) );
    assert->node.type = NODE_ASSERT;
    assert->next = NULL;
    assert->cond = NULL;
@@ -53,7 +53,6 @@ static void read_define( struct parse* parse );
 static void read_macro_name( struct parse* parse,
    struct macro_reading* reading );
 static bool valid_macro_name( const char* name );
-static struct macro* alloc_macro( struct parse* parse );
 static void read_macro_param_list( struct parse* parse,
    struct macro_reading* reading );
 static void read_param_list( struct parse* parse,
@@ -66,11 +65,10 @@ static void read_body( struct parse* parse, struct macro_reading* reading );
 static void read_body_item( struct parse* parse,
    struct macro_reading* reading );
 static bool valid_macro_param( struct parse* parse, struct macro* macro );
-static void append_token( struct macro* macro, struct token* token );
 static void finish_macro( struct parse* parse, struct macro_reading* reading );
 static bool same_macro( struct macro* a, struct macro* b );
 static void free_macro( struct parse* parse, struct macro* macro );
-static void append_macro( struct parse* parse, struct macro* macro );
+static unsigned int hash_macro_name( const char* name );
 static void read_include( struct parse* parse );
 static void read_error( struct parse* parse, struct pos* pos );
 static void read_line( struct parse* parse );
@@ -81,6 +79,8 @@ static void push_ifdirc( struct parse* parse, const char* name,
    struct pos* pos );
 static bool pop_ifdirc( struct parse* parse );
 static void read_ifdef( struct parse* parse, struct pos* pos );
+static void start_include_guard( struct parse* parse );
+static void end_include_guard( struct parse* parse, bool closed );
 static void find_elif( struct parse* parse );
 static void init_endif_search( struct endif_search* search,
    bool execute_else );
@@ -101,6 +101,9 @@ bool p_read_dirc( struct parse* parse ) {
    enum dirc dirc = identify_dirc( parse );
    if ( dirc != DIRC_NONE ) {
       struct pos pos = parse->token->pos;
+      if ( dirc != DIRC_IFNDEF && dirc != DIRC_NULL ) {
+         p_break_include_guard( parse );
+      }
       p_test_preptk( parse, TK_HASH );
       p_read_preptk( parse );
       read_identified_dirc( parse, &pos, dirc );
@@ -236,7 +239,7 @@ static void read_macro_name( struct parse* parse,
          "invalid macro name" );
       p_bail( parse );
    }
-   struct macro* macro = alloc_macro( parse );
+   struct macro* macro = p_alloc_macro( parse );
    macro->name = parse->token->text;
    macro->pos = parse->token->pos;
    reading->macro = macro;
@@ -248,7 +251,7 @@ inline static bool valid_macro_name( const char* name ) {
    return ( strcmp( name, "defined" ) != 0 );
 }
 
-static struct macro* alloc_macro( struct parse* parse ) {
+struct macro* p_alloc_macro( struct parse* parse ) {
    struct macro* macro;
    if ( parse->macro_free ) {
       macro = parse->macro_free;
@@ -339,6 +342,13 @@ static struct macro_param* alloc_param( struct parse* parse ) {
    return param;
 }
 
+void p_add_macro_param( struct parse* parse, struct macro* macro,
+   const char* name ) {
+   struct macro_param* param = alloc_param( parse );
+   param->name = name;
+   append_param( macro, param );
+}
+
 static void append_param( struct macro* macro, struct macro_param* param ) {
    if ( macro->param_head ) {
       macro->param_tail->next = param;
@@ -426,7 +436,7 @@ static void read_body_item( struct parse* parse,
    if ( token->type == TK_HORZSPACE ) {
       token->length = 1;
    }
-   append_token( reading->macro, token );
+   p_append_macro_token( reading->macro, token );
    if ( strcmp( token->text, reading->macro->name ) == 0 ) {
       struct macro_param* param = reading->macro->param_head;
       while ( param && strcmp( param->name, token->text ) != 0 ) {
@@ -450,7 +460,7 @@ static bool valid_macro_param( struct parse* parse, struct macro* macro ) {
    return false;
 }
 
-static void append_token( struct macro* macro, struct token* token ) {
+void p_append_macro_token( struct macro* macro, struct token* token ) {
    if ( macro->body ) {
       macro->body_tail->next = token;
    }
@@ -482,22 +492,16 @@ static void finish_macro( struct parse* parse,
       }
    }
    else {
-      append_macro( parse, reading->macro );
+      p_append_macro( parse, reading->macro );
    }
    parse->variadic_macro_context = false;
 }
 
 struct macro* p_find_macro( struct parse* parse, const char* name ) {
-   struct macro* macro = parse->macro_head;
-   while ( macro ) {
-      int result = strcmp( macro->name, name );
-      if ( result == 0 ) {
-         break;
-      }
-      if ( result > 0 ) {
-         macro = NULL;
-         break;
-      }
+   unsigned int hash = hash_macro_name( name );
+   struct macro* macro = parse->macro_table[ hash % MACROTABLE_SIZE ];
+   while ( macro && ! ( macro->hash == hash &&
+      strcmp( macro->name, name ) == 0 ) ) {
       macro = macro->next;
    }
    return macro;
@@ -563,29 +567,52 @@ static void free_macro( struct parse* parse, struct macro* macro ) {
    parse->macro_free = macro;
 }
 
-static void append_macro( struct parse* parse, struct macro* macro ) {
-   struct macro* prev = NULL;
-   struct macro* curr = parse->macro_head;
-   while ( curr && strcmp( curr->name, macro->name ) < 0 ) {
-      prev = curr;
-      curr = curr->next;
-   }
-   if ( prev ) {
-      macro->next = prev->next;
-      prev->next = macro;
-   }
-   else {
-      macro->next = parse->macro_head;
-      parse->macro_head = macro;
+static unsigned int hash_macro_name( const char* name ) {
+   unsigned int hash = 2166136261u;
+   while ( *name ) {
+      hash = ( hash ^ ( unsigned char ) *name ) * 16777619u;
+      ++name;
    }
+   return hash;
+}
+
+void p_append_macro( struct parse* parse, struct macro* macro ) {
+   macro->hash = hash_macro_name( macro->name );
+   struct macro** bucket = &parse->macro_table[ macro->hash %
+      MACROTABLE_SIZE ];
+   macro->next = *bucket;
+   *bucket = macro;
 }
 
 void p_clear_macros( struct parse* parse ) {
-   struct macro* macro = parse->macro_head;
-   while ( macro ) {
-      parse->macro_head = macro->next;
-      free_macro( parse, macro );
-      macro = parse->macro_head;
+   for ( int i = 0; i < MACROTABLE_SIZE; ++i ) {
+      struct macro* macro = parse->macro_table[ i ];
+      while ( macro ) {
+         parse->macro_table[ i ] = macro->next;
+         free_macro( parse, macro );
+         macro = parse->macro_table[ i ];
+      }
+   }
+}
+
+// Frees the macros and the pooled structures of the directives. The tokens of
+// the macro bodies are released with the token stream.
+void p_release_macros( struct parse* parse ) {
+   p_clear_macros( parse );
+   while ( parse->macro_free ) {
+      struct macro* next = parse->macro_free->next;
+      mem_free( parse->macro_free );
+      parse->macro_free = next;
+   }
+   while ( parse->macro_param_free ) {
+      struct macro_param* next = parse->macro_param_free->next;
+      mem_free( parse->macro_param_free );
+      parse->macro_param_free = next;
+   }
+   while ( parse->ifdirc_free ) {
+      struct ifdirc* prev = parse->ifdirc_free->prev;
+      mem_free( parse->ifdirc_free );
+      parse->ifdirc_free = prev;
    }
 }
 
@@ -657,29 +684,15 @@ static void read_undef( struct parse* parse ) {
 }
 
 static struct macro* remove_macro( struct parse* parse, const char* name ) {
-   struct macro* macro_prev = NULL;
-   struct macro* macro = parse->macro_head;
-   while ( macro ) {
-      int result = strcmp( macro->name, name );
-      if ( result == 0 ) {
-         break;
-      }
-      else if ( result > 0 ) {
-         macro = NULL;
-         break;
-      }
-      else {
-         macro_prev = macro;
-         macro = macro->next;
-      }
+   unsigned int hash = hash_macro_name( name );
+   struct macro** link = &parse->macro_table[ hash % MACROTABLE_SIZE ];
+   while ( *link && ! ( ( *link )->hash == hash &&
+      strcmp( ( *link )->name, name ) == 0 ) ) {
+      link = &( *link )->next;
    }
+   struct macro* macro = *link;
    if ( macro ) {
-      if ( macro_prev ) {
-         macro_prev->next = macro->next;
-      }
-      else {
-         parse->macro_head = macro->next;
-      }
+      *link = macro->next;
    }
    return macro;
 }
@@ -731,6 +744,9 @@ static void read_ifdef( struct parse* parse, struct pos* pos ) {
    p_read_preptk( parse );
    p_test_preptk( parse, TK_ID );
    bool defined = p_is_macro_defined( parse, parse->token->text );
+   if ( parse->ifdirc->name[ 2 ] == 'n' ) {
+      start_include_guard( parse );
+   }
    p_read_preptk( parse );
    p_test_preptk( parse, TK_NL );
    if ( ! (
@@ -740,6 +756,21 @@ static void read_ifdef( struct parse* parse, struct pos* pos ) {
    }
 }
 
+// An #ifndef directive at the start of a file can be the start of an include
+// guard. The current token is the name of the macro.
+static void start_include_guard( struct parse* parse ) {
+   struct source_entry* entry = parse->source_entry;
+   if ( entry->guard == INCLUDEGUARD_START ) {
+      entry->guard = INCLUDEGUARD_OPEN;
+      entry->guard_ifdirc = parse->ifdirc;
+      entry->guard_macro = t_intern_text( parse->task, parse->token->text,
+         parse->token->length );
+   }
+   else {
+      p_break_include_guard( parse );
+   }
+}
+
 bool p_is_macro_defined( struct parse* parse, const char* name ) {
    return ( p_find_macro( parse, name ) != NULL );
 }
@@ -760,6 +791,12 @@ static void init_endif_search( struct endif_search* search,
 static void find_endif( struct parse* parse, struct endif_search* search ) {
    while ( ! search->done ) {
       if ( parse->token->type == TK_NL ) {
+         // Lines read straight from the source file can be skipped without
+         // being split into tokens.
+         if ( parse->source && ! parse->macro_expan &&
+            parse->tkque->size == 0 ) {
+            p_skip_inactive_lines( parse );
+         }
          p_read_preptk( parse );
          if ( parse->token->type == TK_HASH ) {
             struct pos pos = parse->token->pos;
@@ -805,7 +842,10 @@ static void read_pragma( struct parse* parse ) {
    p_read_preptk( parse );
    const char* name = parse->token->text;
 
-   if( bcc_stricmp( "raw", name ) == 0 ) {
+   if ( bcc_stricmp( "once", name ) == 0 ) {
+      parse->source->file->once = true;
+   }
+   else if( bcc_stricmp( "raw", name ) == 0 ) {
       p_read_preptk( parse );
 	  const char* text = parse->token->text;
 
@@ -870,6 +910,7 @@ static void read_elif( struct parse* parse, struct endif_search* search,
          "#else found here" );
       p_bail( parse );
    }
+   end_include_guard( parse, false );
    if ( search->execute_else ) {
       search->done = ( value != 0 );
    }
@@ -892,6 +933,7 @@ static void read_else( struct parse* parse, struct endif_search* search,
          "#else previously found here" );
       p_bail( parse );
    }
+   end_include_guard( parse, false );
    parse->ifdirc->else_pos = *pos;
    parse->ifdirc->else_found = true;
    if ( search->execute_else ) {
@@ -901,6 +943,7 @@ static void read_else( struct parse* parse, struct endif_search* search,
 
 static void read_endif( struct parse* parse, struct endif_search* search,
    struct pos* pos ) {
+   end_include_guard( parse, true );
    p_test_preptk( parse, TK_ID );
    p_read_preptk( parse );
    p_test_preptk( parse, TK_NL );
@@ -915,6 +958,17 @@ static void read_endif( struct parse* parse, struct endif_search* search,
    }
 }
 
+// The file stays guarded only when the #ifndef directive of the include guard
+// ends with #endif, without an #else or #elif section.
+static void end_include_guard( struct parse* parse, bool closed ) {
+   struct source_entry* entry = parse->source_entry;
+   if ( entry->guard == INCLUDEGUARD_OPEN && parse->ifdirc &&
+      parse->ifdirc == entry->guard_ifdirc ) {
+      entry->guard = closed ? INCLUDEGUARD_CLOSED : INCLUDEGUARD_NONE;
+      entry->guard_ifdirc = NULL;
+   }
+}
+
 static void skip_section( struct parse* parse, struct pos* pos ) {
    struct endif_search search;
    init_endif_search( &search, false );
@@ -935,10 +989,10 @@ void p_confirm_ifdircs_closed( struct parse* parse ) {
 }
 
 void p_define_imported_macro( struct parse* parse ) {
-   struct macro* macro = alloc_macro( parse );
+   struct macro* macro = p_alloc_macro( parse );
    macro->name = "__IMPORTED__";
    macro->predef = PREDEFMACRO_IMPORTED;
-   append_macro( parse, macro );
+   p_append_macro( parse, macro );
 }
 
 // The predefined __INCLUDED__ macro is present as long as an #included file is
@@ -946,10 +1000,10 @@ void p_define_imported_macro( struct parse* parse ) {
 void p_define_included_macro( struct parse* parse ) {
    struct macro* macro = p_find_macro( parse, "__INCLUDED__" );
    if ( ! macro ) {
-      macro = alloc_macro( parse );
+      macro = p_alloc_macro( parse );
       macro->name = "__INCLUDED__";
       macro->predef = PREDEFMACRO_INCLUDED;
-      append_macro( parse, macro );
+      p_append_macro( parse, macro );
    }
 }
 
@@ -962,25 +1016,25 @@ void p_undefine_included_macro( struct parse* parse ) {
 
 void p_define_predef_macros( struct parse* parse ) {
    // Macro: __LINE__
-   struct macro* macro = alloc_macro( parse );
+   struct macro* macro = p_alloc_macro( parse );
    macro->name = "__LINE__";
    macro->predef = PREDEFMACRO_LINE;
-   append_macro( parse, macro );
+   p_append_macro( parse, macro );
    // Macro: __FILE__
-   macro = alloc_macro( parse );
+   macro = p_alloc_macro( parse );
    macro->name = "__FILE__";
    macro->predef = PREDEFMACRO_FILE;
-   append_macro( parse, macro );
+   p_append_macro( parse, macro );
    // Macro: __TIME__
-   macro = alloc_macro( parse );
+   macro = p_alloc_macro( parse );
    macro->name = "__TIME__";
    macro->predef = PREDEFMACRO_TIME;
-   append_macro( parse, macro );
+   p_append_macro( parse, macro );
    // Macro: __DATE__
-   macro = alloc_macro( parse );
+   macro = p_alloc_macro( parse );
    macro->name = "__DATE__";
    macro->predef = PREDEFMACRO_DATE;
-   append_macro( parse, macro );
+   p_append_macro( parse, macro );
 }
 
 void p_define_cmdline_macros( struct parse* parse ) {
@@ -995,11 +1049,11 @@ void p_define_cmdline_macros( struct parse* parse ) {
          token->type = TK_LIT_DECIMAL;
          token->text = CMDLINEMACRO_TEXT,
          token->length = strlen( CMDLINEMACRO_TEXT );
-         macro = alloc_macro( parse );
+         macro = p_alloc_macro( parse );
          macro->name = name;
          macro->pos.id = INTERNALFILE_COMMANDLINE;
-         append_token( macro, token );
-         append_macro( parse, macro );
+         p_append_macro_token( macro, token );
+         p_append_macro( parse, macro );
       }
       zbcx_list_next( &i );
    }
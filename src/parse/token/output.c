@@ -1,21 +1,61 @@
+#include <stdio.h>
+#include <string.h>
+
 #include "../phase.h"
 
-static void output_source( struct parse* parse, struct str* output );
-static void output_token( struct parse* parse, struct str* output );
+enum { OUTPUT_BUFFER_SIZE = 16384 };
+
+// Preprocessed text is collected in a fixed-size buffer and written out in
+// large chunks, so the memory used does not depend on the size of the input.
+struct prep_output {
+   struct parse* parse;
+   zbcx_Io fh;
+   int used;
+   // Position of the next line to be written.
+   int line;
+   int pos_id;
+   char last_ch;
+   bool line_beginning;
+   char buffer[ OUTPUT_BUFFER_SIZE ];
+};
+
+static void init_output( struct prep_output* output, struct parse* parse );
+static void output_source( struct parse* parse, struct prep_output* output );
+static void output_token( struct parse* parse, struct prep_output* output );
+static void sync_line( struct prep_output* output, struct token* token );
+static void write_line_marker( struct prep_output* output,
+   struct token* token );
+static void write_text( struct prep_output* output, const char* text,
+   int length );
+static void write_str( struct prep_output* output, const char* text );
+static void write_escaped_str( struct prep_output* output,
+   const char* text );
+static void flush_output( struct prep_output* output );
+static void close_output( struct prep_output* output );
 
 void p_preprocess( struct parse* parse ) {
    parse->read_flags = READF_NL | READF_SPACETAB;
-   struct str output;
-   str_init( &output );
-   output_source( parse, &output );
-   if ( output.length > 0 && output.value[ output.length - 1 ] != '\n' ) {
-      str_append( &output, NEWLINE_CHAR );
-   }
-   printf( "%s", output.value );
-   str_deinit( &output );
+   struct prep_output* output = mem_alloc( sizeof( *output ) );
+   init_output( output, parse );
+   output_source( parse, output );
+   if ( output->last_ch != '\0' && output->last_ch != '\n' ) {
+      write_str( output, NEWLINE_CHAR );
+   }
+   close_output( output );
+   mem_free( output );
+}
+
+static void init_output( struct prep_output* output, struct parse* parse ) {
+   output->parse = parse;
+   output->fh = parse->task->options->output;
+   output->used = 0;
+   output->line = 0;
+   output->pos_id = INTERNALFILE_NONE;
+   output->last_ch = '\0';
+   output->line_beginning = true;
 }
 
-static void output_source( struct parse* parse, struct str* output ) {
+static void output_source( struct parse* parse, struct prep_output* output ) {
    while ( true ) {
       p_read_eoptiontk( parse );
       if ( parse->token->type != TK_END ) {
@@ -29,57 +69,180 @@ static void output_source( struct parse* parse, struct str* output ) {
 }
 
 // TODO: Get the original text of the token.
-static void output_token( struct parse* parse, struct str* output ) {
-   switch ( parse->token->type ) {
+static void output_token( struct parse* parse, struct prep_output* output ) {
+   struct token* token = parse->token;
+   if ( output->line_beginning && token->type != TK_HORZSPACE ) {
+      sync_line( output, token );
+   }
+   switch ( token->type ) {
    case TK_NL:
-      str_append( output, NEWLINE_CHAR );
-      break;
+      write_str( output, NEWLINE_CHAR );
+      ++output->line;
+      output->line_beginning = true;
+      return;
    case TK_HORZSPACE:
-      for ( int i = 0; i < parse->token->length; ++i ) {
-         str_append( output, parse->token->text );
+      for ( int i = 0; i < token->length; ++i ) {
+         write_str( output, token->text );
       }
-      break;
+      return;
    case TK_LIT_STRING:
-      str_append( output, "\"" );
-      for ( int i = 0; i < parse->token->length; ++i ) {
-         if ( parse->token->text[ i ] == '"' ) {
-            str_append( output, "\\" );
+      write_str( output, "\"" );
+      {
+         int start = 0;
+         for ( int i = 0; i < token->length; ++i ) {
+            if ( token->text[ i ] == '"' ) {
+               write_text( output, token->text + start, i - start );
+               write_str( output, "\\" );
+               start = i;
+            }
          }
-         char ch[] = { parse->token->text[ i ], 0 };
-         str_append( output, ch );
+         write_text( output, token->text + start, token->length - start );
       }
-      str_append( output, "\"" );
+      write_str( output, "\"" );
       break;
    case TK_LIT_CHAR:
-      str_append( output, "'" );
-      str_append( output, parse->token->text );
-      str_append( output, "'" );
+      write_str( output, "'" );
+      write_str( output, token->text );
+      write_str( output, "'" );
       break;
    case TK_LIT_OCTAL:
-      str_append( output, "0o" );
-      str_append( output, parse->token->text );
+      write_str( output, "0o" );
+      write_str( output, token->text );
       break;
    case TK_LIT_HEX:
-      str_append( output, "0x" );
-      str_append( output, parse->token->text );
+      write_str( output, "0x" );
+      write_str( output, token->text );
       break;
    case TK_LIT_BINARY:
-      str_append( output, "0b" );
-      str_append( output, parse->token->text );
+      write_str( output, "0b" );
+      write_str( output, token->text );
       break;
    case TK_LIT_RADIX:
-      for ( int i = 0; i < parse->token->length; ++i ) {
-         if ( parse->token->text[ i ] == '_' ) {
-            str_append( output, "r" );
+      for ( int i = 0; i < token->length; ++i ) {
+         if ( token->text[ i ] == '_' ) {
+            write_str( output, "r" );
          }
          else {
-            char ch[] = { parse->token->text[ i ], 0 };
-            str_append( output, ch );
+            write_text( output, token->text + i, 1 );
          }
       }
       break;
    default:
-      str_append( output, parse->token->text );
+      write_str( output, token->text );
       break;
    }
+   output->line_beginning = false;
+}
+
+// Before writing the first token of a line, makes sure the line will be seen
+// at the position of the token. Directives and skipped sections do not appear
+// in the output, so the position is moved with a #line directive. Small gaps
+// are filled with empty lines instead.
+static void sync_line( struct prep_output* output, struct token* token ) {
+   enum { MAX_EMPTY_LINES = 8 };
+   if ( token->pos.id == INTERNALFILE_COMPILER ||
+      token->pos.id == INTERNALFILE_COMMANDLINE ||
+      ( token->pos.id == output->pos_id && token->pos.line == output->line ) ) {
+      return;
+   }
+   if ( token->pos.id == output->pos_id && token->pos.line > output->line &&
+      token->pos.line - output->line <= MAX_EMPTY_LINES ) {
+      while ( output->line < token->pos.line ) {
+         write_str( output, NEWLINE_CHAR );
+         ++output->line;
+      }
+   }
+   else {
+      write_line_marker( output, token );
+   }
+}
+
+static void write_line_marker( struct prep_output* output,
+   struct token* token ) {
+   const char* file = NULL;
+   int line = 0;
+   int column = 0;
+   t_decode_pos( output->parse->task, &token->pos, &file, &line, &column );
+   char number[ 11 ];
+   snprintf( number, sizeof( number ), "%d", line );
+   write_str( output, "#line " );
+   write_str( output, number );
+   if ( token->pos.id != output->pos_id ) {
+      write_str( output, " \"" );
+      write_escaped_str( output, file );
+      write_str( output, "\"" );
+   }
+   write_str( output, NEWLINE_CHAR );
+   output->line = token->pos.line;
+   output->pos_id = token->pos.id;
+}
+
+static void write_text( struct prep_output* output, const char* text,
+   int length ) {
+   if ( length <= 0 ) {
+      return;
+   }
+   output->last_ch = text[ length - 1 ];
+   while ( length > 0 ) {
+      int count = OUTPUT_BUFFER_SIZE - output->used;
+      if ( count > length ) {
+         count = length;
+      }
+      memcpy( output->buffer + output->used, text, count );
+      output->used += count;
+      text += count;
+      length -= count;
+      if ( output->used == OUTPUT_BUFFER_SIZE ) {
+         flush_output( output );
+      }
+   }
+}
+
+static void write_str( struct prep_output* output, const char* text ) {
+   write_text( output, text, strlen( text ) );
+}
+
+// Writes the text as the contents of a string literal. Backslashes, as found
+// in Windows paths, and quotes are escaped.
+static void write_escaped_str( struct prep_output* output,
+   const char* text ) {
+   int start = 0;
+   int i = 0;
+   while ( text[ i ] != '\0' ) {
+      if ( text[ i ] == '"' || text[ i ] == '\\' ) {
+         write_text( output, text + start, i - start );
+         write_str( output, "\\" );
+         start = i;
+      }
+      ++i;
+   }
+   write_text( output, text + start, i - start );
+}
+
+// Without an output stream, the text is written to the standard output.
+static void flush_output( struct prep_output* output ) {
+   if ( output->used == 0 ) {
+      return;
+   }
+   size_t written = 0;
+   if ( output->fh.vtable ) {
+      written = output->fh.vtable->write( output->buffer, 1, output->used,
+         output->fh.state );
+   }
+   else {
+      written = fwrite( output->buffer, 1, output->used, stdout );
+   }
+   if ( written != ( size_t ) output->used ) {
+      p_diag( output->parse, DIAG_ERR,
+         "failed to write preprocessor output" );
+      p_bail( output->parse );
+   }
+   output->used = 0;
+}
+
+static void close_output( struct prep_output* output ) {
+   flush_output( output );
+   if ( output->fh.vtable ) {
+      output->fh.vtable->close( output->fh.state );
+   }
 }
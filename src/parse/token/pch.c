@@ -0,0 +1,501 @@
+#include <string.h>
+
+#include "../phase.h"
+#include "../../cache/cache.h"
+
+// Precompiled header
+// ==========================================================================
+// The header selected with the `pch_header` option is read normally the first
+// time it is #included. The tokens it gives to the parser are recorded, and
+// once the header is finished, the tokens are saved in the cache together
+// with the macros the header defined. The next time the header is #included
+// with the same options, and the files read for the header have not changed,
+// the saved tokens are given to the parser instead of reading the header.
+//
+// The tokens produced by a header also depend on the macros defined before
+// the header is #included, so these macros are part of the key of the
+// precompiled header.
+
+static bool is_pch_header( struct parse* parse, struct file_entry* file );
+static const char* create_key( struct parse* parse );
+static void append_macro_key( struct str* key, struct macro* macro );
+static void start_replay( struct parse* parse, struct pch* pch );
+static void restore_files( struct parse* parse, struct pch* pch,
+   struct file_entry** files );
+static void restore_includes( struct parse* parse, struct pch* pch,
+   struct file_entry** files );
+static void restore_macros( struct parse* parse, struct pch* pch,
+   int first_include );
+static void restore_token( struct pch_token* pch_token, struct token* token,
+   int first_include );
+static int decode_id( int first_include, int id );
+static void start_record( struct parse* parse, struct file_entry* file,
+   const char* key );
+static void record_token( struct pch_record* record,
+   struct pch_token_list* list, struct token* token );
+static int encode_id( struct pch_record* record, int id );
+// Called for content that can be different the next time the header is read,
+// such as the time of compilation.
+void p_break_pch_record( struct parse* parse ) {
+   if ( parse->pch_record ) {
+      parse->pch_record->uncacheable = true;
+   }
+}
+
+static void save_includes( struct parse* parse, struct pch_record* record );
+static int save_file( struct pch_record* record, struct task* task, int id );
+static void save_macros( struct parse* parse, struct pch_record* record );
+static void save_initial_macros( struct parse* parse,
+   struct pch_record* record );
+static bool initial_macros_kept( struct parse* parse,
+   struct pch_record* record );
+static bool initial_macro( struct pch_record* record, struct macro* macro );
+
+// Returns true when the header is replaced with its precompiled form.
+// Otherwise, the header is to be read normally, and is recorded if possible.
+bool p_load_pch( struct parse* parse, struct file_entry* file ) {
+   if ( ! is_pch_header( parse, file ) ) {
+      return false;
+   }
+   const char* key = create_key( parse );
+   int phase = t_enter_timing( parse->task, TIMING_CACHE );
+   struct pch* pch = cache_get_pch( parse->cache, file->full_path.value,
+      key );
+   t_leave_timing( parse->task, phase );
+   if ( pch ) {
+      t_count( parse->task, COUNT_PCH_HITS );
+      start_replay( parse, pch );
+      return true;
+   }
+   else {
+      t_count( parse->task, COUNT_PCH_MISSES );
+      start_record( parse, file, key );
+      return false;
+   }
+}
+
+static bool is_pch_header( struct parse* parse, struct file_entry* file ) {
+   const char* path = parse->task->options->cache.pch_header;
+   if ( ! ( path && parse->cache && ! parse->task->options->preprocess &&
+      ! parse->pch_record &&
+      ! parse->pch_replay && parse->lib == parse->task->library_main &&
+      parse->source_entry->main && ! parse->macro_expan ) ) {
+      return false;
+   }
+   struct file_query query;
+   t_init_file_query( &query, NULL, path );
+   t_find_file( parse->task, &query );
+   return ( query.file == file );
+}
+
+static const char* create_key( struct parse* parse ) {
+   struct str key;
+   str_init( &key );
+   zbcx_ListIter i;
+   zbcx_list_iterate( &parse->task->options->includes, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      str_append( &key, "I" );
+      str_append( &key, zbcx_list_data( &i ) );
+      str_append( &key, "\n" );
+      zbcx_list_next( &i );
+   }
+   // Whether #define and #include are executed depends on this state.
+   str_append( &key, parse->ifdirc ? "if" : "-" );
+   str_append( &key, parse->preproc_pragmas.raw_define ? "define" : "-" );
+   str_append( &key, parse->preproc_pragmas.raw_include ? "include" : "-" );
+   str_append( &key, "\n" );
+   for ( int i = 0; i < MACROTABLE_SIZE; ++i ) {
+      struct macro* macro = parse->macro_table[ i ];
+      while ( macro ) {
+         if ( macro->predef == PREDEFMACRO_NONE ) {
+            append_macro_key( &key, macro );
+         }
+         macro = macro->next;
+      }
+   }
+   const char* value = t_intern_text( parse->task, key.value, key.length );
+   str_deinit( &key );
+   return value;
+}
+
+static void append_macro_key( struct str* key, struct macro* macro ) {
+   str_append( key, "M" );
+   str_append( key, macro->name );
+   if ( macro->func_like ) {
+      str_append( key, "(" );
+      struct macro_param* param = macro->param_head;
+      while ( param ) {
+         str_append( key, param->name );
+         str_append( key, param->next ? "," : "" );
+         param = param->next;
+      }
+      str_append( key, macro->variadic ? "...)" : ")" );
+   }
+   struct token* token = macro->body;
+   while ( token ) {
+      str_append( key, " " );
+      str_append( key, token->text ? token->text : "" );
+      token = token->next;
+   }
+   str_append( key, "\n" );
+}
+
+// Replay
+// ==========================================================================
+
+static void start_replay( struct parse* parse, struct pch* pch ) {
+   struct pch_replay* replay = mem_alloc( sizeof( *replay ) );
+   replay->pch = pch;
+   p_init_token( &replay->token );
+   replay->next_token = 0;
+   replay->first_include = zbcx_list_size( &parse->task->include_history );
+   struct file_entry** files = mem_alloc( sizeof( files[ 0 ] ) *
+      ( zbcx_list_size( &pch->files ) + 1 ) );
+   restore_files( parse, pch, files );
+   restore_includes( parse, pch, files );
+   mem_free( files );
+   restore_macros( parse, pch, replay->first_include );
+   parse->preproc_pragmas.raw_define = pch->raw_define;
+   parse->preproc_pragmas.raw_include = pch->raw_include;
+   parse->included_lines += pch->lines;
+   parse->pch_replay = replay;
+}
+
+static void restore_files( struct parse* parse, struct pch* pch,
+   struct file_entry** files ) {
+   int count = 0;
+   zbcx_ListIter i;
+   zbcx_list_iterate( &pch->files, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_file* pch_file = zbcx_list_data( &i );
+      struct file_query query;
+      t_init_file_query( &query, NULL, pch_file->path );
+      t_find_file( parse->task, &query );
+      if ( ! query.file ) {
+         p_diag( parse, DIAG_ERR,
+            "failed to find file of precompiled header: %s",
+            pch_file->path );
+         p_bail( parse );
+      }
+      if ( pch_file->guard_macro ) {
+         query.file->guard_macro = pch_file->guard_macro;
+      }
+      if ( pch_file->once ) {
+         query.file->once = true;
+      }
+      p_append_lib_file( parse->lib, query.file );
+      files[ count ] = query.file;
+      ++count;
+      zbcx_list_next( &i );
+   }
+}
+
+// The include-history entries are recreated in the same order, so the IDs
+// found in the positions of the tokens only need to be offset.
+static void restore_includes( struct parse* parse, struct pch* pch,
+   struct file_entry** files ) {
+   int first_include = zbcx_list_size( &parse->task->include_history );
+   zbcx_ListIter i;
+   zbcx_list_iterate( &pch->includes, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_include* include = zbcx_list_data( &i );
+      struct include_history_entry* entry =
+         t_alloc_include_history_entry( parse->task );
+      if ( include->parent >= 0 ) {
+         entry->parent = t_decode_include_history_entry( parse->task,
+            first_include + include->parent );
+      }
+      else if ( include->parent == -1 ) {
+         entry->parent = parse->include_history_entry;
+      }
+      if ( include->file >= 0 ) {
+         entry->file_entry_id = files[ include->file ]->id;
+      }
+      entry->altern_name = include->altern_name;
+      entry->line = include->line;
+      zbcx_list_next( &i );
+   }
+}
+
+static void restore_macros( struct parse* parse, struct pch* pch,
+   int first_include ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &pch->macros, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_macro* pch_macro = zbcx_list_data( &i );
+      if ( ! p_find_macro( parse, pch_macro->name ) ) {
+         struct macro* macro = p_alloc_macro( parse );
+         macro->name = pch_macro->name;
+         zbcx_ListIter k;
+         zbcx_list_iterate( &pch_macro->params, &k );
+         while ( ! zbcx_list_end( &k ) ) {
+            p_add_macro_param( parse, macro, zbcx_list_data( &k ) );
+            zbcx_list_next( &k );
+         }
+         for ( int j = 0; j < pch_macro->body.count; ++j ) {
+            struct token* token = p_alloc_token( parse );
+            restore_token( &pch_macro->body.tokens[ j ], token,
+               first_include );
+            p_append_macro_token( macro, token );
+         }
+         macro->pos = pch_macro->pos;
+         macro->pos.id = decode_id( first_include, macro->pos.id );
+         macro->func_like = pch_macro->func_like;
+         macro->variadic = pch_macro->variadic;
+         p_append_macro( parse, macro );
+      }
+      zbcx_list_next( &i );
+   }
+}
+
+// NOTE: The text of a restored token is located in the data of the
+// precompiled header, which stays in memory, so the text can be modified the
+// same way as the text of a token read from a source file.
+static void restore_token( struct pch_token* pch_token, struct token* token,
+   int first_include ) {
+   token->next = NULL;
+   token->modifiable_text = ( char* ) pch_token->text;
+   token->text = pch_token->text;
+   token->pos = pch_token->pos;
+   token->pos.id = decode_id( first_include, token->pos.id );
+   token->type = pch_token->type;
+   token->length = pch_token->length;
+}
+
+static int decode_id( int first_include, int id ) {
+   return ( id < 0 ) ? first_include - id - 1 : id;
+}
+
+// Reads the next token of the precompiled header. Returns false when no tokens
+// are left.
+bool p_read_pch_token( struct parse* parse ) {
+   struct pch_replay* replay = parse->pch_replay;
+   if ( replay->next_token < replay->pch->tokens.count ) {
+      restore_token( &replay->pch->tokens.tokens[ replay->next_token ],
+         &replay->token, replay->first_include );
+      ++replay->next_token;
+      parse->token = &replay->token;
+      return true;
+   }
+   else {
+      parse->pch_replay = NULL;
+      mem_free( replay );
+      return false;
+   }
+}
+
+// Record
+// ==========================================================================
+
+static void start_record( struct parse* parse, struct file_entry* file,
+   const char* key ) {
+   struct pch_record* record = mem_alloc( sizeof( *record ) );
+   record->pch = cache_alloc_pch();
+   record->pch->path = file->full_path.value;
+   record->pch->key = key;
+   record->file = file;
+   record->parent_include = parse->include_history_entry;
+   // The include-history entry of the header is created next.
+   record->first_include = zbcx_list_size( &parse->task->include_history );
+   record->included_lines = parse->included_lines;
+   record->uncacheable = false;
+   zbcx_list_init( &record->initial_macros );
+   save_initial_macros( parse, record );
+   parse->pch_record = record;
+}
+
+void p_record_pch_token( struct parse* parse ) {
+   record_token( parse->pch_record, &parse->pch_record->pch->tokens,
+      parse->token );
+}
+
+static void record_token( struct pch_record* record,
+   struct pch_token_list* list, struct token* token ) {
+   struct pch_token pch_token;
+   pch_token.text = token->text;
+   pch_token.pos = token->pos;
+   pch_token.pos.id = encode_id( record, token->pos.id );
+   pch_token.type = token->type;
+   pch_token.length = token->length;
+   cache_append_pch_token( list, &pch_token );
+}
+
+// Include-history entries of the header are stored relative to the entry of
+// the header, as negative numbers. The IDs of the internal files are kept as
+// they are.
+static int encode_id( struct pch_record* record, int id ) {
+   if ( id >= record->first_include ) {
+      return record->first_include - id - 1;
+   }
+   else {
+      if ( id >= INTERNALFILE_TOTAL ) {
+         record->uncacheable = true;
+      }
+      return id;
+   }
+}
+
+// Called when the header is finished.
+void p_finish_pch_record( struct parse* parse ) {
+   struct pch_record* record = parse->pch_record;
+   parse->pch_record = NULL;
+   // A macro whose arguments continue after the end of the header.
+   if ( parse->macro_expan ) {
+      record->uncacheable = true;
+   }
+   if ( ! initial_macros_kept( parse, record ) ) {
+      record->uncacheable = true;
+   }
+   save_includes( parse, record );
+   save_macros( parse, record );
+   record->pch->lines = parse->included_lines - record->included_lines;
+   record->pch->raw_define = parse->preproc_pragmas.raw_define;
+   record->pch->raw_include = parse->preproc_pragmas.raw_include;
+   if ( ! record->uncacheable ) {
+      cache_add_pch( parse->cache, record->pch );
+   }
+   zbcx_list_deinit( &record->initial_macros );
+   mem_free( record );
+}
+
+static void save_includes( struct parse* parse, struct pch_record* record ) {
+   int total = zbcx_list_size( &parse->task->include_history );
+   for ( int id = record->first_include; id < total; ++id ) {
+      struct include_history_entry* entry =
+         t_decode_include_history_entry( parse->task, id );
+      struct pch_include* include = mem_alloc( sizeof( *include ) );
+      include->altern_name = entry->altern_name;
+      include->parent = -2;
+      if ( entry->parent ) {
+         if ( entry->parent->id >= record->first_include ) {
+            include->parent = entry->parent->id - record->first_include;
+         }
+         else if ( entry->parent == record->parent_include ) {
+            include->parent = -1;
+         }
+         else {
+            record->uncacheable = true;
+         }
+      }
+      include->file = -1;
+      if ( entry->file_entry_id != INTERNALFILE_NONE ) {
+         include->file = save_file( record, parse->task,
+            entry->file_entry_id );
+      }
+      include->line = entry->line;
+      zbcx_list_append( &record->pch->includes, include );
+   }
+}
+
+// Returns the index of the file in the file list of the precompiled header.
+static int save_file( struct pch_record* record, struct task* task, int id ) {
+   struct file_entry* file = task->file_entries;
+   while ( file && file->id != id ) {
+      file = file->next;
+   }
+   if ( ! file ) {
+      record->uncacheable = true;
+      return -1;
+   }
+   int index = 0;
+   zbcx_ListIter i;
+   zbcx_list_iterate( &record->pch->files, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct pch_file* pch_file = zbcx_list_data( &i );
+      if ( strcmp( pch_file->path, file->full_path.value ) == 0 ) {
+         return index;
+      }
+      ++index;
+      zbcx_list_next( &i );
+   }
+   struct file_contents contents;
+   fs_get_file_contents( file->full_path.value, &contents );
+   if ( ! contents.obtained ) {
+      record->uncacheable = true;
+      return -1;
+   }
+   struct pch_file* pch_file = mem_alloc( sizeof( *pch_file ) );
+   pch_file->path = file->full_path.value;
+   pch_file->guard_macro = file->guard_macro;
+   pch_file->hash = cache_hash_contents( contents.data, contents.size );
+   pch_file->size = contents.size;
+   pch_file->once = file->once;
+   mem_free( contents.data );
+   zbcx_list_append( &record->pch->files, pch_file );
+   return index;
+}
+
+static void save_macros( struct parse* parse, struct pch_record* record ) {
+   for ( int i = 0; i < MACROTABLE_SIZE; ++i ) {
+      struct macro* macro = parse->macro_table[ i ];
+      while ( macro ) {
+         if ( macro->predef == PREDEFMACRO_NONE &&
+            ! initial_macro( record, macro ) ) {
+            struct pch_macro* pch_macro = mem_alloc( sizeof( *pch_macro ) );
+            pch_macro->name = macro->name;
+            zbcx_list_init( &pch_macro->params );
+            struct macro_param* param = macro->param_head;
+            while ( param ) {
+               zbcx_list_append( &pch_macro->params,
+                  ( void* ) param->name );
+               param = param->next;
+            }
+            pch_macro->body.tokens = NULL;
+            pch_macro->body.count = 0;
+            pch_macro->body.capacity = 0;
+            struct token* token = macro->body;
+            while ( token ) {
+               record_token( record, &pch_macro->body, token );
+               token = token->next;
+            }
+            pch_macro->pos = macro->pos;
+            pch_macro->pos.id = encode_id( record, macro->pos.id );
+            pch_macro->func_like = macro->func_like;
+            pch_macro->variadic = macro->variadic;
+            zbcx_list_append( &record->pch->macros, pch_macro );
+         }
+         macro = macro->next;
+      }
+   }
+}
+
+static void save_initial_macros( struct parse* parse,
+   struct pch_record* record ) {
+   for ( int i = 0; i < MACROTABLE_SIZE; ++i ) {
+      struct macro* macro = parse->macro_table[ i ];
+      while ( macro ) {
+         if ( macro->predef == PREDEFMACRO_NONE ) {
+            zbcx_list_append( &record->initial_macros, macro );
+         }
+         macro = macro->next;
+      }
+   }
+}
+
+// The header can #undef a macro defined before the header, which the
+// precompiled header does not restore.
+static bool initial_macros_kept( struct parse* parse,
+   struct pch_record* record ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &record->initial_macros, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct macro* macro = zbcx_list_data( &i );
+      if ( p_find_macro( parse, macro->name ) != macro ) {
+         return false;
+      }
+      zbcx_list_next( &i );
+   }
+   return true;
+}
+
+static bool initial_macro( struct pch_record* record, struct macro* macro ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &record->initial_macros, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      if ( zbcx_list_data( &i ) == macro ) {
+         return true;
+      }
+      zbcx_list_next( &i );
+   }
+   return false;
+}
@@ -20,14 +20,16 @@ struct request {
    bool implicit_bcs_ext;
 };
 
-static void append_file( struct library* lib, struct file_entry* file );
 static void init_request( struct request* request,
    struct file_entry* offset_file, const char* path );
 static void init_request_module( struct request* request,
    struct file_entry* file );
 static void check_implicit_ext( struct parse* parse, struct request* request );
 static void load_source( struct parse* parse, struct request* request );
+static void load_found_source( struct parse* parse,
+   struct request* request );
 static void find_source( struct parse* parse, struct request* request );
+static bool included_before( struct parse* parse, struct file_entry* file );
 static bool source_loading( struct parse* parse, struct request* request );
 static void load_module( struct parse* parse, struct request* request );
 static void open_source_file( struct parse* parse, struct request* request );
@@ -53,7 +55,7 @@ void p_load_main_source( struct parse* parse ) {
    if ( request.source ) {
       parse->lib->file = request.file;
       parse->lib->file_pos.id = request.file->id;
-      append_file( parse->lib, request.file );
+      p_append_lib_file( parse->lib, request.file );
       create_entry( parse, &request, false );
       create_include_history_entry( parse, 0 );
       t_update_err_file_dir( parse->task, request.file->full_path.value );
@@ -74,7 +76,7 @@ void p_load_imported_lib_source( struct parse* parse, struct import_dirc* dirc,
    if ( request.source ) {
       parse->lib->file = file;
       parse->lib->file_pos.id = file->id;
-      append_file( parse->lib, file );
+      p_append_lib_file( parse->lib, file );
       create_entry( parse, &request, true );
       create_include_history_entry_imported( parse, dirc );
    }
@@ -99,9 +101,18 @@ void p_load_included_source( struct parse* parse, const char* file_path,
    struct request request;
    init_request( &request, parse->source->file, file_path );
    check_implicit_ext( parse, &request );
-   load_source( parse, &request );
+   find_source( parse, &request );
+   if ( request.file && included_before( parse, request.file ) ) {
+      parse->source_entry->prev_tk = TK_NL;
+      return;
+   }
+   if ( request.file && p_load_pch( parse, request.file ) ) {
+      parse->source_entry->prev_tk = TK_NL;
+      return;
+   }
+   load_found_source( parse, &request );
    if ( request.source ) {
-      append_file( parse->lib, request.file );
+      p_append_lib_file( parse->lib, request.file );
       create_entry( parse, &request, false );
       create_include_history_entry( parse, pos->line );
       p_define_included_macro( parse );
@@ -136,7 +147,7 @@ void p_load_included_source( struct parse* parse, const char* file_path,
    }
 }
 
-static void append_file( struct library* lib, struct file_entry* file ) {
+void p_append_lib_file( struct library* lib, struct file_entry* file ) {
    zbcx_ListIter i;
    zbcx_list_iterate( &lib->files, &i );
    while ( ! zbcx_list_end( &i ) ) {
@@ -174,6 +185,11 @@ static void check_implicit_ext( struct parse* parse, struct request* request ) {
 
 static void load_source( struct parse* parse, struct request* request ) {
    find_source( parse, request );
+   load_found_source( parse, request );
+}
+
+static void load_found_source( struct parse* parse,
+   struct request* request ) {
    if ( request->file ) {
       if ( ! source_loading( parse, request ) ) {
          open_source_file( parse, request );
@@ -216,6 +232,13 @@ static void find_source( struct parse* parse, struct request* request ) {
    }
 }
 
+// A file that is guarded by a macro, or marked with `#pragma once`, does not
+// need to be opened again once the macro is defined.
+static bool included_before( struct parse* parse, struct file_entry* file ) {
+   return ( file->once || ( file->guard_macro &&
+      p_is_macro_defined( parse, file->guard_macro ) ) );
+}
+
 static bool source_loading( struct parse* parse, struct request* request ) {
    struct source_entry* entry = parse->source_entry;
    while ( entry && ( ! entry->source ||
@@ -291,6 +314,9 @@ static void create_entry( struct parse* parse, struct request* request,
    p_init_token_queue( &entry->peeked, false );
    entry->main = ( entry->prev == NULL );
    entry->imported = imported;
+   entry->guard_ifdirc = NULL;
+   entry->guard_macro = NULL;
+   entry->guard = INCLUDEGUARD_START;
    entry->prev_tk = TK_NL;
    entry->line_beginning = true;
    parse->source_entry = entry;
@@ -340,12 +366,20 @@ void p_pop_source( struct parse* parse ) {
    struct source_entry* entry = parse->source_entry;
    struct source* source = entry->source;
    source->fh.vtable->close(source->fh.state);
+   if ( entry->guard == INCLUDEGUARD_CLOSED && ! entry->main &&
+      ! entry->imported ) {
+      source->file->guard_macro = entry->guard_macro;
+   }
    if ( entry->main ) {
       parse->main_lib_lines = source->line - LINE_OFFSET;
    }
    else {
       parse->included_lines += source->line - LINE_OFFSET;
    }
+   if ( parse->pch_record && source->file == parse->pch_record->file &&
+      ! entry->main ) {
+      p_finish_pch_record( parse );
+   }
    source->prev = parse->free_source;
    parse->free_source = source;
    entry->source = NULL;
@@ -370,6 +404,14 @@ void p_pop_source( struct parse* parse ) {
    }
 }
 
+// Called for content found in the file being read. Only content inside the
+// #ifndef directive of the include guard keeps the file guarded.
+void p_break_include_guard( struct parse* parse ) {
+   if ( parse->source_entry->guard != INCLUDEGUARD_OPEN ) {
+      parse->source_entry->guard = INCLUDEGUARD_NONE;
+   }
+}
+
 void p_read_source( struct parse* parse, struct token* token ) {
    char ch = parse->source->ch;
    int line = 0;
@@ -1219,6 +1261,77 @@ void p_read_source( struct parse* parse, struct token* token ) {
    token->next = NULL;
 }
 
+// Skips the lines of a section of an if-directive that is not used, up to the
+// next line that starts with a directive. Tokens are not created for the
+// skipped lines. Only comments and string and character literals are
+// recognized, so a `#` character in them does not start a directive.
+void p_skip_inactive_lines( struct parse* parse ) {
+   char ch = parse->source->ch;
+   char prev_ch = '\0';
+   bool line_beginning = true;
+   while ( ch ) {
+      if ( ch == '\n' ) {
+         line_beginning = true;
+      }
+      else if ( ch == '#' && line_beginning ) {
+         break;
+      }
+      else if ( ch == '/' && peek_ch( parse ) == '/' ) {
+         while ( ch && ch != '\n' ) {
+            ch = read_ch( parse );
+         }
+         continue;
+      }
+      else if ( ch == '/' && peek_ch( parse ) == '*' ) {
+         read_ch( parse );
+         ch = read_ch( parse );
+         while ( ch && ! ( ch == '*' && peek_ch( parse ) == '/' ) ) {
+            ch = read_ch( parse );
+         }
+         if ( ! ch ) {
+            break;
+         }
+         ch = read_ch( parse );
+      }
+      // Like in active code, a string literal can span multiple lines.
+      else if ( ch == '"' ) {
+         ch = read_ch( parse );
+         while ( ch && ch != '"' ) {
+            if ( ch == '\\' ) {
+               ch = read_ch( parse );
+               if ( ! ch ) {
+                  break;
+               }
+            }
+            ch = read_ch( parse );
+         }
+         if ( ! ch ) {
+            break;
+         }
+         line_beginning = false;
+      }
+      // A single quote between digits is a digit separator.
+      else if ( ch == '\'' && ! isalnum( prev_ch ) ) {
+         ch = read_ch( parse );
+         if ( ch == '\\' ) {
+            ch = read_ch( parse );
+         }
+         if ( ! ch ) {
+            break;
+         }
+         if ( peek_ch( parse ) == '\'' ) {
+            ch = read_ch( parse );
+         }
+         line_beginning = false;
+      }
+      else if ( ch != ' ' && ch != '\t' ) {
+         line_beginning = false;
+      }
+      prev_ch = ch;
+      ch = read_ch( parse );
+   }
+}
+
 static char read_ch( struct parse* parse ) {
    struct source* source = parse->source;
    // Adjust the file position. The file position is adjusted based on the
@@ -1492,3 +1605,25 @@ void p_deinit_tk( struct parse* parse ) {
       }
    }
 }
+
+// Frees the memory used for reading tokens: the macros, the tokens, and the
+// buffers of the source files. Only the text of the tokens is kept, because the
+// syntax tree refers to it. Must be called after p_deinit_tk().
+void p_release_tk( struct parse* parse ) {
+   p_release_macros( parse );
+   p_release_stream( parse );
+   while ( parse->free_source ) {
+      struct source* prev = parse->free_source->prev;
+      mem_free( parse->free_source );
+      parse->free_source = prev;
+   }
+   while ( parse->source_entry_free ) {
+      struct source_entry* prev = parse->source_entry_free->prev;
+      mem_free( parse->source_entry_free );
+      parse->source_entry_free = prev;
+   }
+   str_deinit( &parse->temp_text );
+   str_init( &parse->temp_text );
+   str_deinit( &parse->token_presentation );
+   str_init( &parse->token_presentation );
+}
@@ -81,6 +81,7 @@ static void concat_tangible( struct parse* parse, struct macro_expan* expan,
    struct token* lside, struct token* rside );
 static enum tk concat_result( enum tk lside, enum tk rside );
 static struct token* push_token( struct parse* parse );
+static void alloc_token_chunk( struct parse* parse );
 static void free_token_list( struct parse* parse, struct token* head,
    struct token* tail );
 
@@ -89,6 +90,7 @@ void p_init_stream( struct parse* parse ) {
    parse->tk_text = "";
    parse->tk_length = 0;
    parse->token_free = NULL;
+   parse->token_chunks = NULL;
    parse->tkque_free_entry = NULL;
    parse->source_token = &parse->token_source;
    parse->tkque = NULL;
@@ -142,7 +144,10 @@ static void read_token( struct parse* parse, struct token* token ) {
       }
    }
    // Read from a source file.
+   int phase = t_enter_timing( parse->task, TIMING_LEX );
    p_read_source( parse, token );
+   t_leave_timing( parse->task, phase );
+   t_count( parse->task, COUNT_LEXED_TOKENS );
 }
 
 bool p_expand_macro( struct parse* parse ) {
@@ -462,9 +467,13 @@ static void expand_predef_macro( struct parse* parse,
       break;
    case PREDEFMACRO_TIME:
       expand_predef_time( parse, expan );
+      parse->task->compile_time_used = true;
+      p_break_pch_record( parse );
       break;
    case PREDEFMACRO_DATE:
       expand_predef_date( parse, expan );
+      parse->task->compile_time_used = true;
+      p_break_pch_record( parse );
       break;
    case PREDEFMACRO_IMPORTED:
    case PREDEFMACRO_INCLUDED:
@@ -999,16 +1008,29 @@ static struct token* push_token( struct parse* parse ) {
    return entry->token;
 }
 
+// Tokens are allocated in contiguous chunks rather than one at a time. Macro
+// bodies and expansions that are read together end up next to each other in
+// memory.
+static void alloc_token_chunk( struct parse* parse ) {
+   struct token_chunk* chunk = mem_alloc( sizeof( *chunk ) );
+   struct token* tokens = chunk->tokens;
+   for ( int i = 0; i < TOKEN_CHUNK_SIZE - 1; ++i ) {
+      tokens[ i ].next = &tokens[ i + 1 ];
+   }
+   tokens[ TOKEN_CHUNK_SIZE - 1 ].next = parse->token_free;
+   parse->token_free = tokens;
+   chunk->next = parse->token_chunks;
+   parse->token_chunks = chunk;
+}
+
 // NOTE: Does not initialize fields.
 struct token* p_alloc_token( struct parse* parse ) {
    struct token* token;
-   if ( parse->token_free ) {
-      token = parse->token_free;
-      parse->token_free = token->next;
-   }
-   else {
-      token = mem_alloc( sizeof( *token ) );
+   if ( ! parse->token_free ) {
+      alloc_token_chunk( parse );
    }
+   token = parse->token_free;
+   parse->token_free = token->next;
    token->next = NULL;
    return token;
 }
@@ -1034,3 +1056,30 @@ static void free_token_list( struct parse* parse, struct token* head,
       parse->token_free = head;
    }
 }
+
+// Frees the tokens and the pooled structures of the token stream. Must only be
+// called once reading is done: every token is released, including the ones
+// still in a queue.
+void p_release_stream( struct parse* parse ) {
+   while ( parse->token_chunks ) {
+      struct token_chunk* next = parse->token_chunks->next;
+      mem_free( parse->token_chunks );
+      parse->token_chunks = next;
+   }
+   parse->token_free = NULL;
+   while ( parse->macro_expan_free ) {
+      struct macro_expan* prev = parse->macro_expan_free->prev;
+      mem_free( parse->macro_expan_free );
+      parse->macro_expan_free = prev;
+   }
+   while ( parse->macro_arg_free ) {
+      struct macro_arg* next = parse->macro_arg_free->next;
+      mem_free( parse->macro_arg_free );
+      parse->macro_arg_free = next;
+   }
+   while ( parse->tkque_free_entry ) {
+      struct queue_entry* next = parse->tkque_free_entry->next;
+      mem_free( parse->tkque_free_entry );
+      parse->tkque_free_entry = next;
+   }
+}
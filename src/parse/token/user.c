@@ -5,6 +5,7 @@
 
 static void read_peeked_token( struct parse* parse );
 static void read_token( struct parse* parse );
+static void read_stream_token( struct parse* parse );
 static struct token* push_token( struct parse* parse );
 
 // Functions used by the parser.
@@ -15,7 +16,10 @@ static struct token* push_token( struct parse* parse );
 //  - Expand macros.
 //  - Execute directives.
 void p_read_tk( struct parse* parse ) {
+   int phase = t_enter_timing( parse->task, TIMING_PREPROCESS );
    read_peeked_token( parse );
+   t_leave_timing( parse->task, phase );
+   t_count( parse->task, COUNT_PARSED_TOKENS );
    struct token* token = parse->token;
    parse->tk = token->type;
    parse->tk_text = token->text;
@@ -33,10 +37,21 @@ static void read_peeked_token( struct parse* parse ) {
 }
 
 static void read_token( struct parse* parse ) {
+   read_stream_token( parse );
+   if ( parse->pch_record ) {
+      p_record_pch_token( parse );
+   }
+}
+
+static void read_stream_token( struct parse* parse ) {
    top:
+   if ( parse->pch_replay && p_read_pch_token( parse ) ) {
+      return;
+   }
    p_read_stream( parse );
    switch ( parse->token->type ) {
    case TK_ID:
+      p_break_include_guard( parse );
       if ( p_expand_macro( parse ) ) {
          goto top;
       }
@@ -50,6 +65,7 @@ static void read_token( struct parse* parse ) {
             goto top;
          }
       }
+      p_break_include_guard( parse );
       break;
    case TK_NL:
       if ( ! parse->create_nltk ) {
@@ -59,11 +75,14 @@ static void read_token( struct parse* parse ) {
    case TK_HORZSPACE:
       goto top;
    case TK_LIT_STRING:
+      p_break_include_guard( parse );
       goto string;
    case TK_PROCESSEDHASH:
+      p_break_include_guard( parse );
       parse->token->type = TK_HASH;
       break;
    default:
+      p_break_include_guard( parse );
       break;
    }
    return;
@@ -1353,9 +1353,16 @@ static bool test_scalar_initz( struct semantic* semantic,
       return false;
    }
    if ( test->constant && ! value->expr->folded ) {
-      s_diag( semantic, DIAG_POS_ERR, &value->expr->pos,
-         "non-constant initializer" );
-      s_bail( semantic );
+      // An initializer that calls user functions might still be constant. It
+      // is evaluated once the bodies of the functions have been tested.
+      if ( ! expr.has_str && s_has_user_call( value->expr ) ) {
+         zbcx_list_append( &semantic->deferred_initz, value );
+      }
+      else {
+         s_diag( semantic, DIAG_POS_ERR, &value->expr->pos,
+            "non-constant initializer" );
+         s_bail( semantic );
+      }
    }
    // Perform type checking when testing an initializer for a variable with
    // known type information.
@@ -1429,6 +1436,32 @@ static void initz_mismatch( struct semantic* semantic, struct initz_test* test,
       "element" : ( test->member ? "struct-member" : "variable" ), type, pos );
 }
 
+// Evaluates the initializers that call user functions. Such an initializer is
+// constant when the called functions have no side effects.
+void s_test_deferred_initz( struct semantic* semantic ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &semantic->deferred_initz, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct value* value = zbcx_list_data( &i );
+      // The same initializer can be deferred more than once.
+      if ( ! value->expr->folded ) {
+         struct evaluation evaluation;
+         if ( ! s_evaluate_expr( value->expr, &evaluation ) ) {
+            s_diag( semantic, DIAG_POS_ERR, &value->expr->pos,
+               "non-constant initializer" );
+            s_diag( semantic, DIAG_POS, evaluation.failure_pos,
+               "initializer cannot be evaluated at compile time: %s",
+               evaluation.failure );
+            s_bail( semantic );
+         }
+         value->expr->value = evaluation.value;
+         value->expr->folded = true;
+      }
+      zbcx_list_next( &i );
+   }
+   zbcx_list_deinit( &semantic->deferred_initz );
+}
+
 static bool test_string_initz( struct semantic* semantic, struct dim* dim,
    struct value* value ) {
    struct expr_test expr;
@@ -1855,6 +1888,12 @@ void s_test_local_var( struct semantic* semantic, struct var* var ) {
    if ( var->initial ) {
       s_calc_var_value_index( var );
    }
+   if ( var->storage == STORAGE_LOCAL && semantic->func_test->func &&
+      ( ! var->value || var->desc == DESC_ARRAY ||
+      var->desc == DESC_STRUCTVAR ) ) {
+      struct func_user* impl = semantic->func_test->func->impl;
+      impl->uninit_locals = true;
+   }
    if ( ! var->force_local_scope ) {
       zbcx_list_append( semantic->func_test->funcscope_vars, var );
    }
@@ -0,0 +1,796 @@
+#include <setjmp.h>
+
+#include "phase.h"
+
+// Compile-time evaluation
+// ==========================================================================
+// Evaluates an expression that calls user functions by interpreting the
+// checked syntax tree of the functions. Only a function without side effects
+// can be evaluated: it may use its parameters and its own local scalar
+// variables, but it must not read or write any other variable, call a
+// builtin function, or use strings or references. An evaluation that takes
+// too many steps is abandoned, so a function that does not terminate cannot
+// stall the compilation.
+
+enum {
+   STEP_LIMIT = 1000000,
+   DEPTH_LIMIT = 256,
+};
+
+struct slot {
+   struct node* object;
+   int value;
+};
+
+struct evaluator {
+   struct evaluation* evaluation;
+   struct slot* slots;
+   struct pos* call_pos;
+   int slot_count;
+   int slot_capacity;
+   int frame_start;
+   int steps;
+   int depth;
+   int return_value;
+   jmp_buf bail;
+};
+
+enum flow {
+   FLOW_NEXT,
+   FLOW_BREAK,
+   FLOW_CONTINUE,
+   FLOW_RETURN,
+};
+
+static bool has_user_call( struct node* node );
+static int eval_expr( struct evaluator* evaluator, struct expr* expr );
+static int eval_operand( struct evaluator* evaluator, struct node* node );
+static int eval_name_usage( struct evaluator* evaluator,
+   struct name_usage* usage );
+static int eval_unary( struct evaluator* evaluator, struct unary* unary );
+static int eval_binary( struct evaluator* evaluator, struct binary* binary );
+static int get_binary_op( int op, bool fixed );
+static int eval_logical( struct evaluator* evaluator,
+   struct logical* logical );
+static int eval_conditional( struct evaluator* evaluator,
+   struct conditional* cond );
+static int eval_assign( struct evaluator* evaluator, struct assign* assign );
+static int get_assign_op( int op, bool fixed );
+static int eval_inc( struct evaluator* evaluator, struct inc* inc );
+static int eval_conversion( struct evaluator* evaluator,
+   struct conversion* conv );
+static int eval_call( struct evaluator* evaluator, struct call* call );
+static void check_bool_spec( struct evaluator* evaluator, int spec );
+static struct slot* find_slot( struct evaluator* evaluator,
+   struct node* node );
+static struct slot* find_var_slot( struct evaluator* evaluator,
+   struct node* node );
+static void set_slot( struct evaluator* evaluator, struct node* object,
+   int value );
+static void push_slot( struct evaluator* evaluator, struct node* object,
+   int value );
+static enum flow exec_block( struct evaluator* evaluator,
+   struct block* block );
+static enum flow exec_stmt( struct evaluator* evaluator, struct node* node );
+static void exec_var( struct evaluator* evaluator, struct var* var );
+static bool eval_heavy_cond( struct evaluator* evaluator,
+   struct heavy_cond* cond );
+static bool eval_cond( struct evaluator* evaluator, struct cond* cond );
+static enum flow exec_if( struct evaluator* evaluator, struct if_stmt* stmt );
+static enum flow exec_switch( struct evaluator* evaluator,
+   struct switch_stmt* stmt );
+static enum flow exec_while( struct evaluator* evaluator,
+   struct while_stmt* stmt );
+static enum flow exec_do( struct evaluator* evaluator, struct do_stmt* stmt );
+static enum flow exec_for( struct evaluator* evaluator,
+   struct for_stmt* stmt );
+static enum flow exec_return( struct evaluator* evaluator,
+   struct return_stmt* stmt );
+static void step( struct evaluator* evaluator );
+static void fail( struct evaluator* evaluator, const char* reason );
+
+// Tells whether the expression calls a user function. Only such an
+// expression can become constant by being evaluated.
+bool s_has_user_call( struct expr* expr ) {
+   return has_user_call( expr->root );
+}
+
+static bool has_user_call( struct node* node ) {
+   switch ( node->type ) {
+   case NODE_CALL:
+      {
+         struct call* call = ( struct call* ) node;
+         return ( call->func && call->func->type == FUNC_USER );
+      }
+   case NODE_PAREN:
+      return has_user_call( ( ( struct paren* ) node )->inside );
+   case NODE_UNARY:
+      return has_user_call( ( ( struct unary* ) node )->operand );
+   case NODE_BINARY:
+      {
+         struct binary* binary = ( struct binary* ) node;
+         return ( has_user_call( binary->lside ) ||
+            has_user_call( binary->rside ) );
+      }
+   case NODE_LOGICAL:
+      {
+         struct logical* logical = ( struct logical* ) node;
+         return ( has_user_call( logical->lside ) ||
+            has_user_call( logical->rside ) );
+      }
+   case NODE_CONDITIONAL:
+      {
+         struct conditional* cond = ( struct conditional* ) node;
+         return ( has_user_call( cond->left ) ||
+            ( cond->middle && has_user_call( cond->middle ) ) ||
+            has_user_call( cond->right ) );
+      }
+   case NODE_CAST:
+      return has_user_call( ( ( struct cast* ) node )->operand );
+   case NODE_CONVERSION:
+      return s_has_user_call( ( ( struct conversion* ) node )->expr );
+   default:
+      return false;
+   }
+}
+
+bool s_evaluate_expr( struct expr* expr, struct evaluation* evaluation ) {
+   struct evaluator evaluator;
+   evaluator.evaluation = evaluation;
+   evaluator.slots = NULL;
+   evaluator.call_pos = &expr->pos;
+   evaluator.slot_count = 0;
+   evaluator.slot_capacity = 0;
+   evaluator.frame_start = 0;
+   evaluator.steps = 0;
+   evaluator.depth = 0;
+   evaluator.return_value = 0;
+   evaluation->value = 0;
+   evaluation->failure = NULL;
+   evaluation->failure_pos = NULL;
+   if ( setjmp( evaluator.bail ) == 0 ) {
+      evaluation->value = eval_expr( &evaluator, expr );
+   }
+   if ( evaluator.slots ) {
+      mem_free( evaluator.slots );
+   }
+   return ( evaluation->failure == NULL );
+}
+
+static int eval_expr( struct evaluator* evaluator, struct expr* expr ) {
+   if ( expr->folded ) {
+      if ( expr->has_str ) {
+         fail( evaluator, "string value" );
+      }
+      return expr->value;
+   }
+   return eval_operand( evaluator, expr->root );
+}
+
+static int eval_operand( struct evaluator* evaluator, struct node* node ) {
+   step( evaluator );
+   switch ( node->type ) {
+   case NODE_LITERAL:
+      return ( ( struct literal* ) node )->value;
+   case NODE_FIXED_LITERAL:
+      return ( ( struct fixed_literal* ) node )->value;
+   case NODE_BOOLEAN:
+      return ( ( struct boolean* ) node )->value;
+   case NODE_PAREN:
+      return eval_operand( evaluator, ( ( struct paren* ) node )->inside );
+   case NODE_CAST:
+      return eval_operand( evaluator, ( ( struct cast* ) node )->operand );
+   case NODE_NAME_USAGE:
+      return eval_name_usage( evaluator, ( struct name_usage* ) node );
+   case NODE_UNARY:
+      return eval_unary( evaluator, ( struct unary* ) node );
+   case NODE_BINARY:
+      return eval_binary( evaluator, ( struct binary* ) node );
+   case NODE_LOGICAL:
+      return eval_logical( evaluator, ( struct logical* ) node );
+   case NODE_CONDITIONAL:
+      return eval_conditional( evaluator, ( struct conditional* ) node );
+   case NODE_ASSIGN:
+      return eval_assign( evaluator, ( struct assign* ) node );
+   case NODE_INC:
+      return eval_inc( evaluator, ( struct inc* ) node );
+   case NODE_CONVERSION:
+      return eval_conversion( evaluator, ( struct conversion* ) node );
+   case NODE_CALL:
+      return eval_call( evaluator, ( struct call* ) node );
+   case NODE_INDEXED_STRING_USAGE:
+      fail( evaluator, "string value" );
+      return 0;
+   default:
+      fail( evaluator, "unsupported expression" );
+      return 0;
+   }
+}
+
+static int eval_name_usage( struct evaluator* evaluator,
+   struct name_usage* usage ) {
+   struct node* object = usage->object;
+   while ( object->type == NODE_ALIAS ) {
+      object = &( ( struct alias* ) object )->target->node;
+   }
+   switch ( object->type ) {
+   case NODE_CONSTANT:
+      {
+         struct constant* constant = ( struct constant* ) object;
+         if ( constant->has_str ) {
+            fail( evaluator, "string value" );
+         }
+         return constant->value;
+      }
+   case NODE_ENUMERATOR:
+      {
+         struct enumerator* enumerator = ( struct enumerator* ) object;
+         if ( enumerator->has_str ) {
+            fail( evaluator, "string value" );
+         }
+         return enumerator->value;
+      }
+   default:
+      return find_var_slot( evaluator, object )->value;
+   }
+}
+
+static int eval_unary( struct evaluator* evaluator, struct unary* unary ) {
+   int value = eval_operand( evaluator, unary->operand );
+   int op = FOLD_MINUS;
+   switch ( unary->op ) {
+   case UOP_MINUS:
+      break;
+   case UOP_PLUS:
+      return value;
+   case UOP_LOG_NOT:
+      check_bool_spec( evaluator, unary->operand_spec );
+      op = FOLD_LOG_NOT;
+      break;
+   case UOP_BIT_NOT:
+      op = FOLD_BIT_NOT;
+      break;
+   default:
+      fail( evaluator, "unsupported operator" );
+   }
+   t_fold_unary( op, value, &value );
+   return value;
+}
+
+static int eval_binary( struct evaluator* evaluator, struct binary* binary ) {
+   if ( binary->folded ) {
+      if ( binary->operand_type == BINARYOPERAND_PRIMITIVESTR ) {
+         fail( evaluator, "string value" );
+      }
+      return binary->value;
+   }
+   switch ( binary->operand_type ) {
+   case BINARYOPERAND_PRIMITIVERAW:
+   case BINARYOPERAND_PRIMITIVEINT:
+   case BINARYOPERAND_PRIMITIVEFIXED:
+   case BINARYOPERAND_PRIMITIVEBOOL:
+      break;
+   default:
+      fail( evaluator, "string or reference operand" );
+   }
+   int l = eval_operand( evaluator, binary->lside );
+   int r = eval_operand( evaluator, binary->rside );
+   int value = 0;
+   if ( ! t_fold_binary( get_binary_op( binary->op,
+      binary->operand_type == BINARYOPERAND_PRIMITIVEFIXED ), l, r,
+      &value ) ) {
+      fail( evaluator, "division by zero" );
+   }
+   return value;
+}
+
+static int get_binary_op( int op, bool fixed ) {
+   switch ( op ) {
+   case BOP_BIT_OR: return FOLD_BIT_OR;
+   case BOP_BIT_XOR: return FOLD_BIT_XOR;
+   case BOP_BIT_AND: return FOLD_BIT_AND;
+   case BOP_EQ: return FOLD_EQ;
+   case BOP_NEQ: return FOLD_NEQ;
+   case BOP_LT: return FOLD_LT;
+   case BOP_LTE: return FOLD_LTE;
+   case BOP_GT: return FOLD_GT;
+   case BOP_GTE: return FOLD_GTE;
+   case BOP_SHIFT_L: return FOLD_SHIFT_L;
+   case BOP_SHIFT_R: return FOLD_SHIFT_R;
+   case BOP_ADD: return FOLD_ADD;
+   case BOP_SUB: return FOLD_SUB;
+   case BOP_MUL: return fixed ? FOLD_FIXED_MUL : FOLD_MUL;
+   case BOP_DIV: return fixed ? FOLD_FIXED_DIV : FOLD_DIV;
+   case BOP_MOD: return FOLD_MOD;
+   default:
+      UNREACHABLE();
+      return FOLD_ADD;
+   }
+}
+
+static int eval_logical( struct evaluator* evaluator,
+   struct logical* logical ) {
+   if ( logical->folded ) {
+      return logical->value;
+   }
+   check_bool_spec( evaluator, logical->lside_spec );
+   check_bool_spec( evaluator, logical->rside_spec );
+   bool lside = ( eval_operand( evaluator, logical->lside ) != 0 );
+   if ( logical->op == LOP_OR ? lside : ! lside ) {
+      return lside;
+   }
+   return ( eval_operand( evaluator, logical->rside ) != 0 );
+}
+
+static int eval_conditional( struct evaluator* evaluator,
+   struct conditional* cond ) {
+   if ( cond->ref ) {
+      fail( evaluator, "reference value" );
+   }
+   check_bool_spec( evaluator, cond->left_spec );
+   int left = eval_operand( evaluator, cond->left );
+   if ( left ) {
+      return cond->middle ? eval_operand( evaluator, cond->middle ) : left;
+   }
+   return eval_operand( evaluator, cond->right );
+}
+
+static int eval_assign( struct evaluator* evaluator, struct assign* assign ) {
+   if ( assign->lside->type != NODE_NAME_USAGE ) {
+      fail( evaluator, "assignment to a non-local variable" );
+   }
+   // The right side is evaluated first, like with the instructions that
+   // update a variable. It can also call a function and so move the slots.
+   int value = eval_operand( evaluator, assign->rside );
+   struct name_usage* usage = ( struct name_usage* ) assign->lside;
+   struct slot* slot = find_var_slot( evaluator, usage->object );
+   if ( assign->op != AOP_NONE ) {
+      if ( assign->spec == SPEC_STR ) {
+         fail( evaluator, "string value" );
+      }
+      int result = 0;
+      if ( ! t_fold_binary( get_assign_op( assign->op,
+         assign->spec == SPEC_FIXED ), slot->value, value, &result ) ) {
+         fail( evaluator, "division by zero" );
+      }
+      value = result;
+   }
+   slot->value = value;
+   return value;
+}
+
+static int get_assign_op( int op, bool fixed ) {
+   switch ( op ) {
+   case AOP_ADD: return FOLD_ADD;
+   case AOP_SUB: return FOLD_SUB;
+   case AOP_MUL: return fixed ? FOLD_FIXED_MUL : FOLD_MUL;
+   case AOP_DIV: return fixed ? FOLD_FIXED_DIV : FOLD_DIV;
+   case AOP_MOD: return FOLD_MOD;
+   case AOP_SHIFT_L: return FOLD_SHIFT_L;
+   case AOP_SHIFT_R: return FOLD_SHIFT_R;
+   case AOP_BIT_AND: return FOLD_BIT_AND;
+   case AOP_BIT_XOR: return FOLD_BIT_XOR;
+   case AOP_BIT_OR: return FOLD_BIT_OR;
+   default:
+      UNREACHABLE();
+      return FOLD_ADD;
+   }
+}
+
+static int eval_inc( struct evaluator* evaluator, struct inc* inc ) {
+   if ( inc->operand->type != NODE_NAME_USAGE ) {
+      fail( evaluator, "assignment to a non-local variable" );
+   }
+   struct name_usage* usage = ( struct name_usage* ) inc->operand;
+   struct slot* slot = find_var_slot( evaluator, usage->object );
+   int prev_value = slot->value;
+   t_fold_binary( inc->dec ? FOLD_SUB : FOLD_ADD, slot->value,
+      inc->fixed ? 65536 : 1, &slot->value );
+   return inc->post ? prev_value : slot->value;
+}
+
+static int eval_conversion( struct evaluator* evaluator,
+   struct conversion* conv ) {
+   if ( conv->from_ref || conv->spec_from == SPEC_STR ) {
+      fail( evaluator, "string or reference operand" );
+   }
+   int value = eval_expr( evaluator, conv->expr );
+   switch ( conv->spec ) {
+   case SPEC_INT:
+      if ( conv->spec_from == SPEC_FIXED ) {
+         t_fold_binary( FOLD_DIV, value, 65536, &value );
+      }
+      return value;
+   case SPEC_FIXED:
+      if ( conv->spec_from != SPEC_FIXED ) {
+         t_fold_binary( FOLD_SHIFT_L, value, 16, &value );
+      }
+      return value;
+   case SPEC_BOOL:
+      return ( value != 0 );
+   default:
+      fail( evaluator, "string value" );
+      return 0;
+   }
+}
+
+static int eval_call( struct evaluator* evaluator, struct call* call ) {
+   struct func* func = call->func;
+   if ( ! func || func->type != FUNC_USER || call->ref_func ||
+      call->format_item ) {
+      fail( evaluator, "call to a builtin function or function reference" );
+   }
+   struct func_user* impl = func->impl;
+   if ( ! impl->body ) {
+      fail( evaluator, "body of function not available" );
+   }
+   if ( func->ref || func->return_spec == SPEC_STR ) {
+      fail( evaluator, "function returns a string or reference" );
+   }
+   if ( evaluator->depth == DEPTH_LIMIT ) {
+      fail( evaluator, "too many nested calls" );
+   }
+   // Evaluate the arguments in the frame of the caller, then bind them to the
+   // parameters in the frame of the callee. Until then, the arguments are not
+   // bound to any object, so the caller cannot see them.
+   int frame_start = evaluator->slot_count;
+   zbcx_ListIter i;
+   zbcx_list_iterate( &call->args, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      int value = eval_expr( evaluator, zbcx_list_data( &i ) );
+      push_slot( evaluator, NULL, value );
+      zbcx_list_next( &i );
+   }
+   struct param* param = func->params;
+   for ( int k = frame_start; k < evaluator->slot_count; ++k ) {
+      evaluator->slots[ k ].object = &param->object.node;
+      param = param->next;
+   }
+   struct pos* prev_call_pos = evaluator->call_pos;
+   int prev_frame_start = evaluator->frame_start;
+   evaluator->call_pos = &call->pos;
+   evaluator->frame_start = frame_start;
+   ++evaluator->depth;
+   while ( param ) {
+      int value = eval_expr( evaluator, param->default_value );
+      push_slot( evaluator, &param->object.node, value );
+      param = param->next;
+   }
+   evaluator->return_value = 0;
+   exec_block( evaluator, impl->body );
+   --evaluator->depth;
+   evaluator->frame_start = prev_frame_start;
+   evaluator->call_pos = prev_call_pos;
+   evaluator->slot_count = frame_start;
+   return evaluator->return_value;
+}
+
+static void check_bool_spec( struct evaluator* evaluator, int spec ) {
+   switch ( spec ) {
+   case SPEC_RAW:
+   case SPEC_INT:
+   case SPEC_FIXED:
+   case SPEC_BOOL:
+   case SPEC_ENUM:
+      break;
+   default:
+      fail( evaluator, "string or reference operand" );
+   }
+}
+
+static struct slot* find_slot( struct evaluator* evaluator,
+   struct node* object ) {
+   for ( int i = evaluator->slot_count - 1; i >= evaluator->frame_start;
+      --i ) {
+      if ( evaluator->slots[ i ].object == object ) {
+         return &evaluator->slots[ i ];
+      }
+   }
+   return NULL;
+}
+
+static struct slot* find_var_slot( struct evaluator* evaluator,
+   struct node* object ) {
+   struct slot* slot = find_slot( evaluator, object );
+   if ( ! slot ) {
+      fail( evaluator, "use of a variable that is not local to the "
+         "function" );
+   }
+   return slot;
+}
+
+static void set_slot( struct evaluator* evaluator, struct node* object,
+   int value ) {
+   struct slot* slot = find_slot( evaluator, object );
+   if ( slot ) {
+      slot->value = value;
+   }
+   else {
+      push_slot( evaluator, object, value );
+   }
+}
+
+static void push_slot( struct evaluator* evaluator, struct node* object,
+   int value ) {
+   if ( evaluator->slot_count == evaluator->slot_capacity ) {
+      evaluator->slot_capacity = evaluator->slot_capacity ?
+         evaluator->slot_capacity * 2 : 64;
+      evaluator->slots = mem_realloc( evaluator->slots,
+         sizeof( *evaluator->slots ) * evaluator->slot_capacity );
+   }
+   struct slot* slot = &evaluator->slots[ evaluator->slot_count ];
+   slot->object = object;
+   slot->value = value;
+   ++evaluator->slot_count;
+}
+
+static enum flow exec_block( struct evaluator* evaluator,
+   struct block* block ) {
+   step( evaluator );
+   zbcx_ListIter i;
+   zbcx_list_iterate( &block->stmts, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      enum flow flow = exec_stmt( evaluator, zbcx_list_data( &i ) );
+      if ( flow != FLOW_NEXT ) {
+         return flow;
+      }
+      zbcx_list_next( &i );
+   }
+   return FLOW_NEXT;
+}
+
+static enum flow exec_stmt( struct evaluator* evaluator, struct node* node ) {
+   step( evaluator );
+   switch ( node->type ) {
+   case NODE_BLOCK:
+      return exec_block( evaluator, ( struct block* ) node );
+   case NODE_VAR:
+      exec_var( evaluator, ( struct var* ) node );
+      return FLOW_NEXT;
+   case NODE_EXPR_STMT:
+      {
+         struct expr_stmt* stmt = ( struct expr_stmt* ) node;
+         zbcx_ListIter i;
+         zbcx_list_iterate( &stmt->expr_list, &i );
+         while ( ! zbcx_list_end( &i ) ) {
+            eval_expr( evaluator, zbcx_list_data( &i ) );
+            zbcx_list_next( &i );
+         }
+      }
+      return FLOW_NEXT;
+   case NODE_IF:
+      return exec_if( evaluator, ( struct if_stmt* ) node );
+   case NODE_SWITCH:
+      return exec_switch( evaluator, ( struct switch_stmt* ) node );
+   case NODE_WHILE:
+      return exec_while( evaluator, ( struct while_stmt* ) node );
+   case NODE_DO:
+      return exec_do( evaluator, ( struct do_stmt* ) node );
+   case NODE_FOR:
+      return exec_for( evaluator, ( struct for_stmt* ) node );
+   case NODE_JUMP:
+      return ( ( struct jump* ) node )->type == JUMP_BREAK ?
+         FLOW_BREAK : FLOW_CONTINUE;
+   case NODE_RETURN:
+      return exec_return( evaluator, ( struct return_stmt* ) node );
+   case NODE_ASSERT:
+      {
+         struct assert* assert = ( struct assert* ) node;
+         if ( ! assert->is_static && ! eval_expr( evaluator, assert->cond ) ) {
+            fail( evaluator, "assertion failure" );
+         }
+      }
+      return FLOW_NEXT;
+   case NODE_CASE:
+   case NODE_CASE_DEFAULT:
+   case NODE_GOTO_LABEL:
+   case NODE_ENUMERATION:
+   case NODE_STRUCTURE:
+   case NODE_TYPE_ALIAS:
+   case NODE_FUNC:
+   case NODE_USING:
+      return FLOW_NEXT;
+   default:
+      fail( evaluator, "unsupported statement" );
+      return FLOW_NEXT;
+   }
+}
+
+static void exec_var( struct evaluator* evaluator, struct var* var ) {
+   // A static variable keeps its value between calls, so it is not local to
+   // a single call. It can only be used if it is never read.
+   if ( var->storage != STORAGE_LOCAL ) {
+      return;
+   }
+   if ( var->desc != DESC_PRIMITIVEVAR ) {
+      fail( evaluator, "local array, structure, or reference variable" );
+   }
+   if ( var->value ) {
+      set_slot( evaluator, &var->object.node,
+         eval_expr( evaluator, var->value->expr ) );
+   }
+   else if ( ! find_slot( evaluator, &var->object.node ) ) {
+      set_slot( evaluator, &var->object.node, 0 );
+   }
+}
+
+static bool eval_heavy_cond( struct evaluator* evaluator,
+   struct heavy_cond* cond ) {
+   if ( cond->var ) {
+      exec_var( evaluator, cond->var );
+      if ( ! cond->expr ) {
+         check_bool_spec( evaluator, cond->var->spec );
+         return ( find_var_slot( evaluator,
+            &cond->var->object.node )->value != 0 );
+      }
+   }
+   check_bool_spec( evaluator, cond->expr->spec );
+   return ( eval_expr( evaluator, cond->expr ) != 0 );
+}
+
+static bool eval_cond( struct evaluator* evaluator, struct cond* cond ) {
+   if ( ! cond->u.node ) {
+      return true;
+   }
+   if ( cond->u.node->type == NODE_VAR ) {
+      exec_var( evaluator, cond->u.var );
+      check_bool_spec( evaluator, cond->u.var->spec );
+      return ( find_var_slot( evaluator,
+         &cond->u.var->object.node )->value != 0 );
+   }
+   check_bool_spec( evaluator, cond->u.expr->spec );
+   return ( eval_expr( evaluator, cond->u.expr ) != 0 );
+}
+
+static enum flow exec_if( struct evaluator* evaluator, struct if_stmt* stmt ) {
+   if ( eval_heavy_cond( evaluator, &stmt->cond ) ) {
+      return exec_stmt( evaluator, stmt->body );
+   }
+   else if ( stmt->else_body ) {
+      return exec_stmt( evaluator, stmt->else_body );
+   }
+   return FLOW_NEXT;
+}
+
+static enum flow exec_switch( struct evaluator* evaluator,
+   struct switch_stmt* stmt ) {
+   int value = 0;
+   if ( stmt->cond.var ) {
+      exec_var( evaluator, stmt->cond.var );
+   }
+   if ( stmt->cond.expr ) {
+      check_bool_spec( evaluator, stmt->cond.expr->spec );
+      value = eval_expr( evaluator, stmt->cond.expr );
+   }
+   else {
+      check_bool_spec( evaluator, stmt->cond.var->spec );
+      value = find_var_slot( evaluator, &stmt->cond.var->object.node )->value;
+   }
+   struct case_label* label = stmt->case_head;
+   while ( label && label->number->value != value ) {
+      label = label->next;
+   }
+   if ( ! label ) {
+      label = stmt->case_default;
+      if ( ! label ) {
+         return FLOW_NEXT;
+      }
+   }
+   // Execution continues at the matching label, which is expected to be one
+   // of the statements of the body.
+   if ( stmt->body->type != NODE_BLOCK ) {
+      fail( evaluator, "unsupported statement" );
+   }
+   struct block* body = ( struct block* ) stmt->body;
+   zbcx_ListIter i;
+   zbcx_list_iterate( &body->stmts, &i );
+   while ( ! zbcx_list_end( &i ) && zbcx_list_data( &i ) != &label->node ) {
+      zbcx_list_next( &i );
+   }
+   if ( zbcx_list_end( &i ) ) {
+      fail( evaluator, "unsupported statement" );
+   }
+   while ( ! zbcx_list_end( &i ) ) {
+      enum flow flow = exec_stmt( evaluator, zbcx_list_data( &i ) );
+      if ( flow == FLOW_BREAK ) {
+         break;
+      }
+      else if ( flow != FLOW_NEXT ) {
+         return flow;
+      }
+      zbcx_list_next( &i );
+   }
+   return FLOW_NEXT;
+}
+
+static enum flow exec_while( struct evaluator* evaluator,
+   struct while_stmt* stmt ) {
+   while ( eval_cond( evaluator, &stmt->cond ) != stmt->until ) {
+      enum flow flow = exec_block( evaluator, stmt->body );
+      if ( flow == FLOW_BREAK ) {
+         break;
+      }
+      else if ( flow == FLOW_RETURN ) {
+         return flow;
+      }
+   }
+   return FLOW_NEXT;
+}
+
+static enum flow exec_do( struct evaluator* evaluator, struct do_stmt* stmt ) {
+   while ( true ) {
+      enum flow flow = exec_block( evaluator, stmt->body );
+      if ( flow == FLOW_BREAK ) {
+         break;
+      }
+      else if ( flow == FLOW_RETURN ) {
+         return flow;
+      }
+      check_bool_spec( evaluator, stmt->cond->spec );
+      if ( ( eval_expr( evaluator, stmt->cond ) != 0 ) == stmt->until ) {
+         break;
+      }
+   }
+   return FLOW_NEXT;
+}
+
+static enum flow exec_for( struct evaluator* evaluator,
+   struct for_stmt* stmt ) {
+   zbcx_ListIter i;
+   zbcx_list_iterate( &stmt->init, &i );
+   while ( ! zbcx_list_end( &i ) ) {
+      struct node* node = zbcx_list_data( &i );
+      switch ( node->type ) {
+      case NODE_EXPR:
+         eval_expr( evaluator, ( struct expr* ) node );
+         break;
+      case NODE_VAR:
+         exec_var( evaluator, ( struct var* ) node );
+         break;
+      default:
+         break;
+      }
+      zbcx_list_next( &i );
+   }
+   while ( eval_cond( evaluator, &stmt->cond ) ) {
+      enum flow flow = exec_stmt( evaluator, stmt->body );
+      if ( flow == FLOW_BREAK ) {
+         break;
+      }
+      else if ( flow == FLOW_RETURN ) {
+         return flow;
+      }
+      zbcx_list_iterate( &stmt->post, &i );
+      while ( ! zbcx_list_end( &i ) ) {
+         struct node* node = zbcx_list_data( &i );
+         if ( node->type == NODE_EXPR ) {
+            eval_expr( evaluator, ( struct expr* ) node );
+         }
+         zbcx_list_next( &i );
+      }
+   }
+   return FLOW_NEXT;
+}
+
+static enum flow exec_return( struct evaluator* evaluator,
+   struct return_stmt* stmt ) {
+   if ( stmt->buildmsg ) {
+      fail( evaluator, "unsupported statement" );
+   }
+   evaluator->return_value = stmt->return_value ?
+      eval_expr( evaluator, stmt->return_value ) : 0;
+   return FLOW_RETURN;
+}
+
+static void step( struct evaluator* evaluator ) {
+   ++evaluator->steps;
+   if ( evaluator->steps > STEP_LIMIT ) {
+      fail( evaluator, "evaluation takes too many steps" );
+   }
+}
+
+static void fail( struct evaluator* evaluator, const char* reason ) {
+   evaluator->evaluation->failure = reason;
+   evaluator->evaluation->failure_pos = evaluator->call_pos;
+   longjmp( evaluator->bail, 1 );
+}
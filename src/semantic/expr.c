@@ -62,6 +62,7 @@ static void fold_bop_primitive( struct semantic* semantic,
    struct result* result );
 static void fold_bop_int( struct semantic* semantic, struct binary* binary,
    struct result* lside, struct result* rside );
+static int get_fold_op( int op );
 static void fold_bop_fixed( struct semantic* semantic, struct binary* binary,
    struct result* lside, struct result* rside );
 static void fold_bop_bool( struct semantic* semantic, struct binary* binary,
@@ -70,6 +71,10 @@ static void fold_bop_str( struct semantic* semantic, struct binary* binary,
    struct result* lside, struct result* rside );
 static void fold_bop_str_compare( struct semantic* semantic,
    struct binary* binary, struct result* lside, struct result* rside );
+static void fold_bop_str_concat( struct semantic* semantic,
+   struct binary* binary, struct result* lside, struct result* rside );
+static void uncount_string( struct node* node, struct indexed_string* string );
+static void uncount_string_operand( struct node* node );
 static void test_logical( struct semantic* semantic, struct expr_test* test,
    struct result* result, struct logical* logical );
 static bool perform_logical( struct semantic* semantic,
@@ -653,40 +658,49 @@ static void fold_bop_primitive( struct semantic* semantic,
 
 static void fold_bop_int( struct semantic* semantic, struct binary* binary,
    struct result* lside, struct result* rside ) {
-   int l = lside->value;
-   int r = rside->value;
    // Division and modulo get special treatment because of the possibility
    // of a division by zero.
-   if ( ( binary->op == BOP_DIV || binary->op == BOP_MOD ) && r == 0 ) {
+   if ( ( binary->op == BOP_DIV || binary->op == BOP_MOD ) &&
+      rside->value == 0 ) {
       s_diag( semantic, DIAG_POS_ERR, &binary->pos,
          "division by zero" );
       s_bail( semantic );
    }
-   switch ( binary->op ) {
-   case BOP_MOD: l %= r; break;
-   case BOP_MUL: l *= r; break;
-   case BOP_DIV: l /= r; break;
-   case BOP_ADD: l += r; break;
-   case BOP_SUB: l -= r; break;
-   case BOP_SHIFT_R: l >>= r; break;
-   case BOP_SHIFT_L: l <<= r; break;
-   case BOP_GTE: l = l >= r; break;
-   case BOP_GT: l = l > r; break;
-   case BOP_LTE: l = l <= r; break;
-   case BOP_LT: l = l < r; break;
-   case BOP_NEQ: l = l != r; break;
-   case BOP_EQ: l = l == r; break;
-   case BOP_BIT_AND: l = l & r; break;
-   case BOP_BIT_XOR: l = l ^ r; break;
-   case BOP_BIT_OR: l = l | r; break;
-   default: break;
+   int value = 0;
+   if ( t_fold_binary( get_fold_op( binary->op ), lside->value, rside->value,
+      &value ) ) {
+      binary->value = value;
+      binary->folded = true;
+   }
+}
+
+static int get_fold_op( int op ) {
+   switch ( op ) {
+   case BOP_MOD: return FOLD_MOD;
+   case BOP_MUL: return FOLD_MUL;
+   case BOP_DIV: return FOLD_DIV;
+   case BOP_ADD: return FOLD_ADD;
+   case BOP_SUB: return FOLD_SUB;
+   case BOP_SHIFT_R: return FOLD_SHIFT_R;
+   case BOP_SHIFT_L: return FOLD_SHIFT_L;
+   case BOP_GTE: return FOLD_GTE;
+   case BOP_GT: return FOLD_GT;
+   case BOP_LTE: return FOLD_LTE;
+   case BOP_LT: return FOLD_LT;
+   case BOP_NEQ: return FOLD_NEQ;
+   case BOP_EQ: return FOLD_EQ;
+   case BOP_BIT_AND: return FOLD_BIT_AND;
+   case BOP_BIT_XOR: return FOLD_BIT_XOR;
+   case BOP_BIT_OR: return FOLD_BIT_OR;
+   default:
+      UNREACHABLE();
+      return FOLD_ADD;
    }
-   binary->value = l;
-   binary->folded = true;
 }
 
 static void fold_bop_fixed( struct semantic* semantic, struct binary* binary,
    struct result* lside, struct result* rside ) {
+   int op = FOLD_ADD;
    switch ( binary->op ) {
    case BOP_EQ:
    case BOP_NEQ:
@@ -696,30 +710,22 @@ static void fold_bop_fixed( struct semantic* semantic, struct binary* binary,
    case BOP_GTE:
    case BOP_ADD:
    case BOP_SUB:
+      op = get_fold_op( binary->op );
       break;
-   case BOP_DIV:
    case BOP_MUL:
-      // TODO.
-      return;
+      op = FOLD_FIXED_MUL;
+      break;
+   case BOP_DIV:
+      op = FOLD_FIXED_DIV;
+      break;
    default:
       return;
    }
-   int l = lside->value;
-   int r = rside->value;
-   switch ( binary->op ) {
-   case BOP_EQ: l = ( l == r ); break;
-   case BOP_NEQ: l = ( l != r ); break;
-   case BOP_LT: l = ( l < r ); break;
-   case BOP_LTE: l = ( l <= r ); break;
-   case BOP_GT: l = ( l > r ); break;
-   case BOP_GTE: l = ( l >= r ); break;
-   case BOP_ADD: l += r; break;
-   case BOP_SUB: l -= r; break;
-   default:
-      break;
+   int value = 0;
+   if ( t_fold_binary( op, lside->value, rside->value, &value ) ) {
+      binary->value = value;
+      binary->folded = true;
    }
-   binary->value = l;
-   binary->folded = true;
 }
 
 static void fold_bop_bool( struct semantic* semantic, struct binary* binary,
@@ -754,6 +760,9 @@ static void fold_bop_str( struct semantic* semantic, struct binary* binary,
    case BOP_GTE:
       fold_bop_str_compare( semantic, binary, lside, rside );
       break;
+   case BOP_ADD:
+      fold_bop_str_concat( semantic, binary, lside, rside );
+      break;
    default:
       break;
    }
@@ -780,6 +789,55 @@ static void fold_bop_str_compare( struct semantic* semantic,
    binary->folded = true;
 }
 
+// The concatenation of two string constants is a new string constant, so no
+// string needs to be built at runtime.
+static void fold_bop_str_concat( struct semantic* semantic,
+   struct binary* binary, struct result* lside, struct result* rside ) {
+   struct indexed_string* lside_str =
+      t_lookup_string( semantic->task, lside->value );
+   struct indexed_string* rside_str =
+      t_lookup_string( semantic->task, rside->value );
+   if ( ! lside_str || ! rside_str ) {
+      return;
+   }
+   struct str str;
+   str_init( &str );
+   str_append_sub( &str, lside_str->value, lside_str->length );
+   str_append_sub( &str, rside_str->value, rside_str->length );
+   struct indexed_string* string = t_intern_string_copy( semantic->task,
+      str.value, str.length );
+   str_deinit( &str );
+   // The operands are no longer referenced by the code, the concatenation
+   // is.
+   if ( semantic->func_test && semantic->lib == semantic->main_lib ) {
+      uncount_string( binary->lside, lside_str );
+      uncount_string( binary->rside, rside_str );
+      ++string->usage;
+   }
+   binary->value = string->index;
+   binary->folded = true;
+}
+
+static void uncount_string( struct node* node, struct indexed_string* string ) {
+   while ( node->type == NODE_PAREN ) {
+      node = ( ( struct paren* ) node )->inside;
+   }
+   bool counted = false;
+   switch ( node->type ) {
+   case NODE_INDEXED_STRING_USAGE:
+      counted = true;
+      break;
+   case NODE_BINARY:
+      counted = ( ( struct binary* ) node )->folded;
+      break;
+   default:
+      break;
+   }
+   if ( counted && string->usage > 0 ) {
+      --string->usage;
+   }
+}
+
 static void test_logical( struct semantic* semantic, struct expr_test* test,
    struct result* result, struct logical* logical ) {
    struct result lside;
@@ -910,6 +968,20 @@ static void fold_logical_primitive( struct semantic* semantic,
    }
    logical->value = l;
    logical->folded = true;
+   // String operands are no longer referenced by the code.
+   if ( semantic->func_test && semantic->lib == semantic->main_lib ) {
+      uncount_string_operand( logical->lside );
+      uncount_string_operand( logical->rside );
+   }
+}
+
+static void uncount_string_operand( struct node* node ) {
+   while ( node->type == NODE_PAREN ) {
+      node = ( ( struct paren* ) node )->inside;
+   }
+   if ( node->type == NODE_INDEXED_STRING_USAGE ) {
+      uncount_string( node, ( ( struct indexed_string_usage* ) node )->string );
+   }
 }
 
 static void test_assign( struct semantic* semantic, struct expr_test* test,
@@ -1335,7 +1407,7 @@ static void fold_unary_primitive( struct semantic* semantic,
       case SPEC_INT:
       case SPEC_FIXED:
          // TODO: Warn on overflow and underflow.
-         result->value = ( - operand->value );
+         t_fold_unary( FOLD_MINUS, operand->value, &result->value );
          result->folded = true;
          break;
       default:
@@ -2528,6 +2600,9 @@ static void test_string( struct semantic* semantic, struct expr_test* test,
    result->complete = true;
    result->usable = true;
    test->has_str = true;
+   if ( semantic->func_test && semantic->lib == semantic->main_lib ) {
+      ++string->usage;
+   }
 }
 
 static void test_boolean( struct semantic* semantic, struct result* result,
@@ -117,6 +117,7 @@ void s_init( struct semantic* semantic, struct task* task ) {
    semantic->lang_limits = t_get_lang_limits();
    init_worldglobal_vars( semantic );
    s_init_type_info_scalar( &semantic->type_int, SPEC_INT );
+   zbcx_list_init( &semantic->deferred_initz );
    semantic->depth = 0;
    semantic->retest_nss = false;
    semantic->resolved_objects = false;
@@ -181,6 +182,7 @@ static void test_bcs( struct semantic* semantic ) {
    perform_usings( semantic );
    test_objects( semantic );
    test_objects_bodies( semantic );
+   s_test_deferred_initz( semantic );
    check_dup_scripts( semantic );
    assign_script_numbers( semantic );
    // TODO: Refactor this.
@@ -900,6 +902,7 @@ static void test_objects( struct semantic* semantic ) {
    while ( true ) {
       semantic->retest_nss = false;
       semantic->resolved_objects = false;
+      t_count( semantic->task, COUNT_SEMANTIC_PASSES );
       test_all( semantic );
       if ( semantic->retest_nss ) {
          // Continue resolving as long as something got resolved. If nothing
@@ -1386,6 +1389,7 @@ static void add_sweep_name( struct semantic* semantic, struct scope* scope,
 void s_diag( struct semantic* semantic, int flags, ... ) {
    va_list args;
    va_start( args, flags );
+   ++semantic->task->diag_count;
    semantic->task->options->diag(semantic->task->options->context, flags, &args);
    va_end( args );
 }
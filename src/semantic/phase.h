@@ -136,6 +136,7 @@ struct semantic {
    struct var* global_vars[ MAX_GLOBAL_VARS ];
    struct var* global_arrays[ MAX_GLOBAL_VARS ];
    struct type_info type_int;
+   zbcx_List deferred_initz;
    int depth;
    bool retest_nss;
    bool resolved_objects;
@@ -144,6 +145,12 @@ struct semantic {
    bool strong_type;
 };
 
+struct evaluation {
+   struct pos* failure_pos;
+   const char* failure;
+   int value;
+};
+
 void s_init( struct semantic* semantic, struct task* task );
 void s_test( struct semantic* semantic );
 void s_test_constant( struct semantic* semantic, struct constant* );
@@ -252,5 +259,8 @@ bool s_is_str( struct type_info* type );
 bool s_is_struct_ref( struct type_info* type );
 bool s_same_storageignored_type( struct type_info* a, struct type_info* b );
 void s_init_magic_id( struct magic_id* magic_id, int name );
+bool s_has_user_call( struct expr* expr );
+bool s_evaluate_expr( struct expr* expr, struct evaluation* evaluation );
+void s_test_deferred_initz( struct semantic* semantic );
 
 #endif
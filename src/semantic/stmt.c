@@ -86,6 +86,9 @@ static struct buildmsg* find_buildmsg( struct stmt_test* start,
 static void test_expr_stmt( struct semantic* semantic,
    struct expr_stmt* stmt );
 static void check_dup_label( struct semantic* semantic );
+static void find_tail_call_stmt( struct semantic* semantic,
+   struct node* node );
+static void find_tail_call( struct semantic* semantic, struct expr* expr );
 static void test_goto_in_msgbuild_block( struct semantic* semantic );
 
 void s_init_stmt_test( struct stmt_test* test, struct stmt_test* parent ) {
@@ -123,6 +126,11 @@ void s_test_func_block( struct semantic* semantic, struct func* func,
    if ( func->return_spec == SPEC_AUTO ) {
       func->return_spec = SPEC_VOID;
    }
+   // A call at the end of a function that returns nothing.
+   if ( func->return_spec == SPEC_VOID && ! func->ref &&
+      zbcx_list_size( &block->stmts ) > 0 ) {
+      find_tail_call_stmt( semantic, zbcx_list_tail( &block->stmts ) );
+   }
    if ( func->return_spec != SPEC_VOID && test.flow != FLOW_DEAD ) {
       s_diag( semantic, DIAG_POS_ERR, &func->object.pos,
          "function missing return statement" );
@@ -138,10 +146,18 @@ static void test_block( struct semantic* semantic, struct stmt_test* test,
    if ( builtin_aliases ) {
       bind_builtin_aliases( semantic, builtin_aliases );
    }
+   struct node* prev_node = NULL;
    zbcx_ListIter i;
    zbcx_list_iterate( &block->stmts, &i );
    while ( ! zbcx_list_end( &i ) ) {
-      test_block_item( semantic, test, zbcx_list_data( &i ) );
+      struct node* node = zbcx_list_data( &i );
+      test_block_item( semantic, test, node );
+      // A call followed by a return statement with no value.
+      if ( node->type == NODE_RETURN &&
+         ! ( ( struct return_stmt* ) node )->return_value && prev_node ) {
+         find_tail_call_stmt( semantic, prev_node );
+      }
+      prev_node = node;
       zbcx_list_next( &i );
    }
    if ( ! test->manual_scope ) {
@@ -979,6 +995,49 @@ static void test_return_value( struct semantic* semantic,
          expr.structure_member->addr_taken = true;
       }
    }
+   if ( ! stmt->buildmsg ) {
+      find_tail_call( semantic, stmt->return_value );
+   }
+}
+
+static void find_tail_call_stmt( struct semantic* semantic,
+   struct node* node ) {
+   if ( node->type == NODE_BLOCK ) {
+      struct block* block = ( struct block* ) node;
+      if ( zbcx_list_size( &block->stmts ) > 0 ) {
+         find_tail_call_stmt( semantic, zbcx_list_tail( &block->stmts ) );
+      }
+   }
+   else if ( node->type == NODE_IF ) {
+      struct if_stmt* stmt = ( struct if_stmt* ) node;
+      find_tail_call_stmt( semantic, stmt->body );
+      if ( stmt->else_body ) {
+         find_tail_call_stmt( semantic, stmt->else_body );
+      }
+   }
+   else if ( node->type == NODE_EXPR_STMT ) {
+      struct expr_stmt* stmt = ( struct expr_stmt* ) node;
+      if ( zbcx_list_size( &stmt->expr_list ) == 1 ) {
+         find_tail_call( semantic, zbcx_list_head( &stmt->expr_list ) );
+      }
+   }
+}
+
+// Marks a call to the function being tested when nothing remains to be done
+// by the function after the call. The code generator can then restart the
+// function instead of calling it again.
+static void find_tail_call( struct semantic* semantic, struct expr* expr ) {
+   struct node* node = expr->root;
+   while ( node->type == NODE_PAREN ) {
+      node = ( ( struct paren* ) node )->inside;
+   }
+   struct func* func = semantic->func_test->func;
+   if ( node->type == NODE_CALL && func && ! func->ref ) {
+      struct call* call = ( struct call* ) node;
+      if ( call->func == func && ! call->ref_func ) {
+         call->tail = true;
+      }
+   }
 }
 
 static void test_goto( struct semantic* semantic, struct stmt_test* test,
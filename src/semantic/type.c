@@ -186,8 +186,14 @@ bool s_same_type( struct type_info* a, struct type_info* b ) {
    }
 }
 
+// The remainder of a reference chain is often shared: an implicit reference is
+// a copy of the first reference only, and the types of a declaration share its
+// chain. So two chains are the same once they meet.
 static bool same_ref( struct ref* a, struct ref* b ) {
    while ( a && b ) {
+      if ( a == b ) {
+         return true;
+      }
       if ( ! ( a->type == b->type ) ) {
          return false;
       }
@@ -228,6 +234,9 @@ static bool same_ref_array( struct ref_array* a, struct ref_array* b ) {
 }
 
 static bool same_ref_func( struct ref_func* a, struct ref_func* b ) {
+   if ( a->params == b->params ) {
+      return ( a->local == b->local );
+   }
    struct param* param_a = a->params;
    struct param* param_b = b->params;
    while ( param_a && param_b &&
@@ -268,11 +277,11 @@ static bool compatible_raw_spec( int spec ) {
 }
 
 static bool same_dim( struct dim* a, struct dim* b ) {
-   while ( a && b && a->length == b->length ) {
+   while ( a && b && a != b && a->length == b->length ) {
       a = a->next;
       b = b->next;
    }
-   return ( a == NULL && b == NULL );
+   return ( a == b );
 }
 
 bool s_common_type( struct type_info* a, struct type_info* b,
@@ -38,7 +38,9 @@ static const char* decode_filename( struct task* task,
 static struct file_entry* add_file( struct task* task,
    struct file_query* query );
 static struct file_entry* create_file_entry( struct task* task,
-   struct file_query* query );
+   struct file_query* query, struct str* full_path );
+static bool read_full_path( const zbcx_Options* options, const char* path,
+   struct str* str );
 static void link_file_entry( struct task* task, struct file_entry* entry );
 static struct indexed_string* intern_string( struct task* task,
    struct str_table* table, const char* value, int length, bool copy_value );
@@ -58,6 +60,9 @@ void t_init( struct task* task, const zbcx_Options* options, jmp_buf* bail) {
    zbcx_list_init( &task->namespaces );
    task->last_id = 0;
    task->compile_time = time( NULL );
+   task->diag_count = 0;
+   task->compile_time_used = false;
+   t_init_timings( task );
    gbuf_init( &task->growing_buffer );
    zbcx_list_init( &task->runtime_asserts );
    task->root_name = t_create_name();
@@ -142,6 +147,7 @@ struct ns* t_alloc_ns( struct name* name ) {
    ns->body_enums = t_extend_name( name, ".!e." );
    ns->links = NULL;
    zbcx_list_init( &ns->fragments );
+   ns->builtin_task = NULL;
    ns->hidden = false;
    return ns;
 }
@@ -179,6 +185,8 @@ static void init_str_table( struct str_table* table ) {
    table->head = NULL;
    table->tail = NULL;
    table->root = NULL;
+   table->entries = NULL;
+   table->capacity = 0;
    table->size = 0;
 }
 
@@ -193,6 +201,7 @@ struct name* t_create_name( void ) {
 }
 
 struct name* t_extend_name( struct name* parent, const char* extension ) {
+   struct name* start = parent;
    struct name* name = parent->drop;
    const char* ch = extension;
    while ( *ch ) {
@@ -233,6 +242,13 @@ struct name* t_extend_name( struct name* parent, const char* extension ) {
       name = name->drop;
       ++ch;
    }
+   // A name directly in the body of the upmost namespace might be the name of
+   // a builtin function that has not been looked up yet.
+   if ( ! parent->object && start->ch == '.' && start->parent &&
+      start->parent->ch == '\0' && start->parent->object ) {
+      t_bind_builtin( ( struct ns* ) start->parent->object, parent,
+         extension );
+   }
    return parent;
 }
 
@@ -335,6 +351,7 @@ struct include_history_entry* t_alloc_include_history_entry(
 void t_diag( struct task* task, int flags, ... ) {
    va_list args;
    va_start( args, flags );
+   ++task->diag_count;
    task->options->diag(task->options->context, flags, &args);
    va_end( args );
 }
@@ -606,9 +623,22 @@ void t_find_file( struct task* task, struct file_query* query ) {
    str_deinit( &path );
 }
 
+// The same file can be reached through different paths, so files are
+// identified by their full path.
 static struct file_entry* add_file( struct task* task, struct file_query* query ) {
-   struct file_entry* entry = task->file_entries;
-   return create_file_entry( task, query );
+   struct str full_path;
+   str_init( &full_path );
+   if ( read_full_path( task->options, query->path->value, &full_path ) ) {
+      struct file_entry* entry = task->file_entries;
+      while ( entry ) {
+         if ( entry->full_path.value &&
+            strcmp( entry->full_path.value, full_path.value ) == 0 ) {
+            return entry;
+         }
+         entry = entry->next;
+      }
+   }
+   return create_file_entry( task, query, &full_path );
 }
 
 static bool read_full_path(
@@ -629,13 +659,14 @@ static bool read_full_path(
 }
 
 static struct file_entry* create_file_entry( struct task* task,
-   struct file_query* query ) {
+   struct file_query* query, struct str* full_path ) {
    struct file_entry* entry = mem_alloc( sizeof( *entry ) );
    entry->next = NULL;
    str_init( &entry->path );
    str_append( &entry->path, query->path->value );
-   str_init( &entry->full_path );
-   read_full_path(task->options, query->path->value, &entry->full_path);
+   entry->full_path = *full_path;
+   entry->guard_macro = NULL;
+   entry->once = false;
    entry->id = task->last_id;
    ++task->last_id;
    link_file_entry( task, entry );
@@ -762,6 +793,7 @@ static struct indexed_string* intern_string( struct task* task,
    string->length = length;
    string->index = table->size;
    string->index_runtime = -1;
+   string->usage = 0;
    string->next = NULL;
    string->left = NULL;
    string->right = NULL;
@@ -783,6 +815,12 @@ static struct indexed_string* intern_string( struct task* task,
    else {
       table->root = string;
    }
+   if ( table->size == table->capacity ) {
+      table->capacity = table->capacity ? table->capacity * 2 : 256;
+      table->entries = mem_realloc( table->entries,
+         sizeof( table->entries[ 0 ] ) * table->capacity );
+   }
+   table->entries[ table->size ] = string;
    ++table->size;
    return string;
 }
@@ -799,14 +837,15 @@ struct indexed_string* t_intern_script_name( struct task* task,
 }
 
 struct indexed_string* t_lookup_string( struct task* task, int index ) {
-   struct str_table* table = index / STRTABLE_MAXSIZE ==
-      STRTABLE_SCRIPTNAME ? &task->script_name_table : &task->str_table;
-   struct indexed_string* string = table->head;
-   while ( string ) {
-      if ( string->index == index ) {
-         return string;
-      }
-      string = string->next;
+   struct str_table* table = &task->str_table;
+   int position = index;
+   if ( index / STRTABLE_MAXSIZE == STRTABLE_SCRIPTNAME ) {
+      table = &task->script_name_table;
+      position -= STRTABLE_SCRIPTNAME * STRTABLE_MAXSIZE;
+   }
+   if ( position >= 0 && position < table->size &&
+      table->entries[ position ]->index == index ) {
+      return table->entries[ position ];
    }
    return NULL;
 }
@@ -996,6 +1035,7 @@ struct func_user* t_alloc_func_user( void ) {
    impl->recursive = RECURSIVE_UNDETERMINED;
    impl->nested = false;
    impl->local = false;
+   impl->uninit_locals = false;
    return impl;
 }
 
@@ -1038,6 +1078,7 @@ struct call* t_alloc_call( void ) {
    call->format_item = NULL;
    zbcx_list_init( &call->args );
    call->constant = false;
+   call->tail = false;
    return call;
 }
 
@@ -1062,14 +1103,14 @@ const char* t_get_storage_name( int storage ) {
 }
 
 struct literal* t_alloc_literal( void ) {
-   struct literal* literal = mem_slot_alloc( sizeof( *literal ) );
+   struct literal* literal = mem_arena_alloc( sizeof( *literal ) );
    literal->node.type = NODE_LITERAL;
    literal->value = 0;
    return literal;
 }
 
 struct expr* t_alloc_expr( void ) {
-   struct expr* expr = mem_slot_alloc( sizeof( *expr ) );
+   struct expr* expr = mem_arena_alloc( sizeof( *expr ) );
    expr->node.type = NODE_EXPR;
    expr->root = NULL;
    expr->spec = SPEC_NONE;
@@ -1080,7 +1121,7 @@ struct expr* t_alloc_expr( void ) {
 }
 
 struct indexed_string_usage* t_alloc_indexed_string_usage( void ) {
-   struct indexed_string_usage* usage = mem_slot_alloc( sizeof( *usage ) );
+   struct indexed_string_usage* usage = mem_arena_alloc( sizeof( *usage ) );
    usage->node.type = NODE_INDEXED_STRING_USAGE;
    usage->string = NULL;
    return usage;
@@ -16,7 +16,13 @@ struct file_entry {
    struct file_entry* next;
    struct str path;
    struct str full_path;
+   // Macro that controls the include guard of the file, when the whole file is
+   // enclosed in an #ifndef directive. Once the macro is defined, including the
+   // file again has no effect.
+   const char* guard_macro;
    int id;
+   // Set by `#pragma once`.
+   bool once;
 };
 
 struct file_query {
@@ -473,6 +479,9 @@ struct call {
    struct format_item* format_item;
    zbcx_List args;
    bool constant;
+   // The call is the last action of the function that calls itself, so the
+   // function can be restarted instead of called again.
+   bool tail;
 };
 
 struct nested_call {
@@ -903,6 +912,9 @@ struct func_user {
    } recursive;
    bool nested;
    bool local;
+   // The function has local variables that rely on being zeroed when the
+   // function is called.
+   bool uninit_locals;
 };
 
 struct func_intern {
@@ -1048,6 +1060,10 @@ struct indexed_string {
    int length;
    int index;
    int index_runtime;
+   // Number of times the string is referenced in the code of the main
+   // library. Used to order the string table, and then counted again by the
+   // code generator to find the strings that are never referenced.
+   int usage;
    bool used;
    bool in_source_code;
 };
@@ -1061,6 +1077,9 @@ struct str_table {
    struct indexed_string* head;
    struct indexed_string* tail;
    struct indexed_string* root;
+   // Strings in the order they were interned, for lookup by index.
+   struct indexed_string** entries;
+   int capacity;
    int size;
 };
 
@@ -1117,6 +1136,9 @@ struct ns {
    struct name* body_enums;
    struct ns_link* links;
    zbcx_List fragments;
+   // Set only for the upmost namespace, whose builtin functions are bound to
+   // their names when the names are first looked up.
+   struct task* builtin_task;
    bool hidden;
 };
 
@@ -1234,6 +1256,73 @@ struct lang_limits {
    int max_id_length;
 };
 
+// Phases of the compilation that are timed separately. The time spent in a
+// nested phase, such as reading tokens while parsing, is not counted in the
+// enclosing phase.
+enum {
+   TIMING_OTHER,
+   TIMING_LEX,
+   TIMING_PREPROCESS,
+   TIMING_PARSE,
+   TIMING_IMPORT,
+   TIMING_CACHE,
+   TIMING_SEMANTIC,
+   TIMING_CODEGEN,
+   TIMING_CHUNKS,
+   TIMING_FLUSH,
+   TIMING_TOTAL
+};
+
+enum {
+   COUNT_LEXED_TOKENS,
+   COUNT_PARSED_TOKENS,
+   COUNT_SEMANTIC_PASSES,
+   COUNT_LIBRARY_HITS,
+   COUNT_LIBRARY_MISSES,
+   COUNT_PCH_HITS,
+   COUNT_PCH_MISSES,
+   COUNT_OBJECT_HITS,
+   COUNT_OBJECT_MISSES,
+   COUNT_TOTAL
+};
+
+// Operations of the constant-folding engine. Folding is done the way the game
+// engine evaluates the corresponding instruction, so the value of a folded
+// expression is the same as the value computed at runtime.
+enum {
+   FOLD_ADD,
+   FOLD_SUB,
+   FOLD_MUL,
+   FOLD_DIV,
+   FOLD_MOD,
+   FOLD_SHIFT_L,
+   FOLD_SHIFT_R,
+   FOLD_BIT_AND,
+   FOLD_BIT_XOR,
+   FOLD_BIT_OR,
+   FOLD_EQ,
+   FOLD_NEQ,
+   FOLD_LT,
+   FOLD_LTE,
+   FOLD_GT,
+   FOLD_GTE,
+   FOLD_LOG_AND,
+   FOLD_LOG_OR,
+   FOLD_FIXED_MUL,
+   FOLD_FIXED_DIV,
+   FOLD_MINUS,
+   FOLD_LOG_NOT,
+   FOLD_BIT_NOT
+};
+
+struct timings {
+   u64 times[ TIMING_TOTAL ];
+   int counts[ COUNT_TOTAL ];
+   u64 start;
+   u64 phase_start;
+   int phase;
+};
+
 struct task {
    const zbcx_Options* options;
    FILE* err_file;
@@ -1268,6 +1357,11 @@ struct task {
    // All structs found during compilation, including local structs and structs
    // in imported libraries.
    zbcx_List structures;
+   int diag_count;
+   // Set when __TIME__ or __DATE__ is expanded.
+   bool compile_time_used;
+   // Null unless the `timings` option is set.
+   struct timings* timings;
 };
 
 #define DIAG_NONE 0
@@ -1331,6 +1425,12 @@ const char* t_get_storage_name( int storage );
 struct literal* t_alloc_literal( void );
 struct expr* t_alloc_expr( void );
 void t_create_builtins( struct task* task );
+void t_bind_builtin( struct ns* ns, struct name* name, const char* text );
+void t_init_timings( struct task* task );
+int t_enter_timing( struct task* task, int phase );
+void t_leave_timing( struct task* task, int prev_phase );
+void t_count( struct task* task, int counter );
+void t_report_timings( struct task* task );
 struct indexed_string_usage* t_alloc_indexed_string_usage( void );
 void t_init_pos( struct pos* pos, int id, int line, int column );
 void t_init_pos_id( struct pos* pos, int id );
@@ -1347,5 +1447,7 @@ struct include_history_entry* t_alloc_include_history_entry(
 struct include_history_entry* t_decode_include_history_entry(
    struct task* task, int id );
 struct script* t_alloc_script( void );
+bool t_fold_binary( int op, int l, int r, int* result );
+bool t_fold_unary( int op, int operand, int* result );
 
 #endif
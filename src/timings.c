@@ -0,0 +1,178 @@
+#include <stdio.h>
+
+#include "task.h"
+
+// Timings
+// ==========================================================================
+// The time of a phase is measured from when the phase is entered to when
+// another phase is entered, so the times of all phases add up to the time of
+// the whole compilation.
+
+static void report_text( struct task* task, struct mem_stats* stats,
+   u64 total );
+static void report_json( struct task* task, struct mem_stats* stats,
+   u64 total );
+static void append_ms( struct str* str, u64 time );
+static void append_hits( struct str* str, const char* name, int hits,
+   int misses );
+
+static const char* g_phase_names[] = {
+   "other",
+   "lex",
+   "preprocess",
+   "parse",
+   "import",
+   "cache",
+   "semantic",
+   "codegen",
+   "chunks",
+   "flush",
+};
+
+STATIC_ASSERT( ARRAY_SIZE( g_phase_names ) == TIMING_TOTAL,
+   phase_names_not_equal_phases );
+
+void t_init_timings( struct task* task ) {
+   task->timings = NULL;
+   if ( task->options->timings != zbcx_timings_none ) {
+      struct timings* timings = mem_alloc( sizeof( *timings ) );
+      for ( int i = 0; i < TIMING_TOTAL; ++i ) {
+         timings->times[ i ] = 0;
+      }
+      for ( int i = 0; i < COUNT_TOTAL; ++i ) {
+         timings->counts[ i ] = 0;
+      }
+      timings->start = c_get_time_ns();
+      timings->phase_start = timings->start;
+      timings->phase = TIMING_OTHER;
+      task->timings = timings;
+   }
+}
+
+// Returns the phase that was being timed, to be passed to t_leave_timing().
+int t_enter_timing( struct task* task, int phase ) {
+   struct timings* timings = task->timings;
+   if ( ! timings ) {
+      return TIMING_OTHER;
+   }
+   int prev_phase = timings->phase;
+   if ( phase != prev_phase ) {
+      u64 now = c_get_time_ns();
+      timings->times[ prev_phase ] += now - timings->phase_start;
+      timings->phase_start = now;
+      timings->phase = phase;
+   }
+   return prev_phase;
+}
+
+void t_leave_timing( struct task* task, int prev_phase ) {
+   t_enter_timing( task, prev_phase );
+}
+
+void t_count( struct task* task, int counter ) {
+   if ( task->timings ) {
+      ++task->timings->counts[ counter ];
+   }
+}
+
+void t_report_timings( struct task* task ) {
+   struct timings* timings = task->timings;
+   if ( ! timings ) {
+      return;
+   }
+   t_enter_timing( task, TIMING_OTHER );
+   u64 total = c_get_time_ns() - timings->start;
+   timings->times[ TIMING_OTHER ] += total -
+      ( timings->phase_start - timings->start );
+   timings->phase_start = timings->start + total;
+   struct mem_stats stats;
+   mem_get_stats( &stats );
+   if ( task->options->timings == zbcx_timings_json ) {
+      report_json( task, &stats, total );
+   }
+   else {
+      report_text( task, &stats, total );
+   }
+}
+
+static void report_text( struct task* task, struct mem_stats* stats,
+   u64 total ) {
+   struct timings* timings = task->timings;
+   struct str str;
+   str_init( &str );
+   str_append( &str, "timings:" );
+   for ( int i = 0; i < TIMING_TOTAL; ++i ) {
+      str_append_format( &str, "\n  %-12s", g_phase_names[ i ] );
+      append_ms( &str, timings->times[ i ] );
+      str_append( &str, " ms" );
+   }
+   str_append_format( &str, "\n  %-12s", "total" );
+   append_ms( &str, total );
+   str_append( &str, " ms" );
+   str_append_format( &str, "\n  tokens: %d lexed, %d parsed",
+      timings->counts[ COUNT_LEXED_TOKENS ],
+      timings->counts[ COUNT_PARSED_TOKENS ] );
+   str_append_format( &str, "\n  semantic passes: %d",
+      timings->counts[ COUNT_SEMANTIC_PASSES ] );
+   str_append_format( &str, "\n  memory: %llu bytes allocated, %llu bytes "
+      "peak", ( unsigned long long ) stats->allocated,
+      ( unsigned long long ) stats->peak );
+   str_append( &str, "\n  cache hits:" );
+   append_hits( &str, "libraries", timings->counts[ COUNT_LIBRARY_HITS ],
+      timings->counts[ COUNT_LIBRARY_MISSES ] );
+   str_append( &str, "," );
+   append_hits( &str, "pch", timings->counts[ COUNT_PCH_HITS ],
+      timings->counts[ COUNT_PCH_MISSES ] );
+   str_append( &str, "," );
+   append_hits( &str, "object", timings->counts[ COUNT_OBJECT_HITS ],
+      timings->counts[ COUNT_OBJECT_MISSES ] );
+   t_diag( task, DIAG_NONE, "%s", str.value );
+   str_deinit( &str );
+}
+
+static void append_ms( struct str* str, u64 time ) {
+   str_append_format( str, "%10llu.%03llu",
+      ( unsigned long long ) ( time / 1000000 ),
+      ( unsigned long long ) ( time / 1000 % 1000 ) );
+}
+
+static void append_hits( struct str* str, const char* name, int hits,
+   int misses ) {
+   str_append_format( str, " %s %d/%d", name, hits, hits + misses );
+}
+
+// Times are in microseconds.
+static void report_json( struct task* task, struct mem_stats* stats,
+   u64 total ) {
+   struct timings* timings = task->timings;
+   struct str str;
+   str_init( &str );
+   str_append( &str, "{\"phases_us\":{" );
+   for ( int i = 0; i < TIMING_TOTAL; ++i ) {
+      str_append_format( &str, "%s\"%s\":%llu", i > 0 ? "," : "",
+         g_phase_names[ i ],
+         ( unsigned long long ) ( timings->times[ i ] / 1000 ) );
+   }
+   str_append_format( &str, "},\"total_us\":%llu",
+      ( unsigned long long ) ( total / 1000 ) );
+   str_append_format( &str, ",\"tokens\":{\"lexed\":%d,\"parsed\":%d}",
+      timings->counts[ COUNT_LEXED_TOKENS ],
+      timings->counts[ COUNT_PARSED_TOKENS ] );
+   str_append_format( &str, ",\"semantic_passes\":%d",
+      timings->counts[ COUNT_SEMANTIC_PASSES ] );
+   str_append_format( &str, ",\"memory\":{\"allocated\":%llu,\"peak\":%llu}",
+      ( unsigned long long ) stats->allocated,
+      ( unsigned long long ) stats->peak );
+   str_append_format( &str, ",\"cache\":{"
+      "\"library_hits\":%d,\"library_misses\":%d,"
+      "\"pch_hits\":%d,\"pch_misses\":%d,"
+      "\"object_hits\":%d,\"object_misses\":%d}}",
+      timings->counts[ COUNT_LIBRARY_HITS ],
+      timings->counts[ COUNT_LIBRARY_MISSES ],
+      timings->counts[ COUNT_PCH_HITS ],
+      timings->counts[ COUNT_PCH_MISSES ],
+      timings->counts[ COUNT_OBJECT_HITS ],
+      timings->counts[ COUNT_OBJECT_MISSES ] );
+   t_diag( task, DIAG_NONE, "%s", str.value );
+   str_deinit( &str );
+}
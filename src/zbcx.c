@@ -84,21 +84,75 @@ static void clear_cache(struct task* task, struct cache* cache) {
 }
 
 static void preprocess(struct task* task) {
+	int phase = t_enter_timing(task, TIMING_PREPROCESS);
 	struct parse parse;
 	p_init(&parse, task, NULL);
 	p_run(&parse);
+	t_leave_timing(task, phase);
+}
+
+// Writes the object kept from a previous compilation in the session. The
+// statistics are only shown by compiling the object again.
+static bool reuse_object(struct task* task, struct cache* cache) {
+	if (!cache->store || task->options->acc_stats) {
+		return false;
+	}
+	int phase = t_enter_timing(task, TIMING_CACHE);
+	struct cache_object* object = cache_get_object(cache);
+	t_leave_timing(task, phase);
+	if (!object) {
+		t_count(task, COUNT_OBJECT_MISSES);
+		return false;
+	}
+	t_count(task, COUNT_OBJECT_HITS);
+	zbcx_Io fh = task->options->output;
+	if (fh.vtable == NULL ||
+		fh.vtable->write((void*) object->data, 1, object->size, fh.state) != object->size) {
+		t_diag(task, DIAG_ERR, "failed to write object file output");
+		t_bail(task);
+	}
+	fh.vtable->close(fh.state);
+	return true;
+}
+
+// The object is only kept when compiling it again would give the same result,
+// including the diagnostics and statistics shown along the way.
+static void keep_object(struct task* task, struct cache* cache,
+	struct codegen* codegen) {
+	if (!cache->store || task->diag_count > 0 || task->compile_time_used ||
+		task->options->acc_stats) {
+		return;
+	}
+	struct gbuf object;
+	gbuf_init(&object);
+	struct buffer* buffer = codegen->buffer_head;
+	while (buffer) {
+		gbuf_write(&object, buffer->data, buffer->used);
+		buffer = buffer->next;
+	}
+	cache_add_object(cache, &object);
 }
 
 static void compile_mainlib(struct task* task, struct cache* cache) {
+	if (cache && reuse_object(task, cache)) {
+		return;
+	}
+	int phase = t_enter_timing(task, TIMING_PARSE);
 	struct parse parse;
 	p_init(&parse, task, cache);
 	p_run(&parse);
+	t_enter_timing(task, TIMING_SEMANTIC);
 	struct semantic semantic;
 	s_init(&semantic, task);
 	s_test(&semantic);
+	t_enter_timing(task, TIMING_CODEGEN);
 	struct codegen codegen;
 	c_init(&codegen, task);
 	c_publish(&codegen);
+	t_leave_timing(task, phase);
+	if (cache) {
+		keep_object(task, cache, &codegen);
+	}
 }
 
 static void perform_selected_task(struct task* task, struct cache* cache) {
@@ -111,26 +165,39 @@ static void perform_selected_task(struct task* task, struct cache* cache) {
 	}
 }
 
-static void perform_task(struct task* task) {
-	if (task->options->cache.enable) {
+struct _zbcx_Session {
+	struct cache_store store;
+};
+
+static void perform_task(struct task* task, zbcx_Session* session) {
+	if (task->options->cache.enable || session) {
 		struct cache cache;
 		cache_init(&cache, task);
+		if (session) {
+			cache.store = &session->store;
+		}
+		int phase = t_enter_timing(task, TIMING_CACHE);
 		cache_load(&cache);
+		t_leave_timing(task, phase);
 		perform_selected_task(task, &cache);
+		phase = t_enter_timing(task, TIMING_CACHE);
 		cache_close(&cache);
+		t_leave_timing(task, phase);
 	} else {
 		perform_selected_task(task, NULL);
 	}
 }
 
-static bool perform_action(const zbcx_Options* options, jmp_buf* root_bail) {
+static bool perform_action(const zbcx_Options* options, zbcx_Session* session,
+	jmp_buf* root_bail) {
 	bool success = false;
 	struct task task;
 	t_init(&task, options, root_bail);
 	jmp_buf bail;
 	if (setjmp(bail) == 0) {
 		task.bail = &bail;
-		perform_task(&task);
+		perform_task(&task, session);
+		t_report_timings(&task);
 		success = true;
 	}
 	task.bail = root_bail;
@@ -138,13 +205,13 @@ static bool perform_action(const zbcx_Options* options, jmp_buf* root_bail) {
 	return success;
 }
 
-zbcx_Result zbcx_compile(const zbcx_Options* options) {
+static zbcx_Result compile(const zbcx_Options* options, zbcx_Session* session) {
 	mem_init(); // TODO: make this state local.
 	jmp_buf bail;
 	zbcx_Result res = zbcx_res_setjmpfail;
 
 	if (setjmp(bail) == 0) {
-		if (perform_action(options, &bail)) {
+		if (perform_action(options, session, &bail)) {
 			res = zbcx_res_ok;
 		}
 	}
@@ -152,3 +219,28 @@ zbcx_Result zbcx_compile(const zbcx_Options* options) {
 	mem_free_all();
 	return res;
 }
+
+zbcx_Result zbcx_compile(const zbcx_Options* options) {
+	return compile(options, NULL);
+}
+
+// The session outlives the memory of each compilation, so it is allocated
+// with malloc().
+zbcx_Session* zbcx_session_create(void) {
+	zbcx_Session* session = malloc(sizeof(*session));
+	if (session) {
+		cache_init_store(&session->store);
+	}
+	return session;
+}
+
+void zbcx_session_destroy(zbcx_Session* session) {
+	if (session) {
+		cache_deinit_store(&session->store);
+		free(session);
+	}
+}
+
+zbcx_Result zbcx_session_compile(zbcx_Session* session, const zbcx_Options* options) {
+	return compile(options, session);
+}
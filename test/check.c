@@ -0,0 +1,385 @@
+// Optimization checks
+// ==========================================================================
+// Compiles a test file at each optimization level with statistics enabled,
+// and compares the notes reported for the file with the notes expected by
+// the file. A note is expected with a directive of the form:
+//
+//   // check -O1 -O2: local variable space reduced from 4 to 3 slots
+//
+// The note must be reported for the first line after the directive that is
+// not a directive itself, and only at the listed levels. Any note that is
+// not expected, and any expected note that is not reported, fails the check.
+//
+// Usage: zt-bcc-check [-I <dir>]... <file>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zbcx.h"
+
+enum { MAX_LEVEL = 2 };
+enum { MAX_MESSAGE = 512 };
+
+struct note {
+   struct note* next;
+   char message[ MAX_MESSAGE ];
+   int line;
+   // Bit N is set when the note is expected at optimization level N.
+   int levels;
+   bool reported;
+};
+
+struct check {
+   const char* path;
+   struct note* expected;
+   struct note* reported;
+   int level;
+   bool failed;
+};
+
+static bool read_directives( struct check* check );
+static const char* read_levels( const char* text, int* levels );
+static bool compile( struct check* check, const char* const* includes,
+   int include_count );
+static void compare_notes( struct check* check );
+static struct note* alloc_note( const char* message, int line );
+static void free_notes( struct note* note );
+static char* file_realpath( void* context, const char* path );
+static bool file_exists( void* context, const char* path );
+static zbcx_Io file_open( void* context, const char* path,
+   const char* modes );
+static int file_close( void* state );
+static int file_error( void* state );
+static int file_seek( void* state, long offset, int whence );
+static unsigned long file_read( void* dest, size_t size, size_t n,
+   void* state );
+static unsigned long file_write( void* src, size_t size, size_t n,
+   void* state );
+static unsigned long output_write( void* src, size_t size, size_t n,
+   void* state );
+static int output_close( void* state );
+static int output_error( void* state );
+static void diag( void* context, int flags, va_list* args );
+
+static const zbcx_IoVtable g_file_vtable = {
+   file_close,
+   file_error,
+   file_seek,
+   file_read,
+   file_write,
+};
+
+static const zbcx_IoVtable g_output_vtable = {
+   output_close,
+   output_error,
+   NULL,
+   NULL,
+   output_write,
+};
+
+int main( int argc, char** argv ) {
+   const char* includes[ 16 ];
+   int include_count = 0;
+   struct check check = { NULL, NULL, NULL, 0, false };
+   for ( int i = 1; i < argc; ++i ) {
+      if ( strcmp( argv[ i ], "-I" ) == 0 && i + 1 < argc &&
+         include_count < ( int ) ( sizeof( includes ) /
+         sizeof( includes[ 0 ] ) ) ) {
+         includes[ include_count ] = argv[ i + 1 ];
+         ++include_count;
+         ++i;
+      }
+      else if ( ! check.path ) {
+         check.path = argv[ i ];
+      }
+      else {
+         check.path = NULL;
+         break;
+      }
+   }
+   if ( ! check.path ) {
+      fprintf( stderr, "usage: %s [-I <dir>]... <file>\n", argv[ 0 ] );
+      return EXIT_FAILURE;
+   }
+   if ( ! read_directives( &check ) ) {
+      return EXIT_FAILURE;
+   }
+   for ( int level = 0; level <= MAX_LEVEL; ++level ) {
+      check.level = level;
+      if ( compile( &check, includes, include_count ) ) {
+         compare_notes( &check );
+      }
+      else {
+         fprintf( stderr, "%s: compilation failed at -O%d\n", check.path,
+            level );
+         check.failed = true;
+      }
+      free_notes( check.reported );
+      check.reported = NULL;
+   }
+   free_notes( check.expected );
+   if ( check.failed ) {
+      return EXIT_FAILURE;
+   }
+   printf( "%s: ok\n", check.path );
+   return EXIT_SUCCESS;
+}
+
+static bool read_directives( struct check* check ) {
+   FILE* file = fopen( check->path, "r" );
+   if ( ! file ) {
+      fprintf( stderr, "error: failed to open %s\n", check->path );
+      return false;
+   }
+   struct note* pending = NULL;
+   struct note* tail = NULL;
+   char text[ 1024 ];
+   int line = 0;
+   while ( fgets( text, sizeof( text ), file ) ) {
+      ++line;
+      const char* directive = text;
+      while ( *directive == ' ' || *directive == '\t' ) {
+         ++directive;
+      }
+      if ( strncmp( directive, "// check ", 9 ) == 0 ) {
+         int levels = 0;
+         const char* message = read_levels( directive + 9, &levels );
+         if ( ! message || levels == 0 ) {
+            fprintf( stderr, "%s:%d: error: malformed directive\n",
+               check->path, line );
+            fclose( file );
+            return false;
+         }
+         struct note* note = alloc_note( message, 0 );
+         note->levels = levels;
+         note->next = pending;
+         pending = note;
+      }
+      else {
+         // The pending directives apply to this line.
+         while ( pending ) {
+            struct note* note = pending;
+            pending = note->next;
+            note->line = line;
+            note->next = NULL;
+            if ( tail ) {
+               tail->next = note;
+            }
+            else {
+               check->expected = note;
+            }
+            tail = note;
+         }
+      }
+   }
+   fclose( file );
+   if ( pending ) {
+      fprintf( stderr, "%s: error: directive at end of file\n", check->path );
+      free_notes( pending );
+      return false;
+   }
+   return true;
+}
+
+// Reads the `-O<level>` options of a directive and returns the message that
+// follows the colon.
+static const char* read_levels( const char* text, int* levels ) {
+   while ( true ) {
+      while ( *text == ' ' ) {
+         ++text;
+      }
+      if ( text[ 0 ] == '-' && text[ 1 ] == 'O' && text[ 2 ] >= '0' &&
+         text[ 2 ] <= '0' + MAX_LEVEL ) {
+         *levels |= 1 << ( text[ 2 ] - '0' );
+         text += 3;
+      }
+      else if ( text[ 0 ] == ':' ) {
+         ++text;
+         while ( *text == ' ' ) {
+            ++text;
+         }
+         return text;
+      }
+      else {
+         return NULL;
+      }
+   }
+}
+
+static bool compile( struct check* check, const char* const* includes,
+   int include_count ) {
+   zbcx_Options options = zbcx_options_init();
+   options.context = check;
+   options.source_file = check->path;
+   options.opt_level = check->level;
+   options.acc_stats = true;
+   for ( int i = 0; i < include_count; ++i ) {
+      zbcx_list_append( &options.includes, ( void* ) includes[ i ] );
+   }
+   options.diag = diag;
+   options.realpath = file_realpath;
+   options.fexists = file_exists;
+   options.fopen = file_open;
+   options.output.state = check;
+   options.output.vtable = &g_output_vtable;
+   bool failed = check->failed;
+   check->failed = false;
+   zbcx_Result result = zbcx_compile( &options );
+   bool succeeded = ( result == zbcx_res_ok && ! check->failed );
+   check->failed = failed;
+   return succeeded;
+}
+
+static void compare_notes( struct check* check ) {
+   for ( struct note* note = check->expected; note; note = note->next ) {
+      note->reported = false;
+   }
+   for ( struct note* reported = check->reported; reported;
+      reported = reported->next ) {
+      struct note* note = check->expected;
+      while ( note && ! ( ! note->reported &&
+         ( note->levels & ( 1 << check->level ) ) &&
+         note->line == reported->line &&
+         strcmp( note->message, reported->message ) == 0 ) ) {
+         note = note->next;
+      }
+      if ( note ) {
+         note->reported = true;
+      }
+      else {
+         fprintf( stderr, "%s:%d: unexpected note at -O%d: %s\n",
+            check->path, reported->line, check->level, reported->message );
+         check->failed = true;
+      }
+   }
+   for ( struct note* note = check->expected; note; note = note->next ) {
+      if ( ( note->levels & ( 1 << check->level ) ) && ! note->reported ) {
+         fprintf( stderr, "%s:%d: missing note at -O%d: %s\n", check->path,
+            note->line, check->level, note->message );
+         check->failed = true;
+      }
+   }
+}
+
+static struct note* alloc_note( const char* message, int line ) {
+   struct note* note = malloc( sizeof( *note ) );
+   if ( ! note ) {
+      fprintf( stderr, "error: out of memory\n" );
+      exit( EXIT_FAILURE );
+   }
+   note->next = NULL;
+   size_t length = strcspn( message, "\r\n" );
+   if ( length >= sizeof( note->message ) ) {
+      length = sizeof( note->message ) - 1;
+   }
+   memcpy( note->message, message, length );
+   note->message[ length ] = '\0';
+   note->line = line;
+   note->levels = 0;
+   note->reported = false;
+   return note;
+}
+
+static void free_notes( struct note* note ) {
+   while ( note ) {
+      struct note* next = note->next;
+      free( note );
+      note = next;
+   }
+}
+
+static char* file_realpath( void* context, const char* path ) {
+   ( void ) context;
+#if defined( _WIN32 ) || defined( _WIN64 )
+   return _fullpath( NULL, path, 0 );
+#else
+   return realpath( path, NULL );
+#endif
+}
+
+static bool file_exists( void* context, const char* path ) {
+   ( void ) context;
+   FILE* file = fopen( path, "rb" );
+   if ( file ) {
+      fclose( file );
+      return true;
+   }
+   return false;
+}
+
+static zbcx_Io file_open( void* context, const char* path,
+   const char* modes ) {
+   ( void ) context;
+   zbcx_Io io = { NULL, NULL };
+   FILE* file = fopen( path, modes );
+   if ( file ) {
+      io.state = file;
+      io.vtable = &g_file_vtable;
+   }
+   return io;
+}
+
+static int file_close( void* state ) {
+   return fclose( state );
+}
+
+static int file_error( void* state ) {
+   return ferror( state );
+}
+
+static int file_seek( void* state, long offset, int whence ) {
+   return fseek( state, offset, whence );
+}
+
+static unsigned long file_read( void* dest, size_t size, size_t n,
+   void* state ) {
+   return fread( dest, size, n, state );
+}
+
+static unsigned long file_write( void* src, size_t size, size_t n,
+   void* state ) {
+   return fwrite( src, size, n, state );
+}
+
+// The object is not kept.
+static unsigned long output_write( void* src, size_t size, size_t n,
+   void* state ) {
+   ( void ) src;
+   ( void ) size;
+   ( void ) state;
+   return n;
+}
+
+static int output_close( void* state ) {
+   ( void ) state;
+   return 0;
+}
+
+static int output_error( void* state ) {
+   ( void ) state;
+   return 0;
+}
+
+static void diag( void* context, int flags, va_list* args ) {
+   struct check* check = context;
+   zbcx_Pos* pos = NULL;
+   if ( flags & ZBCX_DIAG_FILE ) {
+      pos = va_arg( *args, zbcx_Pos* );
+   }
+   const char* format = va_arg( *args, const char* );
+   char message[ MAX_MESSAGE ];
+   vsnprintf( message, sizeof( message ), format, *args );
+   if ( ( flags & ZBCX_DIAG_NOTE ) && pos ) {
+      struct note* note = alloc_note( message, pos->line );
+      note->next = check->reported;
+      check->reported = note;
+   }
+   // The statistics of the whole object are not checked.
+   else if ( flags != ZBCX_DIAG_NONE ) {
+      if ( flags & ZBCX_DIAG_ERR ) {
+         check->failed = true;
+      }
+      fprintf( stderr, "%s\n", message );
+   }
+}